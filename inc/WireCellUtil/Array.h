@@ -116,6 +116,56 @@ namespace WireCell {
 	 */
 	array_xxf deconv(const array_xxf& arr, const array_xxc& filter);
 
+        /** Half-spectrum transforms.
+
+            The DFT of real data is Hermitian so only the first N/2+1
+            frequency samples along the real->complex dimension are
+            independent.  These functions produce and consume only
+            that half which saves about half the memory and work.
+
+            With dim=0 each row of length N is transformed and the
+            spectrum has shape (nrows, N/2+1).  With dim=1 each column
+            is transformed and the spectrum is (N/2+1, ncols).  The
+            inverse must be told the original N as it can not be
+            recovered from N/2+1.
+
+            The full 2D dft_half() transforms rows real->complex then
+            columns complex->complex giving shape (nrows, ncols/2+1).
+
+            Rows or columns are transformed directly in the array
+            memory as a batch which may be split across nthreads.
+
+            A full spectrum filter can be used with deconv_half() by
+            passing filter.leftCols(ncols/2+1).
+         */
+        array_xxc dft_rc_half(const array_xxf& arr, int dim=0, int nthreads=1);
+        array_xxf idft_cr_half(const array_xxc& spec, int nsamples, int dim=0, int nthreads=1);
+        array_xxc dft_half(const array_xxf& arr, int nthreads=1);
+        array_xxf idft_half(const array_xxc& spec, int ncols, int nthreads=1);
+
+        /// As deconv() but with a filter of shape (nrows, ncols/2+1).
+        array_xxf deconv_half(const array_xxf& arr, const array_xxc& filter, int nthreads=1);
+
+        /** Variants which write into caller's arrays.
+
+            Outputs are resized only if their shape differs so reusing
+            the same output array across calls does not allocate.
+            Where the input spectrum is taken by non-const reference
+            it is used as scratch and its contents are destroyed.  For
+            idft_half() the output must already have its final shape
+            (nrows, ncols) as ncols can not be known from the spectrum,
+            else ValueError is thrown.
+         */
+        void dft(const array_xxf& arr, array_xxc& out);
+        void idft(array_xxc& spec, array_xxf& out);
+        void dft_half(const array_xxf& arr, array_xxc& out, int nthreads=1);
+        void idft_half(array_xxc& spec, array_xxf& out, int nthreads=1);
+
+        /// Complex DFT along one dimension done in place, dim as
+        /// for dft_cc().
+        void dft_cc_inplace(array_xxc& arr, int dim=1);
+        void idft_cc_inplace(array_xxc& arr, int dim=1);
+
     }
 }
 
@@ -0,0 +1,116 @@
+/**
+   A streaming linear convolution of waveforms with a fixed kernel.
+
+   The kernel (eg an electronics response) is given once at
+   construction.  For long kernels its spectrum is computed once and
+   the input is processed in blocks with either the overlap-add or
+   the overlap-save method.  Block sizes are chosen with
+   fft_best_length().  For short kernels a direct-form convolution is
+   used instead as it beats the FFT.
+
+   Input may be pushed in chunks of any size.  Output samples are
+   appended as soon as they are complete and flush() emits the
+   remaining tail.  In total, N input samples give N+M-1 output
+   samples for a kernel of size M, exactly as linear_convolve().
+
+       Convolver conv(response);
+       for (const auto& chunk : chunks) {
+           conv.push(chunk, out);
+       }
+       conv.flush(out);
+
+   A Convolver holds working buffers so it must not be used from more
+   than one thread at a time.  Copies share the kernel spectrum so
+   the cheap way to convolve many channels in many threads is to give
+   each thread its own copy.
+ */
+
+#ifndef WIRECELLUTIL_CONVOLVER_H
+#define WIRECELLUTIL_CONVOLVER_H
+
+#include "WireCellUtil/Waveform.h"
+
+#include <memory>
+
+namespace WireCell {
+
+    namespace Waveform {
+
+        class Convolver {
+        public:
+
+            enum class Method { automatic, direct, overlap_add, overlap_save };
+
+            /// Kernels no longer than this use the direct method
+            /// when the method is automatic.
+            static const size_t direct_max = 64;
+
+            /// Create a convolver for the kernel.  If blocksize is
+            /// zero, a good one is chosen.  Otherwise it is the
+            /// minimum number of input samples per FFT block.
+            Convolver(const realseq_t& kernel,
+                      Method method = Method::automatic,
+                      size_t blocksize = 0);
+
+            /// Convolve n input samples, appending any newly complete
+            /// output samples to out.
+            void push(const real_t* in, size_t n, realseq_t& out);
+            void push(const realseq_t& in, realseq_t& out) {
+                push(in.data(), in.size(), out);
+            }
+
+            /// Append all remaining output and reset for new input.
+            void flush(realseq_t& out);
+
+            /// Discard any pending input and output.
+            void reset();
+
+            /// One-shot convolution of a whole waveform.  If truncate
+            /// is true the result has the size of the wave, else it
+            /// has the full linear convolution size.
+            realseq_t convolve(const realseq_t& wave, bool truncate = true);
+
+            /// One-shot convolution into caller's out.  The first
+            /// out.size() samples of the full linear convolution are
+            /// written, zero padding if out is longer.  Once the
+            /// working buffers have been sized by a first call this
+            /// does not allocate.
+            void convolve(crealspan_t wave, realspan_t out);
+
+            /// The method actually in use.
+            Method method() const { return m_method; }
+
+            /// The number of new input samples per FFT block (zero
+            /// for the direct method).
+            size_t block_size() const { return m_nblock; }
+
+            /// The FFT length (zero for the direct method).
+            size_t fft_size() const { return m_nfft; }
+
+        private:
+
+            template<typename Sink>
+            void feed(const real_t* in, size_t n, Sink& sink);
+            template<typename Sink>
+            void finish(Sink& sink);
+            void process_block();
+            void direct(const real_t* in, size_t n);
+
+            Method m_method;
+            size_t m_nkern, m_nfft, m_nblock;
+
+            // Time-reversed kernel for direct, half spectrum for FFT
+            // methods.  Shared between copies.
+            std::shared_ptr<const realseq_t> m_rkern;
+            std::shared_ptr<const compseq_t> m_kspec;
+
+            // Working buffers.
+            realseq_t m_inbuf, m_result, m_tail;
+            compseq_t m_spec;
+            size_t m_npending;  // new samples in m_inbuf
+            size_t m_nin, m_nout; // total samples in and out
+        };
+    }
+}
+
+#endif
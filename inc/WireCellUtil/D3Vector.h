@@ -8,7 +8,7 @@
 
 #include <cmath>
 #include <algorithm>
-#include <vector>
+#include <array>
 #include <iostream>             // for ostream
 
 namespace WireCell {
@@ -25,46 +25,48 @@ namespace WireCell {
 	template< class U >
 	friend std::ostream & operator<<( std::ostream & , const D3Vector<U> & ) ;   
  
-	typedef std::vector<T> D3VectorStore;
+	// Inline, fixed-size storage so that constructing, copying
+	// and passing around vectors never touches the heap.  The
+	// validity flag replaces the old empty-vector convention.
+	typedef std::array<T,3> D3VectorStore;
 	D3VectorStore m_v;
+	bool m_valid;
 
     public :
 
 
 	/// Construct from elements.
-	D3Vector( const T& a=0, const T& b=0, const T& c=0) : m_v(3) { this->set(a,b,c); }
+	constexpr D3Vector( const T& a=0, const T& b=0, const T& c=0)
+	    : m_v{{a,b,c}}, m_valid(true) { }
 
-	// Copy constructor.
-	D3Vector( const D3Vector& o) : m_v(3) { this->set(o.x(), o.y(), o.z()); }
-
-	D3Vector( const T d[3] ) : m_v(3) { this->set(d[0], d[1], d[2]); }
+	constexpr D3Vector( const T d[3] )
+	    : m_v{{d[0],d[1],d[2]}}, m_valid(true) { }
 	
-	// Assignment.
-	D3Vector& operator=(const D3Vector& o) {
-	    this->set(o.x(), o.y(), o.z()); 
-	    return *this;
-	}
+	// Copy and assignment are trivial.
+	D3Vector( const D3Vector& o) = default;
+	D3Vector& operator=(const D3Vector& o) = default;
 
 	/// Set vector from elements;
 	void set(const T& a=0, const T& b=0, const T& c=0) {
-            m_v.resize(3);
 	    m_v[0] = a;
 	    m_v[1] = b;
 	    m_v[2] = c;
+	    m_valid = true;
 	}
 	T x(const T& val) { return m_v[0] = val; }
 	T y(const T& val) { return m_v[1] = val; }
 	T z(const T& val) { return m_v[2] = val; }
 
 
-	/// Convert from other typed vector.
+	/// Convert from other typed vector, eg PointF <--> Point.
 	template< class TT >
-	D3Vector( const D3Vector<TT>& o) : m_v(3) { this->set(o.x(), o.y(), o.z()); }
+	constexpr D3Vector( const D3Vector<TT>& o)
+	    : m_v{{T(o.x()), T(o.y()), T(o.z())}}, m_valid(bool(o)) { }
  
 	/// Access elements by name.
-	T x() const { return m_v[0]; }
-	T y() const { return m_v[1]; }
-	T z() const { return m_v[2]; }
+	constexpr T x() const { return m_v[0]; }
+	constexpr T y() const { return m_v[1]; }
+	constexpr T z() const { return m_v[2]; }
 
 	/// Access elements by copy.
 	T operator[](std::size_t index) const {
@@ -75,11 +77,14 @@ namespace WireCell {
 	T& operator[](std::size_t index) {
 	    return m_v.at(index);	// throw if out of bounds
 	}
+
+	/// Direct access to the contiguous elements.
+	const T* data() const { return m_v.data(); }
+	T* data() { return m_v.data(); }
 	    
 	/// Return the dot product of this vector and the other.
-	T dot ( const D3Vector & rhs ) const {
-	    T scalar = x() * rhs.x() + y() * rhs.y() + z() * rhs.z() ;
-	    return scalar;
+	constexpr T dot ( const D3Vector & rhs ) const {
+	    return x() * rhs.x() + y() * rhs.y() + z() * rhs.z() ;
 	}
  
 	/// Return the magnitude of this vector.
@@ -97,12 +102,10 @@ namespace WireCell {
 	}	    
 
 	/// Return the cross product of this vector and the other.
-	D3Vector cross ( const D3Vector & rhs ) const {
-	    T a = y() * rhs.z() - z() * rhs.y() ;
-	    T b = z() * rhs.x() - x() * rhs.z() ;
-	    T c = x() * rhs.y() - y() * rhs.x() ;
-	    D3Vector product( a , b , c ) ;
-	    return product ;
+	constexpr D3Vector cross ( const D3Vector & rhs ) const {
+	    return D3Vector(y() * rhs.z() - z() * rhs.y(),
+			    z() * rhs.x() - x() * rhs.z(),
+			    x() * rhs.y() - y() * rhs.x());
 	}
  
 	/// Return the triple cross product of this vector and the other two.
@@ -122,20 +125,23 @@ namespace WireCell {
 	}
 
 	D3Vector& operator+=( const D3Vector& other) {
-	    this->set(x()+other.x(), y()+other.y(), z()+other.z());
+	    m_v[0] += other.x();
+	    m_v[1] += other.y();
+	    m_v[2] += other.z();
+	    m_valid = true;
 	    return *this;
 	}
 
-        bool operator!() const {
-            return m_v.size() != 3;
+        constexpr bool operator!() const {
+            return !m_valid;
         }
-        operator bool() const {
-            return m_v.size() == 3;
+        constexpr operator bool() const {
+            return m_valid;
         }
         // can call set(x,y,z) to revalidate.
         void invalidate() {
-            m_v.clear();
-            m_v.shrink_to_fit();
+            m_v.fill(0);
+            m_valid = false;
         }
 
     } ;
@@ -147,37 +153,37 @@ namespace WireCell {
     }
 
     template< class T >
-    D3Vector<T> operator-(const D3Vector<T> a, const D3Vector<T> b) {
+    constexpr D3Vector<T> operator-(const D3Vector<T>& a, const D3Vector<T>& b) {
 	return D3Vector<T>(a.x()-b.x(), a.y()-b.y(), a.z()-b.z());
     }
 
     template< class T >
-    D3Vector<T> operator+(const D3Vector<T> a, const D3Vector<T> b) {
+    constexpr D3Vector<T> operator+(const D3Vector<T>& a, const D3Vector<T>& b) {
 	return D3Vector<T>(a.x()+b.x(), a.y()+b.y(), a.z()+b.z());
     }
 
     template< class T >
-    D3Vector<T> operator*(const D3Vector<T> a, T s) {
+    constexpr D3Vector<T> operator*(const D3Vector<T>& a, T s) {
 	return D3Vector<T>(a.x()*s, a.y()*s, a.z()*s);
     }
 
     template< class T >
-    D3Vector<T> operator/(const D3Vector<T> a, T s) {
+    constexpr D3Vector<T> operator/(const D3Vector<T>& a, T s) {
 	return D3Vector<T>(a.x()/s, a.y()/s, a.z()/s);
     }
 
     template< class T >
-    bool operator==(const D3Vector<T>& a,const D3Vector<T>& b){
+    constexpr bool operator==(const D3Vector<T>& a,const D3Vector<T>& b){
 	return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
     }
 
     template< class T >
-    bool operator!=(const D3Vector<T>& a,const D3Vector<T>& b){
+    constexpr bool operator!=(const D3Vector<T>& a,const D3Vector<T>& b){
 	return ! (a == b);
     }
     
     template< class T >
-    D3Vector<T> operator*(T s, const D3Vector<T> a) {
+    constexpr D3Vector<T> operator*(T s, const D3Vector<T>& a) {
 	return a*s;
     }
 
@@ -0,0 +1,114 @@
+/**
+   Discrete Fourier transforms with a process-wide cache of FFTW
+   plans.
+
+   Creating an FFTW plan (and any twiddle tables) is expensive
+   compared to executing it.  The functions here look up a plan keyed
+   on (length, direction, real/complex, in-place/out-of-place,
+   alignment and, for batches, the memory layout) and create it only
+   on first use.  Plan creation is serialized and plan execution is
+   thread safe so these may be called concurrently.
+
+   The transforms follow the conventions of Eigen::FFT which this
+   package used before: forward transforms are unnormalized, inverse
+   transforms apply 1/N and real<->complex transforms take or give
+   the full (not half) spectrum.
+
+   Wisdom accumulated by more rigorous planning may be saved to and
+   later loaded from a file to skip planning in subsequent jobs.
+ */
+
+#ifndef WIRECELLUTIL_DFT_H
+#define WIRECELLUTIL_DFT_H
+
+#include <complex>
+#include <string>
+#include <cstddef>
+
+namespace WireCell {
+
+    namespace DFT {
+
+        typedef std::complex<float> complex_t;
+
+        /// How much effort to spend finding a fast plan.  More
+        /// effort pays off only if plans are reused or saved as
+        /// wisdom.  These map to FFTW_ESTIMATE, FFTW_MEASURE and
+        /// FFTW_PATIENT.
+        enum class Effort { estimate, measure, patient };
+
+        /// Set the planning effort for plans made from now on.  The
+        /// default is Effort::estimate.
+        void set_effort(Effort effort);
+
+        /// Forward transform of n real samples into the full n
+        /// complex spectrum.
+        void fwd_r2c(const float* in, complex_t* out, int n);
+
+        /// Forward transform of n complex samples.  In may be out.
+        void fwd_c2c(const complex_t* in, complex_t* out, int n);
+
+        /// Inverse transform of n complex samples.  In may be out.
+        void inv_c2c(const complex_t* in, complex_t* out, int n);
+
+        /// Inverse transform of a full, Hermitian spectrum of n
+        /// samples into n real samples.  Only the first n/2+1
+        /// spectral samples are read.
+        void inv_c2r(const complex_t* in, float* out, int n);
+
+        /** Batched transforms.
+
+            These transform howmany sequences, each of length n, in
+            one go.  Element k of sequence b is found at
+            ptr[b*dist + k*stride] as described by the input and
+            output Layout.  Eg, for a column-major (Eigen default)
+            array of shape (nrows, ncols) the rows are Layout{nrows,1}
+            and the columns are Layout{1,nrows}.
+
+            Real/complex transforms use the half spectrum of n/2+1
+            samples, the rest being redundant by Hermitian symmetry.
+
+            If nthreads is more than one the batch is split into that
+            many contiguous sub-batches each transformed in its own
+            thread.
+         */
+        struct Layout {
+            int stride;         // between elements of one sequence
+            int dist;           // between first elements of sequences
+        };
+
+        /// Forward transform of real sequences of length n to half
+        /// spectra of length n/2+1.
+        void fwd_r2c_many(const float* in, complex_t* out, int n, int howmany,
+                          const Layout& il, const Layout& ol, int nthreads=1);
+
+        /// Forward transform of complex sequences of length n.
+        void fwd_c2c_many(const complex_t* in, complex_t* out, int n, int howmany,
+                          const Layout& il, const Layout& ol, int nthreads=1);
+
+        /// Inverse transform of complex sequences of length n.
+        void inv_c2c_many(const complex_t* in, complex_t* out, int n, int howmany,
+                          const Layout& il, const Layout& ol, int nthreads=1);
+
+        /// Inverse transform of half spectra of length n/2+1 to real
+        /// sequences of length n.
+        void inv_c2r_many(const complex_t* in, float* out, int n, int howmany,
+                          const Layout& il, const Layout& ol, int nthreads=1);
+
+        /// Return the number of plans currently held in the cache.
+        std::size_t nplans();
+
+        /// Destroy all cached plans.  Wisdom is kept.  This must not
+        /// be called while transforms are running in other threads.
+        void clear_plans();
+
+        /// Merge FFTW wisdom from the file.  Return false on failure.
+        bool load_wisdom(const std::string& filename);
+
+        /// Write accumulated FFTW wisdom to the file.  Return false
+        /// on failure.
+        bool save_wisdom(const std::string& filename);
+    }
+}
+
+#endif
@@ -8,6 +8,9 @@
 #define WIRECELLUTIL_INTERPOLATE
 
 #include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 
 namespace WireCell {
 
@@ -22,13 +25,22 @@ namespace WireCell {
 
        where "f" is some kind of collection of doubles.
 
+       Many points may be done at once with
+
+          lin(xs.data(), xs.size(), ys.data());  // arbitrary x
+          lin.sample(x0, dx, ys.size(), ys.data());  // x0 + i*dx
+
+       These use no division nor branches per point so the compiler
+       may vectorize them.  They agree with the single point call to
+       within rounding.
+
      */
     template<class Real>
     class linterp {
     public:
         template<class BidiIterator>
         linterp(BidiIterator f, BidiIterator end_p, Real left_endpoint, Real step)
-            : m_dat(f,end_p), m_le(left_endpoint), m_step(step) {
+            : m_dat(f,end_p), m_le(left_endpoint), m_step(step), m_inv(1/step) {
             m_re = m_le + m_step * (m_dat.size()-1);
         }
 
@@ -44,12 +56,123 @@ namespace WireCell {
             return y0 + (x-x0) * (y1-y0) / m_step;
         }
 
+        /// Interpolate n points xs[i] into ys[i].
+        void operator()(const Real* xs, size_t n, Real* ys) const {
+            if (m_dat.size() < 2) {
+                std::fill(ys, ys+n, m_dat.empty() ? Real(0) : m_dat.front());
+                return;
+            }
+            const Real* dat = m_dat.data();
+            const Real le = m_le, inv = m_inv, tmax = m_dat.size()-1;
+            const int imax = m_dat.size()-2;
+            for (size_t ind=0; ind<n; ++ind) {
+                const Real t = std::min(std::max((xs[ind]-le)*inv, Real(0)), tmax);
+                const int i = std::min(int(t), imax);
+                const Real frac = t - i;
+                ys[ind] = dat[i]*(1-frac) + dat[i+1]*frac;
+            }
+        }
+
+        /// Interpolate n points evenly spaced by dx starting at x0.
+        void sample(Real x0, Real dx, size_t n, Real* ys) const {
+            if (m_dat.size() < 2) {
+                std::fill(ys, ys+n, m_dat.empty() ? Real(0) : m_dat.front());
+                return;
+            }
+            const Real* dat = m_dat.data();
+            const Real t0 = (x0-m_le)*m_inv, dt = dx*m_inv, tmax = m_dat.size()-1;
+            const int imax = m_dat.size()-2;
+            for (size_t ind=0; ind<n; ++ind) {
+                const Real t = std::min(std::max(t0 + ind*dt, Real(0)), tmax);
+                const int i = std::min(int(t), imax);
+                const Real frac = t - i;
+                ys[ind] = dat[i]*(1-frac) + dat[i+1]*frac;
+            }
+        }
+
+        std::vector<Real> sample(Real x0, Real dx, size_t n) const {
+            std::vector<Real> ys(n);
+            sample(x0, dx, n, ys.data());
+            return ys;
+        }
+
     private:
         std::vector<Real> m_dat;
-        Real m_le, m_re, m_step;
+        Real m_le, m_re, m_step, m_inv;
+    };
+
+
+    /**
+       Linear interpolation over samples at irregular, increasing x.
+
+          irrterp<double> irr(xs.begin(), xs.end(), fs.begin());
+          double y = irr(42.0);
+
+       Outside the range of xs the end values are returned.  A batch
+       of points is done by walking from the knot of the previous
+       point so increasing x cost O(1) each.  Other orders fall back
+       to a binary search.  The iterators need only be forward
+       iterators.
+     */
+    template<class Real>
+    class irrterp {
+    public:
+        template<class XIterator, class FIterator>
+        irrterp(XIterator x, XIterator x_end, FIterator f)
+            : m_x(x, x_end), m_dat(f, std::next(f, m_x.size())) { }
+
+        Real operator()(Real x) const {
+            if (m_x.empty()) return 0;
+            if (x <= m_x.front()) return m_dat.front();
+            if (x >= m_x.back()) return m_dat.back();
+            const size_t ind = std::upper_bound(m_x.begin(), m_x.end(), x) - m_x.begin() - 1;
+            return at(ind, x);
+        }
+
+        /// Interpolate n points xs[i] into ys[i].
+        void operator()(const Real* xs, size_t n, Real* ys) const {
+            if (m_x.size() < 2) {
+                std::fill(ys, ys+n, m_x.empty() ? Real(0) : m_dat.front());
+                return;
+            }
+            const size_t last = m_x.size()-1;
+            size_t ind = 0;
+            for (size_t iq=0; iq<n; ++iq) {
+                const Real x = xs[iq];
+                if (x <= m_x.front()) { ys[iq] = m_dat.front(); continue; }
+                if (x >= m_x.back()) { ys[iq] = m_dat.back(); continue; }
+                if (x < m_x[ind]) {
+                    ind = std::upper_bound(m_x.begin(), m_x.end(), x) - m_x.begin() - 1;
+                }
+                else {
+                    while (ind < last and m_x[ind+1] <= x) { ++ind; }
+                }
+                ys[iq] = at(ind, x);
+            }
+        }
+
+    private:
+        std::vector<Real> m_x, m_dat;
+
+        Real at(size_t ind, Real x) const {
+            const Real x0 = m_x[ind], x1 = m_x[ind+1];
+            const Real y0 = m_dat[ind], y1 = m_dat[ind+1];
+            return y0 + (x-x0) * (y1-y0) / (x1-x0);
+        }
     };
 
 
+    /// Evaluate any single point interpolator, such as the Boost
+    /// spline below, over a range of x, writing to out.
+    template<class Interp, class InIterator, class OutIterator>
+    OutIterator interpolate(const Interp& interp, InIterator x, InIterator x_end, OutIterator out) {
+        for (; x != x_end; ++x, ++out) {
+            *out = interp(*x);
+        }
+        return out;
+    }
+
+
 
     /** You may also want to use Boost for fancier interpolation.
      * They have similar calling interface:
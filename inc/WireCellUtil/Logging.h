@@ -7,10 +7,12 @@
 // so as to not suffer performance slowdowns.  Of course, do not put
 // code with side effects inside these macros.
 
-// Eventually set this via build configuration to DEBUG or maybe INFO.
-// For development, we keep to trace although default set in wire-cell
-// CLI are higher.
+// The build may set this, eg -DSPDLOG_ACTIVE_LEVEL=SPDLOG_LEVEL_INFO,
+// to compile away the macros below that level.  For development, we
+// default to trace although default set in wire-cell CLI are higher.
+#ifndef SPDLOG_ACTIVE_LEVEL
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
 
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/ostr.h"
@@ -56,6 +58,29 @@ namespace WireCell {
         // Set logging pattern.  If which is empty then
         // set pattern of all sinks.  Otherwise, set the given logger.
         void set_pattern(std::string pattern, std::string which="");
+
+        // Switch all loggers, existing and future, to asynchronous
+        // output.  A log call then formats its message and queues it
+        // and nthreads background threads write queued messages to
+        // the sinks.  When the queue of queue_size messages is full,
+        // a log call waits if block is true or else the oldest
+        // queued message is dropped.  Calling again has no effect.
+        // This rewires the sinks of existing loggers without locking
+        // out their users, so call it, after adding sinks, before
+        // any thread logs.
+        void set_async(size_t queue_size=8192, size_t nthreads=1, bool block=true);
+
+        // Return true if set_async() has been called.
+        bool is_async();
+
+        // Limit the given logger to at most count messages in each
+        // period of seconds.  Further messages in a period are
+        // dropped and their number is logged when the next period
+        // starts.  A count of zero removes the limit.  Adding or
+        // removing a limit rewires the logger's sinks as set_async()
+        // does and so must also be done before the logger is used.
+        // Changing an existing limit is safe at any time.
+        void set_rate_limit(std::string which, size_t count, double seconds=1.0);
     }
 
 }
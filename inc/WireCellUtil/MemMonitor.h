@@ -0,0 +1,183 @@
+/**
+   Sample memory use from a background thread.
+
+   Where MemUsage records the memory at the moments it is called, a
+   MemMonitor samples /proc/self/statm (and optionally smaps_rollup)
+   at a fixed period for as long as it lives.  It keeps the samples
+   as a time series, the peak resident size and the high-water mark
+   within each named scope:
+
+       MemMonitor mon(0.05);   // sample every 50 ms
+       {
+           auto scope = mon.scope("noise filter");
+           ...
+       }
+       Persist::dump("mem.json", mon.to_json());
+
+   Scopes may nest and may be opened from any thread.
+
+   Optionally, counts of operator new and delete calls made by each
+   thread may be kept.  This requires replacing the global operators
+   which a library must not do on its own behalf, so an application
+   that wants the counts puts
+
+       WIRECELL_MEMCOUNT_NEW_DELETE
+
+   at file scope in exactly one of its source files.  Scopes then
+   also record the allocations made by the thread which opened them.
+ */
+
+#ifndef WIRECELLUTIL_MEMMONITOR
+#define WIRECELLUTIL_MEMMONITOR
+
+#include "WireCellUtil/MemUsage.h"
+
+#include <json/json.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace WireCell {
+
+    namespace MemCount {
+
+        /// Per-thread counts of operator new and delete calls.
+        struct Counts {
+            size_t nnew, ndelete, bytes;
+        };
+
+        /// Counts of the calling thread, all zero unless
+        /// WIRECELL_MEMCOUNT_NEW_DELETE is used.
+        Counts& thread_counts();
+
+        /// True if WIRECELL_MEMCOUNT_NEW_DELETE is used.
+        bool enabled();
+        void set_enabled();
+    }
+
+    class MemMonitor {
+    public:
+
+        /// One sample.  Time is in seconds since the monitor
+        /// started and sizes are in KB.  Pss and swap are -1 unless
+        /// smaps_rollup is sampled.
+        struct Sample {
+            double time, size, resident, shared, pss, swap;
+        };
+
+        /// The memory seen during a scope.  Resident sizes are in
+        /// KB.  Allocation counts are differences over the scope of
+        /// the opening thread's MemCount::Counts.
+        struct ScopeStats {
+            std::string name;
+            double start, stop;
+            double start_resident, stop_resident, peak_resident;
+            MemCount::Counts allocs;
+        };
+
+        /// While in scope, a Scope marks a period of interest.  It
+        /// refers to its MemMonitor and must be closed or destroyed
+        /// before that is.
+        class Scope {
+        public:
+            Scope(Scope&& other);
+            ~Scope();
+            /// End the scope now.
+            void close();
+        private:
+            friend class MemMonitor;
+            Scope(MemMonitor* mon, size_t index);
+            MemMonitor* m_mon;
+            size_t m_index;
+            MemCount::Counts m_counts;
+        };
+
+        /// Start sampling every period seconds.  If rollup is true,
+        /// also read smaps_rollup at each sample.
+        explicit MemMonitor(double period = 0.1, bool rollup = false);
+
+        /// Stops sampling.
+        ~MemMonitor();
+
+        /// Stop sampling.  Results remain available.
+        void stop();
+
+        /// Open a named scope.
+        Scope scope(const std::string& name);
+
+        /// Take a sample now, in addition to the periodic ones.
+        Sample sample();
+
+        /// The largest resident size sampled.
+        double peak_resident() const;
+
+        /// Copies of the samples and of the scopes, in the order
+        /// they were opened, so far.
+        std::vector<Sample> samples() const;
+        std::vector<ScopeStats> scopes() const;
+
+        /// All samples and scopes along with the kernel's peak.
+        Json::Value to_json() const;
+
+    private:
+        void run();
+        Sample take();
+        void record(const Sample& s);
+        void close(size_t index, const MemCount::Counts& start);
+
+        const double m_period;
+        const bool m_rollup;
+        const std::chrono::steady_clock::time_point m_t0;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_stopping;
+        std::vector<Sample> m_samples;
+        std::vector<ScopeStats> m_scopes;
+        std::vector<size_t> m_open; // indices into m_scopes
+        double m_peak;
+        std::thread m_thread;
+    };
+}
+
+// The replacements allocate with std::malloc() and free with
+// std::free(), which pair.  Once inlined, g++ 11 and later only see
+// operator new memory going to free() and warn.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#define WIRECELL_MEMCOUNT_PUSH_DIAGNOSTICS                              \
+    _Pragma("GCC diagnostic push")                                      \
+    _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+#define WIRECELL_MEMCOUNT_POP_DIAGNOSTICS _Pragma("GCC diagnostic pop")
+#else
+#define WIRECELL_MEMCOUNT_PUSH_DIAGNOSTICS
+#define WIRECELL_MEMCOUNT_POP_DIAGNOSTICS
+#endif
+
+#define WIRECELL_MEMCOUNT_NEW_DELETE                                    \
+    [[maybe_unused]] static const bool wirecell_memcount_enabled = (WireCell::MemCount::set_enabled(), true); \
+    WIRECELL_MEMCOUNT_PUSH_DIAGNOSTICS                                  \
+    void* operator new(std::size_t n) {                                 \
+        void* p = std::malloc(n ? n : 1);                               \
+        if (!p) { throw std::bad_alloc(); }                             \
+        auto& c = WireCell::MemCount::thread_counts();                  \
+        ++c.nnew; c.bytes += n;                                         \
+        return p;                                                       \
+    }                                                                   \
+    void* operator new[](std::size_t n) { return operator new(n); }     \
+    void operator delete(void* p) noexcept {                            \
+        if (p) { ++WireCell::MemCount::thread_counts().ndelete; }       \
+        std::free(p);                                                   \
+    }                                                                   \
+    void operator delete[](void* p) noexcept { operator delete(p); }    \
+    void operator delete(void* p, std::size_t) noexcept { operator delete(p); } \
+    void operator delete[](void* p, std::size_t) noexcept { operator delete(p); } \
+    WIRECELL_MEMCOUNT_POP_DIAGNOSTICS
+
+#endif
@@ -15,6 +15,22 @@ namespace WireCell {
     double memusage_shared();
     double memusage_size();
 
+    /// Total, resident and shared sizes in KB from one read of
+    /// /proc/self/statm.  All are -1 if not available.
+    struct memusage_statm_t { double size, resident, shared; };
+    memusage_statm_t memusage_statm();
+
+    /// The peak resident size in KB as recorded by the kernel
+    /// (VmHWM) or -1 if not available.
+    double memusage_peak();
+
+    /// Resident, proportional (shared pages divided among their
+    /// users) and swapped sizes in KB from /proc/self/smaps_rollup.
+    /// This costs more to read than statm.  All are -1 if not
+    /// available.
+    struct memusage_rollup_t { double rss, pss, swap; };
+    memusage_rollup_t memusage_rollup();
+
     
     class MemUsage {
     public:	
@@ -0,0 +1,150 @@
+/**
+   Write many arrays to one numpy .npz file.
+
+   Unlike cnpy::npz_save(), which rereads and rewrites the zip
+   central directory for each array appended, an NpzWriter keeps the
+   file open, writes each array once as it is given and writes the
+   central directory once when closed.
+
+   Members may be stored or deflated (as np.savez_compressed).
+   Deflation splits the data into blocks which are compressed
+   independently in up to nthreads threads and joined into one
+   deflate stream.
+
+   An array may also be streamed in chunks of rows so that a large
+   frame need not be held in memory all at once:
+
+       Numpy::NpzWriter out("frames.npz");
+       out.save("channels", chans.data(), {chans.size()});
+       out.begin<float>("frame", {nchans, nticks});
+       for (...) {
+           out.append(rows.data(), nrows);
+       }
+       out.end();
+       out.close();
+
+   Arrays and chunks are written, or copied to be written with the
+   next, before the call returns so callers may reuse their buffers.
+   Chunks smaller than a deflate block are gathered until a block is
+   filled or the array ends.  Errors throw IOError or ValueError.  An
+   NpzWriter must not be used from more than one thread at a time.
+ */
+
+#ifndef WIRECELLUTIL_NPZWRITER_H
+#define WIRECELLUTIL_NPZWRITER_H
+
+#include "WireCellUtil/cnpy.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <Eigen/Core>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace WireCell {
+
+    namespace Numpy {
+
+        class NpzWriter {
+        public:
+
+            enum class Compression { stored, deflate };
+
+            /// Open (and truncate) the file.  The zlib level applies
+            /// to deflated members.
+            NpzWriter(const std::string& filename,
+                      Compression compression = Compression::deflate,
+                      int nthreads = 1, int level = 6);
+
+            /// Closes if not yet closed.
+            ~NpzWriter();
+
+            /// Write one whole array in C order.
+            template<typename T>
+            void save(const std::string& name, const T* data, const std::vector<size_t>& shape) {
+                begin<T>(name, shape);
+                append(data, shape.empty() ? 1 : shape[0]);
+                end();
+            }
+
+            template<typename T>
+            void save(const std::string& name, const std::vector<T>& data) {
+                save(name, data.data(), {data.size()});
+            }
+
+            /// Write an Eigen array, which is in Fortran order.
+            template<typename T>
+            void save(const std::string& name, const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>& arr) {
+                start(name, cnpy::create_npy_header<T>({size_t(arr.rows()), size_t(arr.cols())}, true),
+                      sizeof(T), 1, arr.size());
+                write(reinterpret_cast<const char*>(arr.data()), arr.size()*sizeof(T));
+                end();
+            }
+
+            /// Start an array of the given C order shape to be
+            /// filled by append().
+            template<typename T>
+            void begin(const std::string& name, const std::vector<size_t>& shape) {
+                size_t rowsize = 1;
+                for (size_t ind=1; ind<shape.size(); ++ind) {
+                    rowsize *= shape[ind];
+                }
+                const size_t nvals = shape.empty() ? 1 : shape[0]*rowsize;
+                start(name, cnpy::create_npy_header<T>(shape), sizeof(T), rowsize, nvals);
+            }
+
+            /// Append nrows rows (the product of the trailing
+            /// dimensions) to the current array.
+            template<typename T>
+            void append(const T* data, size_t nrows) {
+                check_word(sizeof(T));
+                write(reinterpret_cast<const char*>(data), nrows*m_rowsize*sizeof(T));
+            }
+
+            /// Finish the current array.  It must have been filled.
+            void end();
+
+            /// Write the central directory and close the file.
+            void close();
+
+            /// The number of arrays written so far.
+            size_t size() const { return m_members.size(); }
+
+        private:
+
+            struct Member {
+                std::string name;
+                uint16_t method;
+                uint32_t crc;
+                uint64_t csize, usize, offset;
+            };
+
+            void start(const std::string& name, const std::vector<char>& header,
+                       size_t word_size, size_t rowsize, size_t nvals);
+            void check_word(size_t word_size);
+            void write(const char* data, size_t size);
+            void write_batch(const char* data, size_t size);
+            void flush();
+            void put(const std::vector<char>& bytes);
+
+            std::string m_filename;
+            std::ofstream m_out;
+            Compression m_compression;
+            int m_nthreads, m_level;
+            uint64_t m_pos;             // bytes written
+            std::vector<Member> m_members;
+
+            // The array being written.
+            bool m_open;
+            size_t m_word_size, m_rowsize;
+            uint64_t m_remaining;       // bytes still expected
+            Member m_cur;
+            std::vector<std::vector<char> > m_blocks; // deflate output
+            std::vector<char> m_pending; // input short of a block
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+   Eigen views of arrays loaded with cnpy.
+
+   A numpy array of shape (nrows, ncols) is viewed in place as an
+   Eigen array of the same shape whether it is in C (row-major) or
+   Fortran (column-major) order.  A 1D array is viewed as one column.
+   As cnpy may return views of a mapped file, the map is valid only
+   as long as the NpyArray or one of its copies lives.
+
+       auto arr = cnpy::npz_load("frames.npz", "frame_orig_0");
+       Array::array_xxf frame = Numpy::as_map<float>(arr);
+ */
+
+#ifndef WIRECELLUTIL_NUMPYHELPER_H
+#define WIRECELLUTIL_NUMPYHELPER_H
+
+#include "WireCellUtil/cnpy.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <Eigen/Core>
+
+namespace WireCell {
+
+    namespace Numpy {
+
+        template<typename T>
+        using map_t = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>,
+                                 Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> >;
+        template<typename T>
+        using const_map_t = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>,
+                                       Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> >;
+
+        namespace detail {
+            // Fill rows, cols and the outer and inner strides.
+            inline void map_shape(const cnpy::NpyArray& arr, size_t word_size,
+                                  Eigen::Index& nrows, Eigen::Index& ncols,
+                                  Eigen::Index& outer, Eigen::Index& inner) {
+                if (arr.word_size != word_size) {
+                    THROW(ValueError() << errmsg{"Numpy: array word size does not match type"});
+                }
+                if (arr.shape.size() == 1) {
+                    nrows = arr.shape[0];
+                    ncols = 1;
+                }
+                else if (arr.shape.size() == 2) {
+                    nrows = arr.shape[0];
+                    ncols = arr.shape[1];
+                }
+                else {
+                    THROW(ValueError() << errmsg{"Numpy: only 1D and 2D arrays may be mapped"});
+                }
+                if (arr.fortran_order) {
+                    outer = nrows; inner = 1;
+                }
+                else {
+                    outer = 1; inner = ncols;
+                }
+            }
+        }
+
+        /// Return a 2D view of the array's data.  ValueError is
+        /// thrown if T does not match the word size or the array is
+        /// not 1D or 2D.
+        template<typename T>
+        map_t<T> as_map(cnpy::NpyArray& arr) {
+            Eigen::Index nrows, ncols, outer, inner;
+            detail::map_shape(arr, sizeof(T), nrows, ncols, outer, inner);
+            return map_t<T>(arr.data<T>(), nrows, ncols,
+                            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(outer, inner));
+        }
+
+        template<typename T>
+        const_map_t<T> as_map(const cnpy::NpyArray& arr) {
+            Eigen::Index nrows, ncols, outer, inner;
+            detail::map_shape(arr, sizeof(T), nrows, ncols, outer, inner);
+            return const_map_t<T>(arr.data<T>(), nrows, ncols,
+                                  Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(outer, inner));
+        }
+    }
+}
+
+#endif
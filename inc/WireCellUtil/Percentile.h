@@ -0,0 +1,145 @@
+/**
+   Percentile and median estimators which do not modify their input.
+
+   Waveform::percentile() and median() partially sort the caller's
+   sequence and percentile_binned() allocates one bin per sample.
+   These alternatives leave the input alone and use bounded memory:
+
+   - select_percentile() gives the same exact answer as percentile()
+     by histogramming to find the bin holding the wanted rank and
+     then selecting among only the samples in that bin.
+
+   - percentile_rows() does the same for every row of a 2D array,
+     eg one median per channel of a frame.
+
+   - P2Percentile estimates a percentile of an unbounded stream in
+     constant memory with the P-square algorithm (Jain & Chlamtac,
+     1985).
+
+   - BinnedPercentile accumulates a fixed-range histogram, eg of ADC
+     values, and answers any percentile from it.
+
+   - RunningMedian and running_median() track the median over a
+     sliding window, eg for baseline following.
+ */
+
+#ifndef WIRECELLUTIL_PERCENTILE_H
+#define WIRECELLUTIL_PERCENTILE_H
+
+#include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/Array.h"
+
+#include <vector>
+
+namespace WireCell {
+
+    namespace Waveform {
+
+        /// Return the value at the given fractional rank in
+        /// [0,1], exactly as percentile() but without modifying the
+        /// wave.
+        real_t select_percentile(crealspan_t wave, real_t percentage);
+        inline real_t select_median(crealspan_t wave) {
+            return select_percentile(wave, 0.5);
+        }
+
+        /// Return the percentile of each row of the array.
+        Array::array_xf percentile_rows(const Array::array_xxf& arr, real_t percentage);
+        inline Array::array_xf median_rows(const Array::array_xxf& arr) {
+            return percentile_rows(arr, 0.5);
+        }
+
+        /// Streaming P-square estimate of one percentile using
+        /// five markers.  Exact for fewer than five samples.
+        class P2Percentile {
+        public:
+            explicit P2Percentile(real_t percentage);
+
+            /// Add one sample.
+            void operator()(real_t x);
+
+            /// Add many samples.
+            void operator()(crealspan_t xs) {
+                for (auto x : xs) { (*this)(x); }
+            }
+
+            /// The current estimate.
+            real_t value() const;
+
+            size_t count() const { return m_count; }
+
+            void reset();
+
+        private:
+            real_t m_p;
+            size_t m_count;
+            double m_q[5];      // marker heights
+            double m_n[5];      // marker positions
+            double m_np[5];     // desired positions
+            double m_dn[5];     // desired position increments
+        };
+
+        /// Histogram of values in a fixed range with nbins bins.
+        /// Values outside the range are counted in the first or
+        /// last bin.  Percentiles are interpolated inside a bin.
+        class BinnedPercentile {
+        public:
+            BinnedPercentile(size_t nbins, real_t lo, real_t hi);
+
+            void operator()(real_t x);
+            void operator()(crealspan_t xs) {
+                for (auto x : xs) { (*this)(x); }
+            }
+
+            real_t percentile(real_t percentage) const;
+            real_t median() const { return percentile(0.5); }
+
+            size_t count() const { return m_count; }
+
+            /// Zero the histogram keeping its binning.
+            void reset();
+
+        private:
+            real_t m_lo, m_binsize;
+            std::vector<unsigned int> m_hist;
+            size_t m_count;
+        };
+
+        /// The median (or other percentile) of the last window
+        /// samples seen.  Each update costs O(window) in memory
+        /// moves but no allocation.
+        class RunningMedian {
+        public:
+            explicit RunningMedian(size_t window);
+
+            /// Add a sample, dropping the oldest if window is full.
+            void push(real_t x);
+
+            /// Drop the oldest sample.
+            void pop();
+
+            /// Push and return the new median.
+            real_t operator()(real_t x) { push(x); return median(); }
+
+            real_t percentile(real_t percentage) const;
+            real_t median() const { return percentile(0.5); }
+
+            size_t size() const { return m_sorted.size(); }
+
+            void reset();
+
+        private:
+            size_t m_window;
+            std::vector<real_t> m_sorted; // current samples in order
+            std::vector<real_t> m_ring;   // current samples in time
+            size_t m_head;                // index of oldest in ring
+        };
+
+        /// Fill out with the median of a window of samples centered
+        /// on each sample of in.  The window is truncated at the
+        /// ends.  In and out must be of the same size.
+        void running_median(crealspan_t in, realspan_t out, size_t window);
+    }
+}
+
+#endif
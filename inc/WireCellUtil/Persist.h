@@ -73,7 +73,8 @@ namespace WireCell {
             If extension is `.jsonnet` and Jsonnet support is compiled
             in, evaluate the file and use the resulting JSON.  Other
             supported extensions include raw (`.json`) or compressed
-            (`.json.bz2`) files.  
+            (`.json.bz2`) files.  These may be cached in binary form,
+            see WireCellUtil/PersistCache.h.
 
             WireCell::IOError is thrown if file is not found.
         */
@@ -0,0 +1,61 @@
+/** A binary cache of JSON files loaded through WireCell::Persist.
+
+    Parsing large JSON files (field responses, wire geometry), in
+    particular bzip2 compressed ones, can dominate job start up.  When
+    a cache directory is set, Persist::load() writes a binary image of
+    each .json or .json.bz2 file it parses into that directory and on
+    later loads reads the image, via a memory map, instead of the
+    file.
+
+    The image is keyed by the resolved path of the file and is used
+    only if the file's size and modification time, in nanoseconds,
+    match those recorded.  If only the time differs, a hash of the
+    contents decides, so touching a file does not invalidate its
+    image.  Otherwise the file is parsed and the image rewritten.
+    An edit that keeps both the size and the time stamp, which takes
+    setting the time back by hand, is not seen.
+
+    Images are in the byte order of the machine writing them.  Images
+    of the other byte order are ignored.
+
+    Arrays of all integer or all real numbers, which make up the bulk
+    of these files, are stored packed.
+
+    Caching is off unless the WIRECELL_JSON_CACHE environment variable
+    names a directory or set_cache_dir() is called.
+ */
+
+#ifndef WIRECELL_PERSISTCACHE
+#define WIRECELL_PERSISTCACHE
+
+#include <json/json.h>
+
+#include <string>
+
+namespace WireCell {
+    namespace Persist {
+
+        /// Return the cache directory or empty string if caching is off.
+        std::string cache_dir();
+
+        /// Set the cache directory, creating it if needed.  An empty
+        /// string turns caching off.
+        void set_cache_dir(const std::string& dirname);
+
+        /// Return the name of the binary image for the resolved file
+        /// name in the cache directory or empty if caching is off.
+        std::string cache_file(const std::string& fname);
+
+        /// Set top from the binary image for the resolved file name
+        /// and return true if caching is on and a valid image exists.
+        bool load_cached(const std::string& fname, Json::Value& top);
+
+        /// Write the binary image of top as parsed from the resolved
+        /// file name.  Does nothing if caching is off.  Failure to
+        /// write is logged but is not an error.
+        void save_cached(const std::string& fname, const Json::Value& top);
+
+    }
+}
+
+#endif
@@ -7,12 +7,15 @@
 #include <set>
 #include <memory>		// auto_ptr
 #include <vector>
+#include <type_traits>
 
 namespace WireCell {
 
     /// A 3D Cartesian point in double precision.
 
     typedef D3Vector<double> Point;
+    static_assert(std::is_trivially_copyable<Point>::value,
+                  "Point must be cheap to copy");
 
     /// An alias for Point.
     typedef Point Vector;
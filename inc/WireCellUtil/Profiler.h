@@ -0,0 +1,138 @@
+/**
+   Time named zones of code in many threads.
+
+   Where TimeKeeper and ExecMon record a flat list of wall clock
+   events from one thread, a Profiler records nested, named zones
+   from any number of threads on a monotonic clock:
+
+       Profiler prof;
+       ...
+       void work(Profiler& prof) {
+           WIRECELL_PROFILE_ZONE(prof, "work");
+           ...
+           {
+               Profiler::Zone z(prof, "inner");
+               ...
+           }
+       }
+       ...
+       std::cerr << prof.summary();
+       prof.write_trace("trace.json");
+
+   Each thread appends finished zones to its own buffer without
+   locking.  The results may be read at any time from any thread and
+   include the zones finished so far.  stats() aggregates zones by
+   name giving count, total and self time (less that of nested
+   zones), min, max and 99th percentile.  trace() gives the zones as
+   Chrome trace event JSON which chrome://tracing and Perfetto read.
+
+   Zone names must outlive the Profiler, as string literals do.  Use
+   intern() for names made at run time.  A disabled Profiler costs a
+   zone only a flag check.
+ */
+
+#ifndef WIRECELLUTIL_PROFILER
+#define WIRECELLUTIL_PROFILER
+
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace WireCell {
+
+    class Profiler {
+        struct Buffer;
+    public:
+
+        /// Aggregate of all zones of one name.  Times in seconds.
+        struct ZoneStats {
+            std::string name;
+            size_t count;
+            double total, self, min, max, p99;
+        };
+
+        /// Time the enclosing scope as a zone.
+        class Zone {
+        public:
+            Zone(Profiler& prof, const char* name);
+            ~Zone();
+            Zone(const Zone&) = delete;
+            Zone& operator=(const Zone&) = delete;
+        private:
+            Profiler& m_prof;
+            Buffer* m_buf;
+            const char* m_name;
+            int64_t m_start;
+        };
+
+        explicit Profiler(bool enabled = true);
+        ~Profiler();
+
+        /// Turn recording of new zones on or off.
+        void enable(bool on = true) { m_enabled = on; }
+        bool enabled() const { return m_enabled; }
+
+        /// Return a copy of the name which lives as long as the
+        /// Profiler.
+        const char* intern(const std::string& name);
+
+        /// Name the calling thread in the trace.
+        void name_thread(const std::string& name);
+
+        /// The number of zones finished so far.
+        size_t nzones() const;
+
+        /// Aggregates by zone name, in order of decreasing total.
+        std::vector<ZoneStats> stats() const;
+
+        /// A text table of stats().
+        std::string summary() const;
+
+        /// Finished zones in Chrome trace event format.
+        Json::Value trace() const;
+
+        /// Write trace() to a file as Persist::dump().
+        void write_trace(const std::string& filename) const;
+
+    private:
+
+        struct Event {
+            const char* name;
+            int64_t start, stop; // ns since m_t0
+            int depth;
+        };
+
+        int64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_t0).count();
+        }
+
+        Buffer* buffer();
+        std::vector<std::vector<Event> > events(std::vector<std::string>& thread_names) const;
+
+        const uint64_t m_id;
+        const std::chrono::steady_clock::time_point m_t0;
+        std::atomic<bool> m_enabled;
+
+        mutable std::mutex m_mutex; // guards the following
+        std::vector<std::unique_ptr<Buffer> > m_buffers;
+        std::set<std::string> m_names;
+    };
+}
+
+#define WIRECELL_PROFILE_CAT2(a, b) a##b
+#define WIRECELL_PROFILE_CAT(a, b) WIRECELL_PROFILE_CAT2(a, b)
+
+/// Time the rest of the enclosing scope as a zone of the given name.
+#define WIRECELL_PROFILE_ZONE(prof, name) \
+    WireCell::Profiler::Zone WIRECELL_PROFILE_CAT(wirecell_profile_zone_, __LINE__)(prof, name)
+
+#endif
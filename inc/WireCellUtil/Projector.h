@@ -0,0 +1,101 @@
+/**
+   Project many points onto the planes of one face at once.
+
+   Pimpos::distance() and Pimpos::closest() answer for one point and
+   one plane at a time.  A Projector holds the same geometry flattened
+   to plain numbers and answers for a batch of points given as
+   separate x, y and z arrays ("struct of arrays").  For each plane
+   and each point it gives the same values as:
+
+       pitch  = pimpos.distance(pt, 2);
+       drift  = pimpos.distance(pt, 0);
+       wire, impact = pimpos.closest(pitch);
+
+   and, when channels are known, the channel of the wire.  Points
+   are taken in blocks and each plane is done in simple loops over
+   the block which the compiler may vectorize.
+
+       Projector proj(store, face);
+       std::vector<Projector::Projected> got;
+       proj.project(xs.size(), xs.data(), ys.data(), zs.data(), got);
+       // got[iplane].wire[ipoint], ...
+
+   A Projector is not modified by project() and may be shared
+   between threads.
+ */
+
+#ifndef WIRECELLUTIL_PROJECTOR_H
+#define WIRECELLUTIL_PROJECTOR_H
+
+#include "WireCellUtil/Pimpos.h"
+#include "WireCellUtil/WireSchema.h"
+
+#include <vector>
+
+namespace WireCell {
+
+    class Projector {
+    public:
+
+        /// Per-plane results, each holding one entry per point.
+        struct Projected {
+            /// Index of the closest wire.  It may be outside
+            /// [0,nwires) for points beyond the plane.
+            std::vector<int> wire;
+            /// Impact position relative to the wire, as the second
+            /// of Pimpos::closest().
+            std::vector<int> impact;
+            /// Channel of the wire or -1 if the wire index is out of
+            /// range or channels are not known.
+            std::vector<int> channel;
+            /// Pitch and drift (anti-drift axis) distances from the
+            /// plane origin.
+            std::vector<double> pitch, drift;
+
+            void resize(size_t npoints);
+        };
+
+        /// Project onto planes described by Pimpos objects.  If
+        /// given, channels[iplane][iwire] is the channel of a wire.
+        explicit Projector(const std::vector<Pimpos>& pimpos,
+                           const std::vector<std::vector<int> >& channels = {});
+
+        /// Project onto the planes of a face.  Each plane's Pimpos
+        /// has its origin at the center of its first wire so drift
+        /// distance is measured from the plane of wires.  Wires must
+        /// be listed in order of increasing pitch.
+        Projector(const WireSchema::Store& store, const WireSchema::Face& face,
+                  int nimpact_bins_per_wire = 10);
+
+        size_t nplanes() const { return m_pimpos.size(); }
+
+        /// The Pimpos of a plane, in the order given.
+        const Pimpos& pimpos(size_t iplane) const { return m_pimpos[iplane]; }
+
+        /// Project npoints points.  The results are resized to
+        /// hold one Projected per plane.
+        void project(size_t npoints, const double* x, const double* y, const double* z,
+                     std::vector<Projected>& results) const;
+
+        std::vector<Projected> project(const std::vector<double>& x,
+                                       const std::vector<double>& y,
+                                       const std::vector<double>& z) const;
+
+    private:
+
+        // Pimpos, flattened.
+        struct Geom {
+            double origin[3], drift[3], pitch[3];
+            double pmin, wire_binsize, impact_binsize;
+        };
+
+        std::vector<Pimpos> m_pimpos;
+        std::vector<Geom> m_geoms;
+        std::vector<std::vector<int> > m_channels;
+
+        void init();
+    };
+
+}
+
+#endif
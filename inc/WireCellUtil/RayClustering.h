@@ -39,6 +39,55 @@ namespace WireCell {
         blobvec_t references(const blobs_t& blobs);
 
 
+        // An index of a set of blobs answering which of them overlap
+        // a given blob in every layer.  The strips of all blobs are
+        // flattened into one array.  The one layer best separating
+        // the blobs is kept as an interval tree (a sorted array
+        // augmented with the maximum strip end of each subtree) which
+        // gives candidates in O(log n + k).  Candidates are then
+        // checked against the remaining layers.  Once built the
+        // index may be queried from many threads.
+        class BlobIndex {
+        public:
+            explicit BlobIndex(const blobs_t& blobs);
+
+            // Fill out with the indices, in increasing order, of the
+            // indexed blobs which overlap blob.
+            void query(const Blob& blob, std::vector<size_t>& out) const;
+
+            size_t size() const { return m_nblobs; }
+
+            // The layer held in the interval tree.
+            layer_index_t layer() const { return m_layer; }
+
+        private:
+            size_t m_nblobs;
+            int m_nlayers;
+            layer_index_t m_layer;
+
+            // Strip bounds as [blob][layer][begin,end].
+            std::vector<grid_index_t> m_bounds;
+
+            // Blobs in m_layer sorted by strip begin, their strip
+            // begin and end and max end of the implicit subtree
+            // rooted at each position.
+            std::vector<size_t> m_order;
+            std::vector<grid_index_t> m_begs, m_ends, m_maxend;
+
+            grid_index_t build(size_t lo, size_t hi);
+            void search(size_t lo, size_t hi, size_t lim, grid_index_t beg,
+                        std::vector<size_t>& out) const;
+        };
+
+        // A pair of indices into two sets of blobs.
+        typedef std::pair<size_t, size_t> blobpair_t;
+
+        // Return all pairs of mutually overlapping blobs from one and
+        // two, ordered by index in one then in two.  Blobs from one
+        // are queried against an index of two using up to nthreads.
+        std::vector<blobpair_t> overlaps(const blobs_t& one, const blobs_t& two, int nthreads=1);
+
+
         // High level API.
 
         typedef std::function<void(blobref_t& a, blobref_t& b)> associator_t;
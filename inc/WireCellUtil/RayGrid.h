@@ -77,7 +77,15 @@ namespace WireCell {
             Vector ray_crossing(const coordinate_t& one, const coordinate_t& two) const;
 
             // Return the pitch location measured in an other layer give of the crossing point of two rays
-            double pitch_location(const coordinate_t& one, const coordinate_t& two, layer_index_t other) const;
+            double pitch_location(const coordinate_t& one, const coordinate_t& two, layer_index_t other) const {
+                const size_t k = coef_index(one.layer, two.layer, other);
+                return two.grid*m_aj[k] + one.grid*m_ai[k] + m_bc[k];
+            }
+
+            // Fill out with the pitch location in the other layer
+            // of each crossing.  Out is resized to match.
+            void pitch_locations(const crossings_t& crossings, layer_index_t other,
+                                 std::vector<double>& out) const;
 
             int pitch_index(double pitch, layer_index_t layer) const {
                 return std::floor(pitch/m_pitch_mag[layer]);
@@ -90,8 +98,8 @@ namespace WireCell {
 
             const vector_array2d_t& ray_jumps() const { return m_ray_jump; }
 
-            const tensor_t a() const { return m_a; }
-            const tensor_t b() const { return m_b; }
+            const tensor_t& a() const { return m_a; }
+            const tensor_t& b() const { return m_b; }
 
         private:
 
@@ -120,6 +128,16 @@ namespace WireCell {
             // indicies.
             tensor_t m_a, m_b;
 
+            // The same coefficients flattened for the hot path with
+            // the "other" layer slowest so that all coefficients
+            // used to project into one layer are contiguous.  With
+            // k=coef_index(l,m,n): m_aj[k]=a[l][m][n],
+            // m_ai[k]=a[m][l][n] and m_bc[k]=b[l][m][n].
+            std::vector<double> m_aj, m_ai, m_bc;
+            size_t coef_index(layer_index_t l, layer_index_t m, layer_index_t n) const {
+                return (size_t(n)*m_nlayers + l)*m_nlayers + m;
+            }
+
         };
 
         inline
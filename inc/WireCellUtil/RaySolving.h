@@ -9,8 +9,11 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/connected_components.hpp>
 
+#include "WireCellUtil/Ress.h"
+
 #include <Eigen/Dense>
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
@@ -18,6 +21,13 @@ namespace WireCell {
 
     namespace RayGrid {
 
+        /** Group measurement and slice nodes which share wires.
+
+            Nodes are kept in flat arrays with their wires in
+            compressed (CSR) form.  Nodes sharing a wire are joined
+            in a union-find as they are added so the clusters are
+            always up to date and clusters() needs no graph search.
+         */
         class Grouping {
         public:
             Grouping() = default;
@@ -36,22 +46,51 @@ namespace WireCell {
             // Add an 'm' or 's' type node.  
             virtual void add(char ntype, ident_t chid, std::vector<ident_t> wids,
                              float value, float weight=1.0);
+
+            // Add many nodes at once.  The wires of nodes[i] are
+            // wids[offsets[i]] up to wids[offsets[i+1]] so offsets
+            // has one more entry than nodes.
+            void add(const std::vector<node_t>& nodes,
+                     const std::vector<size_t>& offsets,
+                     const std::vector<ident_t>& wids);
             
             typedef std::vector<node_t> cluster_t;
             typedef std::unordered_map<int,  cluster_t> clusterset_t;
 
-            // Return nodes in connected subgraphs
+            // Return nodes in connected subgraphs.  Clusters are
+            // numbered in order of their first node.
             clusterset_t clusters();
 
-            graph_t& graph() { return m_graph; }
+            // The number of nodes and of clusters so far.
+            size_t nnodes() const { return m_nodes.size(); }
+            size_t nclusters() const { return m_nclusters; }
+
+            // Return a graph of the nodes and their wires.  This is
+            // made on demand, kept until more nodes are added and is
+            // not used for clustering.  Vertex i is node i.
+            const graph_t& graph();
 
         private:
-            graph_t m_graph;
-            std::unordered_map<ident_t, vertex_t> m_wid2vtx;
+            std::vector<node_t> m_nodes;
+            // CSR: wires of node i are m_wids[m_offsets[i]...m_offsets[i+1]]
+            std::vector<size_t> m_offsets{0};
+            std::vector<ident_t> m_wids;
+
+            // Union-find over nodes.
+            std::vector<size_t> m_parent;
+            size_t m_nclusters{0};
+            size_t find(size_t node);
+            void join(size_t one, size_t two);
+
+            // A node seen to use each wire.
+            std::unordered_map<ident_t, size_t> m_wid2node;
 
-            // helper
-            vertex_t wire_node(ident_t wid);
+            size_t push(const node_t& node);
+            void join_wire(ident_t wid, size_t node);
 
+            // Cache of graph() made from the first m_graph_nodes nodes.
+            graph_t m_graph;
+            size_t m_graph_nodes{0};
         };
 
         
@@ -75,8 +114,14 @@ namespace WireCell {
             void add(const Grouping::clusterset_t& cset);
 
             // Solve for "S", return map from original source ident to solved value.
+            // Each connected component is an independent problem
+            // and up to nthreads are solved concurrently.  A
+            // component unchanged since the last solve() reuses its
+            // solver, starting from the last solution.  Sources
+            // in a component without measurements are not solved and
+            // are returned with their initial value.
             typedef std::unordered_map<ident_t, float> solution_t;
-            solution_t solve();
+            solution_t solve(int nthreads=1);
 
             graph_t& graph() { return m_graph; }
 
@@ -88,9 +133,21 @@ namespace WireCell {
             vertex_t measurement_node(float value, float weight);
             vertex_t source_node(ident_t sid, float value, float weight);
 
-            void solve_one(solution_t& answer,
-                           const std::vector<vertex_t>& sources,
-                           const std::vector<vertex_t>& measures);
+            // A connected component and, once solved, its solver.
+            // Vertices and edges are never removed so the same
+            // vertices mean the same problem.
+            struct Component {
+                std::vector<vertex_t> sources, measures;
+                std::unique_ptr<Ress::SparseSolver> solver;
+            };
+            // By first source vertex.
+            std::unordered_map<vertex_t, Component> m_components;
+
+            // Solve one component, leaving the result in the value
+            // of its source nodes.  The local index of each measure
+            // vertex is written into mindex which is shared between
+            // components.
+            void solve_one(Component& comp, std::vector<size_t>& mindex);
 
         };
     
@@ -108,6 +108,15 @@ namespace WireCell {
         public:
             void add(const Coordinates& coords, const Strip& strip); 
 
+            // Fill corners with those this blob would have if the
+            // strip were added.  The blob itself is unchanged.
+            void corners_with(const Coordinates& coords, const Strip& strip,
+                              crossings_t& corners) const;
+
+            // Return a new blob with this blob's strips plus the
+            // strip and the given corners, as found by corners_with().
+            Blob extend(const Strip& strip, const crossings_t& corners) const;
+
             const strips_t& strips() const { return m_strips; }
             strips_t& strips() { return m_strips; }
 
@@ -150,6 +159,10 @@ namespace WireCell {
 
         private:
             const Coordinates& m_coords;
+
+            // Scratch reused between calls.
+            crossings_t m_corners;
+            std::vector<double> m_pitches;
         };
 
 
@@ -167,6 +180,14 @@ namespace WireCell {
         // One stop shopping to generate blobs from activity
         blobs_t make_blobs(const Coordinates& coords, const activities_t& activities);
 
+        // Generate blobs for many independent slices of activity,
+        // (eg, one per time slice) using up to nthreads threads.
+        // Element i of the result holds the blobs of slices[i]
+        // exactly as make_blobs() would give them.
+        std::vector<blobs_t> make_blobs(const Coordinates& coords,
+                                        const std::vector<activities_t>& slices,
+                                        int nthreads=1);
+
 
         inline
         std::ostream& operator<<(std::ostream& os, const WireCell::RayGrid::Strip& s)
@@ -8,6 +8,9 @@
 
 #include "WireCellUtil/Point.h"
 
+#include <memory>
+#include <cstdint>
+
 namespace WireCell {
 
 
@@ -118,9 +121,89 @@ namespace WireCell {
                 ~FieldResponse();
 	    };
 	    
+	    /// Load a field response from a JSON file (.json or
+	    /// .json.bz2) or from the binary format written by dump().
+	    /// The format is recognized from the file contents.  File
+	    /// resolution is performed.  A binary file is copied into
+	    /// the returned structure.  Use MappedFieldResponse to read
+	    /// one without copying.
 	    FieldResponse load(const char* filename);
+
+	    /// Dump a field response.  File names ending in .json or
+	    /// .json.bz2 give JSON, anything else (eg .wcfr) gives the
+	    /// binary format which MappedFieldResponse reads.
 	    void dump(const char* filename, const FieldResponse& fr);
 
+	    typedef std::shared_ptr<const FieldResponse> FieldResponsePtr;
+
+	    /// Return the field response loaded from the file, sharing
+	    /// one copy per resolved path across the process.  Safe to
+	    /// call from many threads; concurrent callers asking for the
+	    /// same file wait on a single load.  As with load() the
+	    /// shared copy is a copy even of a binary file.
+	    FieldResponsePtr load_shared(const char* filename);
+
+	    /// Drop all responses held by load_shared().  Holders of
+	    /// pointers keep theirs.
+	    void clear_shared();
+
+	    /** A read-only view of a binary field response file.
+
+	        The file is memory mapped and the per-path currents of
+	        each plane are presented in place as a row-major
+	        (npaths, nticks) matrix.  Paths shorter than nticks are
+	        zero padded.  Nothing is copied until field_response()
+	        is called.  IOError is thrown if the file can not be
+	        mapped, is not in the binary format or was written with
+	        another byte order or format version.
+	     */
+	    class MappedFieldResponse {
+	    public:
+
+		typedef Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> currents_t;
+		typedef Eigen::Map<const currents_t> currents_map_t;
+
+		struct Plane {
+		    int planeid;
+		    double location;
+		    double pitch;
+		    size_t npaths, nticks;
+		    const double* pitchpos; // npaths
+		    const double* wirepos;  // npaths
+		    const uint64_t* nsamples; // npaths, unpadded lengths
+		    const float* current;   // npaths*nticks, row-major
+
+		    currents_map_t currents() const {
+			return currents_map_t(current, npaths, nticks);
+		    }
+		};
+
+		explicit MappedFieldResponse(const std::string& filename);
+
+		const std::vector<Plane>& planes() const { return m_planes; }
+		const Plane* plane(int ident) const;
+
+		const WireCell::Vector& axis() const { return m_axis; }
+		double origin() const { return m_origin; }
+		double tstart() const { return m_tstart; }
+		double period() const { return m_period; }
+		double speed() const { return m_speed; }
+
+		/// Copy out to the usual structure.
+		FieldResponse field_response() const;
+
+		/// Return true if the file is in the binary format, of
+		/// this byte order and of a version this build reads.
+		static bool is_binary(const std::string& filename);
+
+	    private:
+		struct Mapping;
+		std::shared_ptr<Mapping> m_map;
+		std::vector<Plane> m_planes;
+		WireCell::Vector m_axis;
+		double m_origin, m_tstart, m_period, m_speed;
+	    };
+
 	}
 
 
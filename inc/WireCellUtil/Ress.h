@@ -4,6 +4,9 @@
 #define WIRECELL_RESS_HEADER_SEEN
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include <vector>
 
 namespace WireCell {
 
@@ -11,6 +14,7 @@ namespace WireCell {
 
         typedef Eigen::VectorXd vector_t;
         typedef Eigen::MatrixXd matrix_t;
+        typedef Eigen::SparseMatrix<double> sparse_matrix_t;
 
         enum Model {
             unknown=0,
@@ -30,24 +34,82 @@ namespace WireCell {
         // Solve m = R*s for s, return s.
         vector_t solve(
             // matrix R
-            matrix_t response, 
+            const matrix_t& response, 
             // measured vector m
-            vector_t measured,
+            const vector_t& measured,
             // params
             const Params& params = Params(),
             // optional initial source s
-            vector_t source = Eigen::VectorXd(),
+            const vector_t& source = vector_t(),
             // optional initial measurement weights
-            vector_t weights = Eigen::VectorXd()
+            const vector_t& weights = vector_t()
             );
+
+        // As above but for a sparse R.  This does not use
+        // wire-cell-ress but SparseSolver below.
+        vector_t solve(const sparse_matrix_t& response,
+                       const vector_t& measured,
+                       const Params& params = Params(),
+                       const vector_t& source = vector_t(),
+                       const vector_t& weights = vector_t());
                        
-        vector_t predict(matrix_t response, vector_t source);
+        vector_t predict(const matrix_t& response, const vector_t& source);
 
-        double chi2(vector_t measured, vector_t predicted);
+        double chi2(const vector_t& measured, const vector_t& predicted);
         
-        double mean_residual(vector_t measured, vector_t predicted);
+        double mean_residual(const vector_t& measured, const vector_t& predicted);
+
+        double chi2_l1(const vector_t& measured, const vector_t& solved, double lambda = 1.0);
+
+
+        /** Coordinate descent lasso and elastic net for a sparse
+            response matrix R.  Each coordinate takes the same update
+            as in the dense solve() of wire-cell-ress,
+
+                s_j = S(rho_j, N*lambda*alpha*w_j) / (G_jj * (1 + lambda*(1-alpha)*w_j))
+
+            where S is soft thresholding, rho_j the correlation of
+            column j with the residual excluding s_j, G = R^T*R and N
+            the number of measurements, so that both give the same
+            solution for the same Params.  The lasso model has
+            alpha=1 and its penalty is half of chi2_l1().
 
-        double chi2_l1(vector_t measured, vector_t solved, double lambda = 1.0);
+            The Gram matrix R^T*R is formed once at construction so
+            the descent works on vectors of the size of s rather than
+            of m.  Each solve() starts from the previous solution
+            (warm start) and sweeps only the nonzero (active)
+            coefficients until they converge before a full sweep
+            checks whether any others should join.
+         */
+        class SparseSolver {
+        public:
+            SparseSolver(const sparse_matrix_t& response, const Params& params = Params());
+
+            // Solve for the measurement.  Weights, if given, scale
+            // lambda for each source.
+            const vector_t& solve(const vector_t& measured,
+                                  const vector_t& weights = vector_t());
+
+            // Set the starting point of the next solve().
+            void warm_start(const vector_t& source);
+
+            // The most recent solution.
+            const vector_t& solution() const { return m_beta; }
+
+            // Indices of the nonzero coefficients of the solution.
+            const std::vector<int>& active() const { return m_active; }
+
+            // Number of sweeps the last solve() took.
+            int iterations() const { return m_niter; }
+
+        private:
+            sparse_matrix_t m_response, m_gram;
+            vector_t m_diag;    // of the Gram matrix
+            Params m_params;
+            vector_t m_beta;
+            std::vector<int> m_active;
+            int m_niter;
+        };
         
     } // namespace Ress
         
@@ -0,0 +1,88 @@
+#ifndef WIRECELL_RINGHISTOGRAM2D
+#define WIRECELL_RINGHISTOGRAM2D
+
+#include <vector>
+#include <cstddef>
+
+namespace WireCell {
+
+    /** A 2D histogram like BufferedHistogram2D but with a fixed
+     * number of Y bins and with all X bins held in one circular
+     * buffer.
+     *
+     * Each X bin is a contiguous row of ysize() values.  Filling
+     * beyond the last X bin grows the buffer (by doubling) and
+     * popping an X bin only moves the start of the ring, so that
+     * after a warm up neither allocates.  Popped X bins are always
+     * ysize() long.
+     *
+     * T is the accumulation type and may be double or float.
+     */
+    template<typename T>
+    class RingHistogram2D {
+    public:
+
+	/// Create a histogram of ny Y bins with lower corner at
+	/// xmin, ymin and bins of given sizes.  Room for nxreserve X
+	/// bins is allocated up front.
+	RingHistogram2D(int ny, double xbinsize=1.0, double ybinsize=1.0,
+			double xmin=0.0, double ymin=0.0, int nxreserve=0);
+
+	/// Add v to the bin holding x,y.  Return false if point is out of bounds.
+	bool fill(double x, double y, T v=1);
+
+	/// Fill n points, return the number in bounds.  If vs is
+	/// null each point adds 1.
+	size_t fill(size_t n, const double* xs, const double* ys, const T* vs=nullptr);
+
+	/// As above for the points common to all arrays.  If vs is
+	/// empty each point adds 1.
+	size_t fill(const std::vector<double>& xs, const std::vector<double>& ys,
+		    const std::vector<T>& vs = std::vector<T>());
+
+	/// Return the ysize() values of the given X bin, counting
+	/// from the lowest, or nullptr if out of range.  The pointer
+	/// is valid until the next fill or pop.
+	const T* xbin(int ind) const;
+
+	/// Slice off the lowest X bin and return it as a vector.
+	std::vector<T> popx();
+
+	/// Slice off the lowest X bin, copying its values into out
+	/// if given.  Return false if there are no X bins.
+	bool popx(T* out);
+
+	// return buffer depth
+	int size() const { return m_nx; }
+	int xsize() const { return size(); }
+	// return the (fixed) size in Y
+	int ysize() const { return m_ny; }
+
+	double xmin() const { return m_xmin; }
+	double ymin() const { return m_ymin; }
+	double xmax() const { return m_xmin + m_xbinsize*m_nx; }
+	double ymax() const { return m_ymin + m_ybinsize*m_ny; }
+	double xbinsize() const { return m_xbinsize; }
+	double ybinsize() const { return m_ybinsize; }
+
+    private:
+	int m_ny;
+	double m_xmin, m_ymin, m_xbinsize, m_ybinsize;
+
+	// m_cap rows of m_ny, m_cap a power of two.  Rows not in
+	// use are kept zeroed.
+	std::vector<T> m_buf;
+	int m_cap, m_head, m_nx;	// rows allocated, first row, rows used
+
+	size_t offset(int ind) const { return size_t((m_head+ind) & (m_cap-1))*m_ny; }
+	void reserve(int nx);
+    };
+
+    typedef RingHistogram2D<double> RingHistogram2Dd;
+    typedef RingHistogram2D<float> RingHistogram2Df;
+
+    extern template class RingHistogram2D<double>;
+    extern template class RingHistogram2D<float>;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/**
+   Histogramming of 16 bit integer (ADC) samples.
+
+   A ShortHistogram spans only the range [min,max] of the samples
+   given to it so finding the mode touches a few hundred bins rather
+   than all 65536.  Samples are counted into several interleaved
+   partial histograms which are summed afterwards.  This avoids the
+   store-to-load dependency when neighboring samples share a bin,
+   which is the common case for ADC baselines.
+
+   The histogram storage only grows so a ShortHistogram reused over
+   many channels does not allocate after the first few.  It is not
+   thread safe, use one per thread.
+ */
+
+#ifndef WIRECELLUTIL_SHORTHISTOGRAM_H
+#define WIRECELLUTIL_SHORTHISTOGRAM_H
+
+#include "WireCellUtil/Array.h"
+
+#include <vector>
+
+namespace WireCell {
+
+    namespace Waveform {
+
+        class ShortHistogram {
+        public:
+
+            /// Replace the histogram with one of n samples, each
+            /// stride apart.
+            void fill(const short* vals, size_t n, size_t stride=1);
+            void fill(const std::vector<short>& vals) {
+                fill(vals.data(), vals.size());
+            }
+
+            /// The smallest, most frequent value.  Zero if empty.
+            short mode() const;
+
+            /// Fill and return the mode.
+            short most_frequent(const short* vals, size_t n, size_t stride=1) {
+                fill(vals, n, stride);
+                return mode();
+            }
+
+            /// The number of times the value was seen.
+            unsigned int count(short val) const;
+
+            /// The smallest and largest values seen.
+            short min() const { return m_lo; }
+            short max() const { return m_lo + m_nbins - 1; }
+
+            /// The counts, one bin per value from min() to max().
+            const unsigned int* bins() const { return m_hist.data(); }
+            size_t nbins() const { return m_nbins; }
+
+        private:
+            int m_lo{0};
+            size_t m_nbins{0};
+            std::vector<unsigned int> m_hist; // partial histograms
+            std::vector<short> m_gather;      // strided input made contiguous
+        };
+
+        /// Return the smallest, most frequent value of each row of
+        /// the array, eg the baseline of each channel of a frame.
+        std::vector<short> most_frequent_rows(const Array::array_xxs& arr);
+    }
+}
+
+#endif
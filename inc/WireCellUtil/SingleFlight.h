@@ -0,0 +1,130 @@
+/**
+   A concurrent map from key to a value made once.
+
+   Callers asking for a key whose value is being made wait for the
+   first caller's result instead of making it again, while values of
+   other keys may be made meanwhile.
+
+       SingleFlight<std::shared_ptr<const Thing> > cache;
+       auto thing = cache.get(path, [&]() { return make_thing(path); });
+
+   If making throws, all waiting callers get the exception and
+   nothing is kept so a later call may retry.  The same holds for a
+   made value that a keep predicate rejects, though callers then get
+   the value.
+ */
+
+#ifndef WIRECELLUTIL_SINGLEFLIGHT
+#define WIRECELLUTIL_SINGLEFLIGHT
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace WireCell {
+
+    template<typename Value, typename Key = std::string>
+    class SingleFlight {
+    public:
+
+        /// Return the value of key, calling make() to make it if no
+        /// one has yet.
+        template<typename Make>
+        Value get(const Key& key, Make make) {
+            return get(key, make, [](const Value&) { return true; });
+        }
+
+        /// As above but a made value for which keep(value) is false
+        /// is not kept.
+        template<typename Make, typename Keep>
+        Value get(const Key& key, Make make, Keep keep) {
+            std::promise<Value> promise;
+            std::shared_future<Value> fut;
+            size_t serial = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_values.find(key);
+                if (it == m_values.end()) {
+                    fut = promise.get_future().share();
+                    serial = ++m_serial;
+                    m_values[key] = Entry{serial, fut};
+                }
+                else {
+                    fut = it->second.fut;
+                }
+            }
+            if (serial) {
+                // Make outside the lock so other keys may be made.
+                try {
+                    Value val = make();
+                    if (!keep(val)) {
+                        forget(key, serial);
+                    }
+                    promise.set_value(std::move(val));
+                }
+                catch (...) {
+                    forget(key, serial);
+                    promise.set_exception(std::current_exception());
+                }
+            }
+            return fut.get();
+        }
+
+        /// Set val and return true if key is made or being made
+        /// successfully, else return false.
+        bool peek(const Key& key, Value& val) {
+            std::shared_future<Value> fut;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_values.find(key);
+                if (it == m_values.end()) {
+                    return false;
+                }
+                fut = it->second.fut;
+            }
+            try {
+                val = fut.get();
+            }
+            catch (...) {
+                return false;
+            }
+            return true;
+        }
+
+        /// Forget the value of key.  Holders of the value keep it.
+        void erase(const Key& key) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_values.erase(key);
+        }
+
+        /// Forget all values.
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_values.clear();
+        }
+
+    private:
+
+        // The serial tells a maker's own entry from a later one made
+        // after an erase().
+        struct Entry {
+            size_t serial;
+            std::shared_future<Value> fut;
+        };
+
+        void forget(const Key& key, size_t serial) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_values.find(key);
+            if (it != m_values.end() and it->second.serial == serial) {
+                m_values.erase(it);
+            }
+        }
+
+        std::mutex m_mutex;
+        size_t m_serial{0};
+        std::map<Key, Entry> m_values;
+    };
+}
+
+#endif
@@ -8,6 +8,8 @@
 #include <numeric>
 #include <algorithm>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 namespace WireCell {
 
@@ -34,6 +36,36 @@ namespace WireCell {
 	typedef Sequence<complex_t> compseq_t;
 
 
+	/// A non-owning view of contiguous values such as held by a
+	/// Sequence, an Eigen array or a raw buffer.  Functions which
+	/// take spans read from and write to caller-provided memory
+	/// and do not allocate.
+	template<typename Val>
+	class Span {
+	    Val* m_data;
+	    size_t m_size;
+	public:
+	    Span(Val* data, size_t size) : m_data(data), m_size(size) {}
+
+	    /// Anything with contiguous data() and size().  Explicit so
+	    /// that a Sequence argument never silently selects a span
+	    /// overload, such as the in-place complex dft().
+	    template<typename Seq, typename = typename std::enable_if<
+		std::is_convertible<decltype(std::declval<Seq&>().data()), Val*>::value>::type>
+	    explicit Span(Seq& seq) : m_data(seq.data()), m_size(seq.size()) {}
+
+	    Val* data() const { return m_data; }
+	    size_t size() const { return m_size; }
+	    Val* begin() const { return m_data; }
+	    Val* end() const { return m_data + m_size; }
+	    Val& operator[](size_t ind) const { return m_data[ind]; }
+	};
+	typedef Span<real_t> realspan_t;
+	typedef Span<const real_t> crealspan_t;
+	typedef Span<complex_t> compspan_t;
+	typedef Span<const complex_t> ccompspan_t;
+
+
 	/// A half-open range of bins (from first bin to one past last bin)
 	typedef std::pair<int,int> BinRange;
 
@@ -123,6 +155,12 @@ namespace WireCell {
 	/// Return the phase or arg part of the sequence
 	realseq_t phase(const compseq_t& seq);
 
+	/// As above but fill caller's out which must be as long as seq.
+	void real(ccompspan_t seq, realspan_t out);
+	void imag(ccompspan_t seq, realspan_t out);
+	void magnitude(ccompspan_t seq, realspan_t out);
+	void phase(ccompspan_t seq, realspan_t out);
+
 
 	/// Increase (shift) sequence values by scalar
 	template<typename Val>
@@ -134,6 +172,12 @@ namespace WireCell {
 	    increase(seq, (float)scalar);
 	}
 
+	/// Increase (shift) values in place by scalar.
+	template<typename Val, typename Scalar>
+	void increase(Span<Val> seq, Scalar scalar) {
+	    for (auto& x : seq) { x += scalar; }
+	}
+
 	/// Increase (shift) sequence values by values in another sequence
 	template<typename Val>
 	void increase(Sequence<Val>& seq, const Sequence<Val>& other) {
@@ -151,6 +195,12 @@ namespace WireCell {
 	    scale(seq, (float)scalar);
 	}
 
+	/// Scale (multiply) values in place by scalar.
+	template<typename Val, typename Scalar>
+	void scale(Span<Val> seq, Scalar scalar) {
+	    for (auto& x : seq) { x *= scalar; }
+	}
+
 	/// Scale (multiply) seq values by values from the other sequence.
 	template<typename Val>
 	void scale(Sequence<Val>& seq, const Sequence<Val>& other) {
@@ -229,6 +279,21 @@ namespace WireCell {
 	/// 1/Nsamples normalization.
 	realseq_t idft(compseq_t spec);
 
+	/// As dft() and idft() but into caller's out which must be
+	/// the same size as the input.
+	void dft(crealspan_t seq, compspan_t out);
+	void idft(ccompspan_t spec, realspan_t out);
+
+	/// Forward and inverse complex DFT in place.
+	void dft(compspan_t seq);
+	void idft(compspan_t spec);
+
+	/// Linear convolution into caller's out.  The first
+	/// out.size() samples of the full in1.size()+in2.size()-1
+	/// are written, zero padding if out is longer.  See
+	/// Convolver for repeated use of one kernel.
+	void linear_convolve(crealspan_t in1, crealspan_t in2, realspan_t out);
+
 	/// Return the smallest, most frequent value to appear in vector.
 	short most_frequent(const std::vector<short>& vals);
 
@@ -11,7 +11,12 @@
 #include "WireCellUtil/Exceptions.h"
 #include "WireCellUtil/String.h"
 #include "WireCellUtil/BoundingBox.h"
+
+#include <boost/iterator/iterator_facade.hpp>
+
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace WireCell {
 
@@ -52,18 +57,100 @@ namespace WireCell {
             std::vector<Face> faces;
             std::vector<Plane> planes;
             std::vector<Wire> wires;
+
+            /// Lookups derived from the above.  They are filled by
+            /// make_indices(), which load() calls.  A StoreDB built
+            /// by hand should be indexed before it is shared.
+            struct Indices {
+                bool done = false;
+
+                // ident to position in detectors and anodes
+                std::unordered_map<int, int> detector, anode;
+
+                // channel to [begin,end) in channel_wires, which
+                // holds wire positions grouped by channel in order of
+                // segment.
+                std::unordered_map<int, std::pair<int,int> > channel;
+                std::vector<int> channel_wires;
+
+                // Per plane: position of its first wire if its wires
+                // are contiguous and in order, else -1, and the
+                // channels of its wires in wire order.
+                std::vector<int> plane_first;
+                std::vector<std::vector<int> > plane_channels;
+
+                std::vector<BoundingBox> anode_bb, face_bb, plane_bb;
+                std::vector<Ray> plane_pitch;
+            };
+            Indices indices;
+
+            void make_indices();
         };
 
 
         // Access store via shared pointer to allow for caching of underlying data.
         typedef std::shared_ptr<const StoreDB> StoreDBPtr;
 
+        /// A read-only view of elements of a StoreDB, either a
+        /// contiguous run or those at a list of positions.  It is
+        /// valid as long as the store is.
+        template<typename T>
+        class View {
+        public:
+
+            /// Iterators refer to the store, not to the View, so they
+            /// outlive a temporary View.
+            class iterator : public boost::iterator_facade<iterator, const T,
+                                                           boost::random_access_traversal_tag> {
+            public:
+                iterator() : m_base(nullptr), m_index(nullptr), m_pos(0) {}
+                iterator(const T* base, const int* index, size_t pos)
+                    : m_base(base), m_index(index), m_pos(pos) {}
+            private:
+                friend class boost::iterator_core_access;
+                const T& dereference() const { return m_index ? m_base[m_index[m_pos]] : m_base[m_pos]; }
+                bool equal(const iterator& o) const { return m_pos == o.m_pos; }
+                void increment() { ++m_pos; }
+                void decrement() { --m_pos; }
+                void advance(std::ptrdiff_t n) { m_pos += n; }
+                std::ptrdiff_t distance_to(const iterator& o) const { return std::ptrdiff_t(o.m_pos) - std::ptrdiff_t(m_pos); }
+                const T* m_base;
+                const int* m_index;
+                size_t m_pos;
+            };
+            typedef iterator const_iterator;
+            typedef T value_type;
+
+            View() : m_base(nullptr), m_index(nullptr), m_size(0) {}
+            View(const T* base, size_t size) : m_base(base), m_index(nullptr), m_size(size) {}
+            View(const T* base, const int* index, size_t size) : m_base(base), m_index(index), m_size(size) {}
+
+            size_t size() const { return m_size; }
+            bool empty() const { return m_size == 0; }
+            const T& operator[](size_t ind) const { return m_index ? m_base[m_index[ind]] : m_base[ind]; }
+            const T& front() const { return (*this)[0]; }
+            const T& back() const { return (*this)[m_size-1]; }
+            iterator begin() const { return iterator(m_base, m_index, 0); }
+            iterator end() const { return iterator(m_base, m_index, m_size); }
+
+            /// True if the elements are adjacent in memory.
+            bool contiguous() const { return m_index == nullptr; }
+
+            /// Copy out, as these methods used to return.
+            operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+        private:
+            const T* m_base;
+            const int* m_index;
+            size_t m_size;
+        };
+
         // Bolt on some const functions to the underlying and shared store.
         class Store {
             StoreDBPtr m_db;
         public:
             Store();            // underlying store will be null!
-            Store(StoreDBPtr db);
+            Store(StoreDBPtr db); // an unindexed db is copied and indexed
             Store(const Store& other); // copy ctro
             Store& operator=(const Store& other);
 
@@ -76,25 +163,55 @@ namespace WireCell {
             const std::vector<Plane>& planes() const;
             const std::vector<Wire>& wires() const;
 
+            // Lookup by ident.  KeyError is thrown if not found.
             const Anode& anode(int ident) const;
+            const Detector& detector(int ident) const;
 
-            std::vector<Anode> anodes(const Detector& detector) const;
-            std::vector<Face> faces(const Anode& anode) const;
-            std::vector<Plane> planes(const Face& face) const;
-            std::vector<Wire> wires(const Plane& plane) const;
+            // Children of an object of this store.  Objects passed
+            // by reference from this store are located in constant
+            // time, copies are searched for.
+            View<Anode> anodes(const Detector& detector) const;
+            View<Face> faces(const Anode& anode) const;
+            View<Plane> planes(const Face& face) const;
+            View<Wire> wires(const Plane& plane) const;
 
-            BoundingBox bounding_box(const Anode& anode) const;
-            BoundingBox bounding_box(const Face& face) const;
-            BoundingBox bounding_box(const Plane& plane) const;
+            // The wire segments of a channel in order of segment.
+            // Empty if the channel is unknown.
+            View<Wire> channel_wires(int channel) const;
 
-            Ray wire_pitch(const Plane& plane) const;
+            const BoundingBox& bounding_box(const Anode& anode) const;
+            const BoundingBox& bounding_box(const Face& face) const;
+            const BoundingBox& bounding_box(const Plane& plane) const;
 
-            std::vector<int> channels(const Plane& plane) const;
-            
+            const Ray& wire_pitch(const Plane& plane) const;
+
+            const std::vector<int>& channels(const Plane& plane) const;
+
+        private:
+            template<typename T>
+            size_t position(const std::vector<T>& all, const T& obj) const;
         };
 
 
+        /// Load a store from a file.  Stores are cached by resolved
+        /// path for the life of the process.  This is safe to call
+        /// from many threads, concurrent calls for the same file
+        /// wait on one load.
         Store load(const char* filename);
+
+        /// Load only the anodes of the given idents, their faces,
+        /// planes and wires and the detectors holding them.  Such
+        /// stores are cached by path and anode set and are copied out
+        /// of the whole store of the file, which is loaded and cached
+        /// as by load(filename) the first time, so the file is parsed
+        /// only once for any number of anode sets.  KeyError is
+        /// thrown for an unknown anode.
+        Store load(const char* filename, std::vector<int> anodes);
+
+        /// Drop all cached stores.  Stores already held are not
+        /// affected.
+        void clear_cache();
+
         //void dump(const char* filename, const Store& store);
 
     }
@@ -21,6 +21,8 @@
 
 namespace cnpy {
 
+    // The data is either owned by data_holder or is a view into
+    // memory (eg a private file mapping) kept alive by mapping.
     struct NpyArray {
         NpyArray(const std::vector<size_t>& _shape, size_t _word_size, bool _fortran_order) :
             shape(_shape), word_size(_word_size), fortran_order(_fortran_order)
@@ -29,18 +31,28 @@ namespace cnpy {
             for(size_t i = 0;i < shape.size();i++) num_vals *= shape[i];
             data_holder = std::shared_ptr<std::vector<char>>(
                 new std::vector<char>(num_vals * word_size));
+            data_ptr = data_holder->data();
         }
 
-        NpyArray() : shape(0), word_size(0), fortran_order(0), num_vals(0) { }
+        NpyArray(const std::vector<size_t>& _shape, size_t _word_size, bool _fortran_order,
+                 char* ptr, std::shared_ptr<void> keep) :
+            mapping(keep), data_ptr(ptr),
+            shape(_shape), word_size(_word_size), fortran_order(_fortran_order)
+        {
+            num_vals = 1;
+            for(size_t i = 0;i < shape.size();i++) num_vals *= shape[i];
+        }
+
+        NpyArray() : data_ptr(nullptr), shape(0), word_size(0), fortran_order(0), num_vals(0) { }
 
         template<typename T>
         T* data() {
-            return reinterpret_cast<T*>(&(*data_holder)[0]);
+            return reinterpret_cast<T*>(data_ptr);
         }
 
         template<typename T>
         const T* data() const {
-            return reinterpret_cast<T*>(&(*data_holder)[0]);
+            return reinterpret_cast<const T*>(data_ptr);
         }
 
         template<typename T>
@@ -50,10 +62,17 @@ namespace cnpy {
         }
 
         size_t num_bytes() const {
-            return data_holder->size();
+            return num_vals * word_size;
+        }
+
+        // True if the data is a view of a mapped file.
+        bool mapped() const {
+            return mapping != nullptr;
         }
 
         std::shared_ptr<std::vector<char>> data_holder;
+        std::shared_ptr<void> mapping;
+        char* data_ptr;
         std::vector<size_t> shape;
         size_t word_size;
         bool fortran_order;
@@ -64,14 +83,28 @@ namespace cnpy {
 
     char BigEndianTest();
     char map_type(const std::type_info& t);
-    template<typename T> std::vector<char> create_npy_header(const std::vector<size_t>& shape);
+    template<typename T> std::vector<char> create_npy_header(const std::vector<size_t>& shape, bool fortran_order = false);
     void parse_npy_header(FILE* fp,size_t& word_size, std::vector<size_t>& shape, bool& fortran_order);
     void parse_npy_header(unsigned char* buffer,size_t& word_size, std::vector<size_t>& shape, bool& fortran_order);
+    // Parse the header at the start of buffer of the given size.
+    // Return the number of bytes up to the start of the data.
+    size_t parse_npy_header(const char* buffer, size_t size, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order);
     void parse_zip_footer(FILE* fp, uint16_t& nrecs, size_t& global_header_size, size_t& global_header_offset);
+
+    // Loading memory maps the file (copy-on-write) and members are
+    // found through the zip central directory so only the bytes of
+    // the wanted arrays are read.  Uncompressed .npy files and stored
+    // (np.savez) members are returned as mapped views without a copy
+    // when suitably aligned.  Compressed (np.savez_compressed)
+    // members are inflated directly into the returned array.
     npz_t npz_load(std::string fname);
     NpyArray npz_load(std::string fname, std::string varname);
     NpyArray npy_load(std::string fname);
 
+    // Return the names of the arrays in the npz file, without the
+    // .npy extension, as found in its central directory.
+    std::vector<std::string> npz_names(std::string fname);
+
     template<typename T> std::vector<char>& operator+=(std::vector<char>& lhs, const T rhs) {
         //write in little endian
         for(size_t byte = 0; byte < sizeof(T); byte++) {
@@ -135,6 +168,8 @@ namespace cnpy {
         fclose(fp);
     }
 
+    // Note, appending rewrites the central directory each time.
+    // WireCell::Numpy::NpzWriter writes many arrays more cheaply.
     template<typename T> void npz_save(std::string zipname, std::string fname, const T* data, const std::vector<size_t>& shape, std::string mode = "w")
     {
         //first, append a .npy to the fname
@@ -176,6 +211,13 @@ namespace cnpy {
         uint32_t crc = crc32(0L,(uint8_t*)&npy_header[0],npy_header.size());
         crc = crc32(crc,(uint8_t*)data,nels*sizeof(T));
 
+        //pad the local header with an alignment extra field (as
+        //used by Android's zipalign) so that the array data starts
+        //on a 16 byte boundary and may be viewed in place on load.
+        const size_t align = 16;
+        size_t extra_len = 6;
+        extra_len += (align - (global_header_offset + 30 + fname.size() + extra_len) % align) % align;
+
         //build the local header
         std::vector<char> local_header;
         local_header += "PK"; //first part of sig
@@ -189,14 +231,19 @@ namespace cnpy {
         local_header += (uint32_t) nbytes; //compressed size
         local_header += (uint32_t) nbytes; //uncompressed size
         local_header += (uint16_t) fname.size(); //fname length
-        local_header += (uint16_t) 0; //extra field length
+        local_header += (uint16_t) extra_len; //extra field length
         local_header += fname;
+        local_header += (uint16_t) 0xd935; //alignment extra field id
+        local_header += (uint16_t) (extra_len - 4); //its data size
+        local_header += (uint16_t) align;
+        local_header.resize(local_header.size() + extra_len - 6, 0);
 
         //build global header
         global_header += "PK"; //first part of sig
         global_header += (uint16_t) 0x0201; //second part of sig
         global_header += (uint16_t) 20; //version made by
-        global_header.insert(global_header.end(),local_header.begin()+4,local_header.begin()+30);
+        global_header.insert(global_header.end(),local_header.begin()+4,local_header.begin()+28);
+        global_header += (uint16_t) 0; //extra field length
         global_header += (uint16_t) 0; //file comment length
         global_header += (uint16_t) 0; //disk number where file starts
         global_header += (uint16_t) 0; //internal file attributes
@@ -237,14 +284,16 @@ namespace cnpy {
         npz_save(zipname, fname, &data[0], shape, mode);
     }
 
-    template<typename T> std::vector<char> create_npy_header(const std::vector<size_t>& shape) {  
+    template<typename T> std::vector<char> create_npy_header(const std::vector<size_t>& shape, bool fortran_order) {  
 
         std::vector<char> dict;
         dict += "{'descr': '";
         dict += BigEndianTest();
         dict += map_type(typeid(T));
         dict += std::to_string(sizeof(T));
-        dict += "', 'fortran_order': False, 'shape': (";
+        dict += "', 'fortran_order': ";
+        dict += fortran_order ? "True" : "False";
+        dict += ", 'shape': (";
         dict += std::to_string(shape[0]);
         for(size_t i = 1;i < shape.size();i++) {
             dict += ", ";
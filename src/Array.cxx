@@ -1,6 +1,7 @@
 #include "WireCellUtil/Array.h"
 
-#include <unsupported/Eigen/FFT>
+#include "WireCellUtil/DFT.h"
+#include "WireCellUtil/Exceptions.h"
 
 #include <algorithm>
 #include <complex>
@@ -10,31 +11,71 @@ using namespace WireCell::Array;
 
 
 
-//http://stackoverflow.com/a/33636445
+// Arrays are column-major so rows are strided and columns are
+// contiguous.  Either way the batched DFTs read and write the array
+// memory directly, no per-row or per-column temporaries are made.
+
+static DFT::Layout rows_layout(int nrows) { return DFT::Layout{nrows, 1}; }
+static DFT::Layout cols_layout(int nrows) { return DFT::Layout{1, nrows}; }
 
 WireCell::Array::array_xxc WireCell::Array::dft(const WireCell::Array::array_xxf& arr)
+{
+    array_xxc matc;
+    dft(arr, matc);
+    return matc;
+}
+
+void WireCell::Array::dft(const WireCell::Array::array_xxf& arr, WireCell::Array::array_xxc& out)
 {
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    Eigen::FFT< float > fft;
-    Eigen::MatrixXcf matc(nrows, ncols);
-
-    for (int irow = 0; irow < nrows; ++irow) {
-        Eigen::VectorXcf fspec(ncols); // frequency spectrum 
-	// fft wants vectors, also input arr is const
-	Eigen::VectorXf tmp = arr.row(irow);
-	fft.fwd(fspec, tmp);
-        matc.row(irow) = fspec;
+    out.resize(nrows, ncols);
+    DFT::fwd_r2c_many(arr.data(), out.data(), ncols, nrows,
+                      rows_layout(nrows), rows_layout(nrows));
+    for (int icol = ncols/2+1; icol < ncols; ++icol) {
+        out.col(icol) = out.col(ncols-icol).conjugate();
     }
+    dft_cc_inplace(out, 1);
+}
+
+void WireCell::Array::idft(WireCell::Array::array_xxc& spec, WireCell::Array::array_xxf& out)
+{
+    const int nrows = spec.rows();
+    const int ncols = spec.cols();
+
+    idft_cc_inplace(spec, 1);
+    out.resize(nrows, ncols);
+    DFT::inv_c2r_many(spec.data(), out.data(), ncols, nrows,
+                      rows_layout(nrows), rows_layout(nrows));
+}
 
-    for (int icol = 0; icol < ncols; ++icol) {
-        Eigen::VectorXcf pspec(nrows); // periodicity spectrum
-        fft.fwd(pspec, matc.col(icol));
-        matc.col(icol) = pspec;
+void WireCell::Array::dft_cc_inplace(WireCell::Array::array_xxc& arr, int dim)
+{
+    const int nrows = arr.rows();
+    const int ncols = arr.cols();
+    if (dim == 0) {
+        DFT::fwd_c2c_many(arr.data(), arr.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
+    }
+    else {
+        DFT::fwd_c2c_many(arr.data(), arr.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
     }
+}
 
-    return matc;
+void WireCell::Array::idft_cc_inplace(WireCell::Array::array_xxc& arr, int dim)
+{
+    const int nrows = arr.rows();
+    const int ncols = arr.cols();
+    if (dim == 0) {
+        DFT::inv_c2c_many(arr.data(), arr.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
+    }
+    else {
+        DFT::inv_c2c_many(arr.data(), arr.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
+    }
 }
 
 WireCell::Array::array_xxc WireCell::Array::dft_rc(const WireCell::Array::array_xxf& arr, int dim)
@@ -42,23 +83,21 @@ WireCell::Array::array_xxc WireCell::Array::dft_rc(const WireCell::Array::array_
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    Eigen::FFT< float > fft;
-    Eigen::MatrixXcf matc(nrows, ncols);
+    array_xxc matc(nrows, ncols);
 
+    // Transform into the first half and fill the rest by symmetry.
     if (dim == 0) {
-        for (int irow = 0; irow < nrows; ++irow) {
-            Eigen::VectorXcf fspec(ncols);
-            Eigen::VectorXf tmp = arr.row(irow);
-            fft.fwd(fspec, tmp);
-            matc.row(irow) = fspec;
+        DFT::fwd_r2c_many(arr.data(), matc.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
+        for (int icol = ncols/2+1; icol < ncols; ++icol) {
+            matc.col(icol) = matc.col(ncols-icol).conjugate();
         }
     }
     else if (dim == 1) {
-        for (int icol = 0; icol < ncols; ++icol) {
-            Eigen::VectorXcf fspec(nrows);
-            Eigen::VectorXf tmp = arr.col(icol);
-            fft.fwd(fspec, tmp);
-            matc.col(icol) = fspec;
+        DFT::fwd_r2c_many(arr.data(), matc.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
+        for (int irow = nrows/2+1; irow < nrows; ++irow) {
+            matc.row(irow) = matc.row(nrows-irow).conjugate();
         }
     }        
     return matc;
@@ -69,24 +108,15 @@ WireCell::Array::array_xxc WireCell::Array::dft_cc(const WireCell::Array::array_
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    Eigen::FFT< float > fft;
-    Eigen::MatrixXcf matc(nrows, ncols);
+    array_xxc matc(nrows, ncols);
 
-    matc = arr.matrix();
-    
     if (dim == 0) {
-        for (int irow = 0; irow < nrows; ++irow) {
-            Eigen::VectorXcf pspec(ncols);
-            fft.fwd(pspec,matc.row(irow));
-            matc.row(irow) = pspec;
-        }
+        DFT::fwd_c2c_many(arr.data(), matc.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
     }
     else {
-        for (int icol = 0; icol < ncols; ++icol) {
-            Eigen::VectorXcf pspec(nrows);
-            fft.fwd(pspec, matc.col(icol));
-            matc.col(icol) = pspec;
-        }
+        DFT::fwd_c2c_many(arr.data(), matc.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
     }
     return matc;
 }
@@ -95,30 +125,9 @@ WireCell::Array::array_xxc WireCell::Array::dft_cc(const WireCell::Array::array_
 
 WireCell::Array::array_xxf WireCell::Array::idft(const WireCell::Array::array_xxc& arr)
 {
-    const int nrows = arr.rows();
-    const int ncols = arr.cols();
-
-    // fft works on matrices, not arrays, also don't step on const input
-    Eigen::MatrixXcf partial(nrows, ncols);
-    partial = arr.matrix();
-
-    Eigen::FFT< float > fft;
-
-    for (int icol = 0; icol < ncols; ++icol) {
-        Eigen::VectorXcf pspec(nrows); // wire spectrum
-        fft.inv(pspec, partial.col(icol));
-        partial.col(icol) = pspec;
-    }
-
-    //shared_array_xxf ret = std::make_shared<array_xxf> (nrows, ncols);
-    array_xxf ret(nrows, ncols);
-
-    for (int irow = 0; irow < nrows; ++irow) {
-        Eigen::VectorXf wave(ncols); // back to real-valued time series
-        fft.inv(wave, partial.row(irow));
-        ret.row(irow) = wave;
-    }
-
+    array_xxc partial = arr;    // don't step on const input
+    array_xxf ret;
+    idft(partial, ret);
     return ret;
 }
 
@@ -127,25 +136,15 @@ WireCell::Array::array_xxc WireCell::Array::idft_cc(const WireCell::Array::array
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    // fft works on matrices, not arrays, also don't step on const input
-    Eigen::MatrixXcf ret(nrows, ncols);
-    ret = arr.matrix();
-
-    Eigen::FFT< float > fft;
+    array_xxc ret(nrows, ncols);
 
     if (dim == 1) {
-        for (int icol = 0; icol < ncols; ++icol) {
-            Eigen::VectorXcf pspec(nrows);
-            fft.inv(pspec, ret.col(icol));
-            ret.col(icol) = pspec;
-        }
+        DFT::inv_c2c_many(arr.data(), ret.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
     }
     else if (dim == 0) {
-        for (int irow = 0; irow < nrows; ++irow) {
-            Eigen::VectorXcf pspec(ncols);
-            fft.inv(pspec, ret.row(irow));
-            ret.row(irow) = pspec;
-        }
+        DFT::inv_c2c_many(arr.data(), ret.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
     }
     return ret;
 }
@@ -155,75 +154,127 @@ WireCell::Array::array_xxf WireCell::Array::idft_cr(const WireCell::Array::array
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    // fft works on matrices, not arrays, also don't step on const input
-    Eigen::MatrixXcf partial(nrows, ncols);
-    partial = arr.matrix();
-
-    Eigen::FFT< float > fft;
-
     array_xxf ret(nrows, ncols);
 
+    // Only the first half of the spectrum is read.
     if (dim == 0) {
-        for (int irow = 0; irow < nrows; ++irow) {
-            Eigen::VectorXf wave(ncols); // back to real-valued time series
-            fft.inv(wave, partial.row(irow));
-            ret.row(irow) = wave;
-        }
+        DFT::inv_c2r_many(arr.data(), ret.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows));
     }
     else if (dim == 1) {
-        for (int icol = 0; icol < ncols; ++icol) {
-            Eigen::VectorXf wave(nrows);
-            fft.inv(wave, partial.col(icol));
-            ret.col(icol) = wave;
-        }
+        DFT::inv_c2r_many(arr.data(), ret.data(), nrows, ncols,
+                          cols_layout(nrows), cols_layout(nrows));
     }
     return ret;
 }
 
 
 
-// this is a cut-and-paste mashup of dft() and idft() in order to avoid temporaries.
 WireCell::Array::array_xxf
 WireCell::Array::deconv(const WireCell::Array::array_xxf& arr,
 			const WireCell::Array::array_xxc& filter)
+{
+    // The final complex->real transform reads only the first half of
+    // the spectrum so the rest need never be formed.
+    const int nhalf = arr.cols()/2 + 1;
+    return deconv_half(arr, filter.leftCols(nhalf));
+}
+
+
+WireCell::Array::array_xxc
+WireCell::Array::dft_rc_half(const WireCell::Array::array_xxf& arr, int dim, int nthreads)
 {
     const int nrows = arr.rows();
     const int ncols = arr.cols();
 
-    Eigen::FFT< float > fft;
-
-    Eigen::MatrixXcf matc(nrows, ncols);
-    for (int irow = 0; irow < nrows; ++irow) {
-	Eigen::VectorXcf fspec(ncols); // frequency spectrum 
-	// fft wants vectors, also input arr is const
-	Eigen::VectorXf tmp = arr.row(irow);
-	fft.fwd(fspec, tmp);
-	matc.row(irow) = fspec;
-    }
-    
-    for (int icol = 0; icol < ncols; ++icol) {
-	Eigen::VectorXcf pspec(nrows); // periodicity spectrum
-	fft.fwd(pspec, matc.col(icol));
-	matc.col(icol) = pspec;
+    if (dim == 0) {
+        const int nhalf = ncols/2 + 1;
+        array_xxc ret(nrows, nhalf);
+        DFT::fwd_r2c_many(arr.data(), ret.data(), ncols, nrows,
+                          rows_layout(nrows), rows_layout(nrows), nthreads);
+        return ret;
     }
 
-    // deconvolution via multiplication in frequency space
-    Eigen::MatrixXcf filt = matc.array() * filter;
+    const int nhalf = nrows/2 + 1;
+    array_xxc ret(nhalf, ncols);
+    DFT::fwd_r2c_many(arr.data(), ret.data(), nrows, ncols,
+                      cols_layout(nrows), cols_layout(nhalf), nthreads);
+    return ret;
+}
+
+WireCell::Array::array_xxf
+WireCell::Array::idft_cr_half(const WireCell::Array::array_xxc& spec, int nsamples, int dim, int nthreads)
+{
+    const int nrows = spec.rows();
+    const int ncols = spec.cols();
 
-    for (int icol = 0; icol < ncols; ++icol) {
-        Eigen::VectorXcf pspec(nrows); // wire spectrum
-        fft.inv(pspec, filt.col(icol));
-        filt.col(icol) = pspec;
+    if (dim == 0) {
+        array_xxf ret(nrows, nsamples);
+        DFT::inv_c2r_many(spec.data(), ret.data(), nsamples, nrows,
+                          rows_layout(nrows), rows_layout(nrows), nthreads);
+        return ret;
     }
 
-    array_xxf ret(nrows, ncols);
+    array_xxf ret(nsamples, ncols);
+    DFT::inv_c2r_many(spec.data(), ret.data(), nsamples, ncols,
+                      cols_layout(nrows), cols_layout(nsamples), nthreads);
+    return ret;
+}
 
-    for (int irow = 0; irow < nrows; ++irow) {
-        Eigen::VectorXf wave(ncols); // back to real-valued time series
-        fft.inv(wave, filt.row(irow));
-        ret.row(irow) = wave;
-    }
+WireCell::Array::array_xxc
+WireCell::Array::dft_half(const WireCell::Array::array_xxf& arr, int nthreads)
+{
+    array_xxc spec;
+    dft_half(arr, spec, nthreads);
+    return spec;
+}
 
+void WireCell::Array::dft_half(const WireCell::Array::array_xxf& arr,
+                               WireCell::Array::array_xxc& spec, int nthreads)
+{
+    const int nrows = arr.rows();
+    const int ncols = arr.cols();
+    const int nhalf = ncols/2 + 1;
+    spec.resize(nrows, nhalf);
+    DFT::fwd_r2c_many(arr.data(), spec.data(), ncols, nrows,
+                      rows_layout(nrows), rows_layout(nrows), nthreads);
+    DFT::fwd_c2c_many(spec.data(), spec.data(), nrows, nhalf,
+                      cols_layout(nrows), cols_layout(nrows), nthreads);
+}
+
+WireCell::Array::array_xxf
+WireCell::Array::idft_half(const WireCell::Array::array_xxc& spec, int ncols, int nthreads)
+{
+    array_xxc partial = spec;
+    array_xxf ret(spec.rows(), ncols);
+    idft_half(partial, ret, nthreads);
     return ret;
 }
 
+void WireCell::Array::idft_half(WireCell::Array::array_xxc& spec,
+                                WireCell::Array::array_xxf& out, int nthreads)
+{
+    const int nrows = spec.rows();
+    if (out.rows() != nrows or out.cols()/2 + 1 != spec.cols()) {
+        THROW(ValueError() << errmsg{"idft_half: output shape does not match the spectrum"});
+    }
+    DFT::inv_c2c_many(spec.data(), spec.data(), nrows, spec.cols(),
+                      cols_layout(nrows), cols_layout(nrows), nthreads);
+    DFT::inv_c2r_many(spec.data(), out.data(), out.cols(), nrows,
+                      rows_layout(nrows), rows_layout(nrows), nthreads);
+}
+
+WireCell::Array::array_xxf
+WireCell::Array::deconv_half(const WireCell::Array::array_xxf& arr,
+                             const WireCell::Array::array_xxc& filter,
+                             int nthreads)
+{
+    array_xxc spec = dft_half(arr, nthreads);
+
+    // deconvolution via multiplication in frequency space
+    spec *= filter;
+
+    array_xxf ret(arr.rows(), arr.cols());
+    idft_half(spec, ret, nthreads);
+    return ret;
+}
@@ -0,0 +1,236 @@
+#include "WireCellUtil/Convolver.h"
+#include "WireCellUtil/DFT.h"
+#include "WireCellUtil/FFTBestLength.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <algorithm>
+
+using namespace WireCell;
+using namespace WireCell::Waveform;
+
+// Number of output samples accumulated together by the direct method
+// so that they stay in L1 cache while the kernel is swept.
+static const size_t direct_tile = 1024;
+
+Convolver::Convolver(const realseq_t& kernel, Method method, size_t blocksize)
+    : m_method(method)
+    , m_nkern(kernel.size())
+    , m_nfft(0)
+    , m_nblock(0)
+    , m_npending(0)
+    , m_nin(0)
+    , m_nout(0)
+{
+    if (kernel.empty()) {
+        THROW(ValueError() << errmsg{"Convolver: empty kernel"});
+    }
+    if (m_method == Method::automatic) {
+        m_method = m_nkern <= direct_max ? Method::direct : Method::overlap_save;
+    }
+
+    if (m_method == Method::direct) {
+        m_rkern = std::make_shared<const realseq_t>(kernel.rbegin(), kernel.rend());
+        m_tail.assign(m_nkern-1, 0);
+        return;
+    }
+
+    // A block several times the kernel size keeps the FFT cost per
+    // output sample near its minimum.
+    const size_t want = blocksize ? blocksize + m_nkern - 1 : 4*m_nkern;
+    m_nfft = fft_best_length(std::max(want, 2*m_nkern));
+    m_nblock = m_nfft - m_nkern + 1;
+
+    const int nfft = m_nfft;
+    realseq_t padded(kernel);
+    padded.resize(m_nfft, 0);
+    compseq_t kspec(m_nfft/2+1);
+    DFT::fwd_r2c_many(padded.data(), kspec.data(), nfft, 1,
+                      DFT::Layout{1,nfft}, DFT::Layout{1,nfft});
+    m_kspec = std::make_shared<const compseq_t>(std::move(kspec));
+
+    m_inbuf.assign(m_nfft, 0);
+    m_result.assign(m_nfft, 0);
+    m_spec.assign(m_nfft/2+1, 0);
+    if (m_method == Method::overlap_add) {
+        m_tail.assign(m_nkern-1, 0);
+    }
+}
+
+void Convolver::reset()
+{
+    std::fill(m_inbuf.begin(), m_inbuf.end(), 0);
+    std::fill(m_tail.begin(), m_tail.end(), 0);
+    m_npending = m_nin = m_nout = 0;
+}
+
+namespace {
+    // Destinations for output samples as they become available.
+    struct AppendSink {
+        realseq_t& out;
+        void operator()(const real_t* beg, size_t n) {
+            out.insert(out.end(), beg, beg+n);
+        }
+    };
+    struct SpanSink {
+        real_t* ptr;
+        size_t room;
+        void operator()(const real_t* beg, size_t n) {
+            n = std::min(n, room);
+            std::copy(beg, beg+n, ptr);
+            ptr += n;
+            room -= n;
+        }
+    };
+    // Pass on no more than a given number of samples.
+    template<typename Sink>
+    struct LimitSink {
+        Sink& sink;
+        size_t room;
+        void operator()(const real_t* beg, size_t n) {
+            n = std::min(n, room);
+            sink(beg, n);
+            room -= n;
+        }
+    };
+}
+
+void Convolver::push(const real_t* in, size_t n, realseq_t& out)
+{
+    AppendSink sink{out};
+    feed(in, n, sink);
+}
+
+template<typename Sink>
+void Convolver::feed(const real_t* in, size_t n, Sink& sink)
+{
+    m_nin += n;
+    if (m_method == Method::direct) {
+        direct(in, n);
+        sink(m_result.data(), n);
+        m_nout += n;
+        return;
+    }
+
+    // Overlap-save keeps the previous M-1 input samples at the start
+    // of the buffer, overlap-add keeps zero padding at the end.
+    const size_t offset = m_method == Method::overlap_save ? m_nkern-1 : 0;
+    while (n) {
+        const size_t take = std::min(n, m_nblock - m_npending);
+        std::copy(in, in+take, m_inbuf.begin() + offset + m_npending);
+        m_npending += take;
+        in += take;
+        n -= take;
+        if (m_npending == m_nblock) {
+            process_block();
+            sink(m_result.data(), m_nblock);
+            m_nout += m_nblock;
+            m_npending = 0;
+        }
+    }
+}
+
+// Leave the next m_nblock output samples at the start of m_result.
+void Convolver::process_block()
+{
+    const int nfft = m_nfft;
+    const DFT::Layout lay{1,nfft};
+    DFT::fwd_r2c_many(m_inbuf.data(), m_spec.data(), nfft, 1, lay, lay);
+    const auto& kspec = *m_kspec;
+    const size_t nhalf = m_spec.size();
+    for (size_t ind=0; ind<nhalf; ++ind) {
+        m_spec[ind] *= kspec[ind];
+    }
+    DFT::inv_c2r_many(m_spec.data(), m_result.data(), nfft, 1, lay, lay);
+
+    const size_t nover = m_nkern-1;
+    if (m_method == Method::overlap_save) {
+        // The first M-1 outputs are wrapped around, drop them and
+        // keep the last M-1 inputs as history for the next block.
+        std::copy(m_result.begin() + nover, m_result.end(), m_result.begin());
+        std::copy(m_inbuf.begin() + m_nblock, m_inbuf.end(), m_inbuf.begin());
+        return;
+    }
+
+    // overlap-add: add in the tail of the previous block and save
+    // the new tail.
+    for (size_t ind=0; ind<nover; ++ind) {
+        m_result[ind] += m_tail[ind];
+    }
+    std::copy(m_result.begin() + m_nblock, m_result.end(), m_tail.begin());
+}
+
+// Leave the next n output samples at the start of m_result.
+void Convolver::direct(const real_t* in, size_t n)
+{
+    const size_t nover = m_nkern-1;
+
+    // history followed by new input
+    if (m_inbuf.size() < nover + n) {
+        m_inbuf.resize(nover + n);
+    }
+    std::copy(m_tail.begin(), m_tail.end(), m_inbuf.begin());
+    std::copy(in, in+n, m_inbuf.begin() + nover);
+
+    if (m_result.size() < n) {
+        m_result.resize(n);
+    }
+    real_t* y = m_result.data();
+    std::fill(y, y+n, 0);
+    const real_t* h = m_rkern->data();
+    const real_t* x = m_inbuf.data();
+
+    // Written as a sweep of y += h[k]*x[k:] so that the inner loop
+    // vectorizes without needing to reassociate a reduction.
+    for (size_t beg = 0; beg < n; beg += direct_tile) {
+        const size_t end = std::min(n, beg + direct_tile);
+        for (size_t k = 0; k < m_nkern; ++k) {
+            const real_t hk = h[k];
+            const real_t* xk = x + k;
+            for (size_t ind = beg; ind < end; ++ind) {
+                y[ind] += hk * xk[ind];
+            }
+        }
+    }
+
+    std::copy(x + n, x + n + nover, m_tail.begin());
+}
+
+template<typename Sink>
+void Convolver::finish(Sink& sink)
+{
+    if (m_nin == 0) {
+        reset();
+        return;
+    }
+    const size_t target = m_nin + m_nkern - 1;
+    LimitSink<Sink> limit{sink, target - m_nout};
+    static const size_t nzeros = 256;
+    static const real_t zeros[nzeros] = {0};
+    while (m_nout < target) {
+        const size_t want = m_method == Method::direct ? target - m_nout : m_nblock - m_npending;
+        feed(zeros, std::min(want, nzeros), limit);
+    }
+    reset();
+}
+
+void Convolver::flush(realseq_t& out)
+{
+    AppendSink sink{out};
+    finish(sink);
+}
+
+realseq_t Convolver::convolve(const realseq_t& wave, bool truncate)
+{
+    realseq_t out(truncate ? wave.size() : wave.size() + m_nkern - 1);
+    convolve(crealspan_t(wave), realspan_t(out));
+    return out;
+}
+
+void Convolver::convolve(crealspan_t wave, realspan_t out)
+{
+    reset();
+    SpanSink sink{out.data(), out.size()};
+    feed(wave.data(), wave.size(), sink);
+    finish(sink);
+    std::fill(sink.ptr, sink.ptr + sink.room, 0);
+}
@@ -0,0 +1,301 @@
+#include "WireCellUtil/DFT.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <fftw3.h>
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace WireCell;
+
+namespace {
+
+    enum Kind { kind_r2c, kind_c2c, kind_c2r };
+
+    // Everything which distinguishes one plan from another.
+    struct plan_key_t {
+        int n, howmany;
+        int istride, idist, ostride, odist;
+        int dir, kind;
+        bool inplace, aligned;
+
+        bool operator<(const plan_key_t& o) const {
+            return std::tie(n, howmany, istride, idist, ostride, odist, dir, kind, inplace, aligned)
+                < std::tie(o.n, o.howmany, o.istride, o.idist, o.ostride, o.odist, o.dir, o.kind, o.inplace, o.aligned);
+        }
+
+        // Number of elements spanned by the batch of input (output)
+        // sequences each of the given length.
+        size_t ispan(int len) const { return size_t(howmany-1)*idist + size_t(len-1)*istride + 1; }
+        size_t ospan(int len) const { return size_t(howmany-1)*odist + size_t(len-1)*ostride + 1; }
+    };
+
+    // Process-wide plan store.  The FFTW planner is not thread safe
+    // so all planner calls go through the one mutex.  Executing a
+    // plan via the new-array interface is thread safe.
+    class PlanCache {
+    public:
+        ~PlanCache() { clear(); }
+
+        fftwf_plan get(const plan_key_t& key) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_plans.find(key);
+            if (it != m_plans.end()) {
+                return it->second;
+            }
+            fftwf_plan plan = make(key);
+            m_plans[key] = plan;
+            return plan;
+        }
+
+        void effort(unsigned flags) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_effort = flags;
+        }
+
+        size_t size() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_plans.size();
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& it : m_plans) {
+                fftwf_destroy_plan(it.second);
+            }
+            m_plans.clear();
+        }
+
+        bool load(const std::string& filename) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+        }
+        bool save(const std::string& filename) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return fftwf_export_wisdom_to_filename(filename.c_str()) != 0;
+        }
+
+    private:
+
+        // Plan on scratch arrays as anything but FFTW_ESTIMATE
+        // scribbles over them.  Must be called with lock held.
+        fftwf_plan make(const plan_key_t& key) {
+            const int n = key.n;
+            const int nhalf = n/2+1;
+
+            unsigned flags = m_effort;
+            if (!key.aligned) {
+                flags |= FFTW_UNALIGNED;
+            }
+
+            fftwf_plan plan = nullptr;
+            if (key.kind == kind_c2c) {
+                fftwf_complex* in = fftwf_alloc_complex(std::max(key.ispan(n), key.ospan(n)));
+                fftwf_complex* out = key.inplace ? in : fftwf_alloc_complex(key.ospan(n));
+                plan = fftwf_plan_many_dft(1, &n, key.howmany,
+                                           in, nullptr, key.istride, key.idist,
+                                           out, nullptr, key.ostride, key.odist,
+                                           key.dir, flags);
+                if (out != in) { fftwf_free(out); }
+                fftwf_free(in);
+            }
+            else if (key.kind == kind_r2c) {
+                float* in = fftwf_alloc_real(key.ispan(n));
+                fftwf_complex* out = fftwf_alloc_complex(key.ospan(nhalf));
+                plan = fftwf_plan_many_dft_r2c(1, &n, key.howmany,
+                                               in, nullptr, key.istride, key.idist,
+                                               out, nullptr, key.ostride, key.odist,
+                                               flags);
+                fftwf_free(out);
+                fftwf_free(in);
+            }
+            else {
+                // Our caller's spectrum is const so we must not
+                // let FFTW use it as scratch.
+                fftwf_complex* in = fftwf_alloc_complex(key.ispan(nhalf));
+                float* out = fftwf_alloc_real(key.ospan(n));
+                plan = fftwf_plan_many_dft_c2r(1, &n, key.howmany,
+                                               in, nullptr, key.istride, key.idist,
+                                               out, nullptr, key.ostride, key.odist,
+                                               flags|FFTW_PRESERVE_INPUT);
+                fftwf_free(out);
+                fftwf_free(in);
+            }
+            if (!plan) {
+                THROW(ValueError() << errmsg{"DFT: failed to make FFTW plan for size " + std::to_string(n)});
+            }
+            return plan;
+        }
+
+        std::mutex m_mutex;
+        std::map<plan_key_t, fftwf_plan> m_plans;
+        unsigned m_effort{FFTW_ESTIMATE};
+    };
+
+    PlanCache& plan_cache() {
+        static PlanCache cache;
+        return cache;
+    }
+
+    bool is_aligned(const void* ptr) {
+        return fftwf_alignment_of((float*)ptr) == 0;
+    }
+
+    fftwf_complex* fftw_cast(const DFT::complex_t* ptr) {
+        return reinterpret_cast<fftwf_complex*>(const_cast<DFT::complex_t*>(ptr));
+    }
+
+    plan_key_t make_key(int kind, int dir, int n, int howmany,
+                        const void* in, const DFT::Layout& il,
+                        const void* out, const DFT::Layout& ol) {
+        return plan_key_t{n, howmany, il.stride, il.dist, ol.stride, ol.dist,
+                dir, kind, in == out, is_aligned(in) and is_aligned(out)};
+    }
+
+    // Call func(first, count) on nthreads contiguous sub-batches.
+    template<typename Func>
+    void split_batch(int howmany, int nthreads, Func func) {
+        nthreads = std::max(1, std::min(nthreads, howmany));
+        if (nthreads == 1) {
+            func(0, howmany);
+            return;
+        }
+        std::vector<std::thread> threads;
+        const int per = howmany / nthreads;
+        const int extra = howmany % nthreads;
+        int first = 0;
+        for (int ith=0; ith<nthreads; ++ith) {
+            const int count = per + (ith < extra ? 1 : 0);
+            threads.emplace_back(func, first, count);
+            first += count;
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    template<typename Val>
+    void normalize(Val* out, int n, int howmany, const DFT::Layout& ol) {
+        const float norm = 1.0/n;
+        for (int ib=0; ib<howmany; ++ib) {
+            Val* seq = out + size_t(ib)*ol.dist;
+            for (int ind=0; ind<n; ++ind) {
+                seq[size_t(ind)*ol.stride] *= norm;
+            }
+        }
+    }
+
+    void c2c_many(const DFT::complex_t* in, DFT::complex_t* out, int n, int howmany,
+                  const DFT::Layout& il, const DFT::Layout& ol, int dir, int nthreads) {
+        if (n <= 0 or howmany <= 0) { return; }
+        split_batch(howmany, nthreads, [&](int first, int count) {
+                const DFT::complex_t* bin = in + size_t(first)*il.dist;
+                DFT::complex_t* bout = out + size_t(first)*ol.dist;
+                auto plan = plan_cache().get(make_key(kind_c2c, dir, n, count, bin, il, bout, ol));
+                fftwf_execute_dft(plan, fftw_cast(bin), fftw_cast(bout));
+                if (dir == FFTW_BACKWARD) {
+                    normalize(bout, n, count, ol);
+                }
+            });
+    }
+}
+
+
+void DFT::set_effort(DFT::Effort effort)
+{
+    unsigned flags = FFTW_ESTIMATE;
+    if (effort == Effort::measure) {
+        flags = FFTW_MEASURE;
+    }
+    else if (effort == Effort::patient) {
+        flags = FFTW_PATIENT;
+    }
+    plan_cache().effort(flags);
+}
+
+void DFT::fwd_r2c(const float* in, DFT::complex_t* out, int n)
+{
+    if (n <= 0) { return; }
+    fwd_r2c_many(in, out, n, 1, Layout{1,n}, Layout{1,n});
+
+    // FFTW gives the half spectrum, fill the rest by symmetry.
+    for (int ind = n/2+1; ind < n; ++ind) {
+        out[ind] = std::conj(out[n-ind]);
+    }
+}
+
+void DFT::fwd_c2c(const DFT::complex_t* in, DFT::complex_t* out, int n)
+{
+    c2c_many(in, out, n, 1, Layout{1,n}, Layout{1,n}, FFTW_FORWARD, 1);
+}
+
+void DFT::inv_c2c(const DFT::complex_t* in, DFT::complex_t* out, int n)
+{
+    inv_c2c_many(in, out, n, 1, Layout{1,n}, Layout{1,n});
+}
+
+void DFT::inv_c2r(const DFT::complex_t* in, float* out, int n)
+{
+    inv_c2r_many(in, out, n, 1, Layout{1,n}, Layout{1,n});
+}
+
+void DFT::fwd_r2c_many(const float* in, DFT::complex_t* out, int n, int howmany,
+                       const DFT::Layout& il, const DFT::Layout& ol, int nthreads)
+{
+    if (n <= 0 or howmany <= 0) { return; }
+    split_batch(howmany, nthreads, [&](int first, int count) {
+            const float* bin = in + size_t(first)*il.dist;
+            DFT::complex_t* bout = out + size_t(first)*ol.dist;
+            auto plan = plan_cache().get(make_key(kind_r2c, FFTW_FORWARD, n, count, bin, il, bout, ol));
+            fftwf_execute_dft_r2c(plan, const_cast<float*>(bin), fftw_cast(bout));
+        });
+}
+
+void DFT::fwd_c2c_many(const DFT::complex_t* in, DFT::complex_t* out, int n, int howmany,
+                       const DFT::Layout& il, const DFT::Layout& ol, int nthreads)
+{
+    c2c_many(in, out, n, howmany, il, ol, FFTW_FORWARD, nthreads);
+}
+
+void DFT::inv_c2c_many(const DFT::complex_t* in, DFT::complex_t* out, int n, int howmany,
+                       const DFT::Layout& il, const DFT::Layout& ol, int nthreads)
+{
+    c2c_many(in, out, n, howmany, il, ol, FFTW_BACKWARD, nthreads);
+}
+
+void DFT::inv_c2r_many(const DFT::complex_t* in, float* out, int n, int howmany,
+                       const DFT::Layout& il, const DFT::Layout& ol, int nthreads)
+{
+    if (n <= 0 or howmany <= 0) { return; }
+    split_batch(howmany, nthreads, [&](int first, int count) {
+            const DFT::complex_t* bin = in + size_t(first)*il.dist;
+            float* bout = out + size_t(first)*ol.dist;
+            auto plan = plan_cache().get(make_key(kind_c2r, FFTW_BACKWARD, n, count, bin, il, bout, ol));
+            fftwf_execute_dft_c2r(plan, fftw_cast(bin), bout);
+            normalize(bout, n, count, ol);
+        });
+}
+
+size_t DFT::nplans()
+{
+    return plan_cache().size();
+}
+
+void DFT::clear_plans()
+{
+    plan_cache().clear();
+}
+
+bool DFT::load_wisdom(const std::string& filename)
+{
+    return plan_cache().load(filename);
+}
+
+bool DFT::save_wisdom(const std::string& filename)
+{
+    return plan_cache().save(filename);
+}
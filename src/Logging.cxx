@@ -3,11 +3,138 @@
 #include "spdlog/sinks/stdout_sinks.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/null_sink.h"
+#include "spdlog/sinks/base_sink.h"
+#include "spdlog/async.h"
 
 #include <vector>
+#include <mutex>
 
 using namespace WireCell;
 
+namespace {
+
+    // A sink which passes messages on to other sinks.
+    class wrap_sink {
+    public:
+        virtual ~wrap_sink() {}
+        virtual std::vector<spdlog::sink_ptr>& inner() = 0;
+    };
+
+    // Queue messages to an async logger holding the real sinks.
+    // Messages come preformatted so the async logger only copies.
+    class async_sink : public spdlog::sinks::sink, public wrap_sink {
+        std::shared_ptr<spdlog::async_logger> m_back;
+    public:
+        async_sink(std::shared_ptr<spdlog::async_logger> back) : m_back(back) {}
+        void log(const spdlog::details::log_msg& msg) {
+            m_back->log(msg.source, msg.level, msg.payload);
+        }
+        void flush() { m_back->flush(); }
+        void set_pattern(const std::string& pattern) { m_back->set_pattern(pattern); }
+        void set_formatter(std::unique_ptr<spdlog::formatter> f) { m_back->set_formatter(std::move(f)); }
+        std::vector<spdlog::sink_ptr>& inner() { return m_back->sinks(); }
+    };
+
+    // Drop messages beyond count per period.  The base sink's mutex
+    // guards the count and period.
+    class rate_limit_sink : public spdlog::sinks::base_sink<std::mutex>, public wrap_sink {
+        std::vector<spdlog::sink_ptr> m_sinks;
+        size_t m_limit{0}, m_count{0}, m_dropped{0};
+        int64_t m_period{0}, m_start{0}; // ns
+    public:
+        rate_limit_sink(const std::vector<spdlog::sink_ptr>& sinks) : m_sinks(sinks) {}
+
+        void set_limit(size_t count, double seconds) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            m_limit = count;
+            m_period = int64_t(seconds*1e9);
+        }
+
+        std::vector<spdlog::sink_ptr>& inner() { return m_sinks; }
+
+    protected:
+        void sink_it_(const spdlog::details::log_msg& msg) {
+            const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                msg.time.time_since_epoch()).count();
+            if (now - m_start >= m_period) {
+                m_start = now;
+                m_count = 0;
+                if (m_dropped) {
+                    const std::string note = "dropped " + std::to_string(m_dropped)
+                        + " messages over rate limit";
+                    m_dropped = 0;
+                    spdlog::details::log_msg nmsg(msg.logger_name, spdlog::level::warn, note);
+                    pass(nmsg);
+                }
+            }
+            if (++m_count > m_limit) {
+                ++m_dropped;
+                return;
+            }
+            pass(msg);
+        }
+        void pass(const spdlog::details::log_msg& msg) {
+            for (auto& s : m_sinks) {
+                if (s->should_log(msg.level)) {
+                    s->log(msg);
+                }
+            }
+        }
+        void flush_() {
+            for (auto& s : m_sinks) { s->flush(); }
+        }
+        void set_pattern_(const std::string& pattern) {
+            for (auto& s : m_sinks) { s->set_pattern(pattern); }
+        }
+        void set_formatter_(std::unique_ptr<spdlog::formatter> f) {
+            for (auto& s : m_sinks) { s->set_formatter(f->clone()); }
+        }
+    };
+
+    struct AsyncConfig {
+        std::mutex mutex;
+        std::shared_ptr<spdlog::details::thread_pool> pool;
+        spdlog::async_overflow_policy policy{spdlog::async_overflow_policy::block};
+    };
+    AsyncConfig& async_config()
+    {
+        static AsyncConfig config;
+        return config;
+    }
+}
+
+// The sinks which do the writing, found below any wrapping sinks.
+static
+std::vector<spdlog::sink_ptr>& real_sinks(Log::logptr_t l)
+{
+    auto* sv = &l->sinks();
+    while (sv->size() == 1) {
+        auto w = std::dynamic_pointer_cast<wrap_sink>(sv->front());
+        if (!w) { break; }
+        sv = &w->inner();
+    }
+    return *sv;
+}
+
+// Move a logger's sinks, below any rate limit, to an async logger.
+static
+void make_async(Log::logptr_t l, const AsyncConfig& config)
+{
+    auto* sv = &l->sinks();
+    while (sv->size() == 1) {
+        auto w = std::dynamic_pointer_cast<rate_limit_sink>(sv->front());
+        if (!w) { break; }
+        sv = &w->inner();
+    }
+    if (sv->size() == 1 and std::dynamic_pointer_cast<async_sink>(sv->front())) {
+        return;
+    }
+    auto back = std::make_shared<spdlog::async_logger>(l->name(), sv->begin(), sv->end(),
+                                                       config.pool, config.policy);
+    back->set_level(spdlog::level::trace); // l filters
+    sv->assign(1, std::make_shared<async_sink>(back));
+}
+
 
 static
 Log::logptr_t wct_base_logger()
@@ -37,7 +164,7 @@ void Log::add_sink(Log::sinkptr_t sink, std::string level)
     if (!level.empty()) {
         sink->set_level(spdlog::level::from_str(level));
     }
-    wct_base_logger()->sinks().push_back(sink);
+    real_sinks(wct_base_logger()).push_back(sink);
 }
 void Log::add_file(std::string filename, std::string level)
 {
@@ -73,7 +200,7 @@ Log::logptr_t Log::logger(std::string name)
     wct_base_logger();          // make sure base logger is installed.
     auto l = spdlog::get(name);
     if (!l) {
-        auto& sinks = wct_base_logger()->sinks();
+        auto& sinks = real_sinks(wct_base_logger());
         l = std::make_shared<spdlog::logger>(name,  sinks.begin(), sinks.end());
 
         // peak under the hood of spdlog.  We want shared loggers to
@@ -82,6 +209,12 @@ Log::logptr_t Log::logger(std::string name)
         if (!spdlog::get(name)) {
             spdlog::register_logger(l);
         }
+
+        auto& config = async_config();
+        std::lock_guard<std::mutex> lock(config.mutex);
+        if (config.pool) {
+            make_async(l, config);
+        }
     }
 
     return l;
@@ -105,3 +238,48 @@ void Log::set_pattern(std::string pattern, std::string which)
     }
     logger(which)->set_pattern(pattern);
 }
+
+void Log::set_async(size_t queue_size, size_t nthreads, bool block)
+{
+    wct_base_logger();
+    auto& config = async_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    if (config.pool) {
+        return;
+    }
+    config.pool = std::make_shared<spdlog::details::thread_pool>(queue_size, nthreads);
+    config.policy = block ? spdlog::async_overflow_policy::block
+        : spdlog::async_overflow_policy::overrun_oldest;
+    spdlog::apply_all([&](Log::logptr_t l) { make_async(l, config); });
+}
+
+bool Log::is_async()
+{
+    auto& config = async_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    return config.pool != nullptr;
+}
+
+void Log::set_rate_limit(std::string which, size_t count, double seconds)
+{
+    auto l = logger(which);
+    auto& sv = l->sinks();
+    std::shared_ptr<rate_limit_sink> rl;
+    if (sv.size() == 1) {
+        rl = std::dynamic_pointer_cast<rate_limit_sink>(sv.front());
+    }
+    if (!count) {
+        if (rl) {
+            auto inner = rl->inner();
+            sv = inner;
+        }
+        return;
+    }
+    if (rl) {
+        rl->set_limit(count, seconds);
+        return;
+    }
+    rl = std::make_shared<rate_limit_sink>(sv);
+    rl->set_limit(count, seconds);
+    sv.assign(1, rl);
+}
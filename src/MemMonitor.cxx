@@ -0,0 +1,220 @@
+#include "WireCellUtil/MemMonitor.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace WireCell;
+
+// Constant initialized so it is usable from operator new at any time.
+static thread_local MemCount::Counts t_counts{0, 0, 0};
+static std::atomic<bool> g_enabled{false};
+
+MemCount::Counts& MemCount::thread_counts()
+{
+    return t_counts;
+}
+
+bool MemCount::enabled()
+{
+    return g_enabled;
+}
+
+void MemCount::set_enabled()
+{
+    g_enabled = true;
+}
+
+
+MemMonitor::Scope::Scope(MemMonitor* mon, size_t index)
+    : m_mon(mon), m_index(index), m_counts(MemCount::thread_counts())
+{
+}
+
+MemMonitor::Scope::Scope(Scope&& other)
+    : m_mon(other.m_mon), m_index(other.m_index), m_counts(other.m_counts)
+{
+    other.m_mon = nullptr;
+}
+
+MemMonitor::Scope::~Scope()
+{
+    close();
+}
+
+void MemMonitor::Scope::close()
+{
+    if (m_mon) {
+        m_mon->close(m_index, m_counts);
+        m_mon = nullptr;
+    }
+}
+
+
+MemMonitor::MemMonitor(double period, bool rollup)
+    : m_period(period)
+    , m_rollup(rollup)
+    , m_t0(std::chrono::steady_clock::now())
+    , m_stopping(false)
+    , m_peak(0)
+{
+    record(take());
+    m_thread = std::thread(&MemMonitor::run, this);
+}
+
+MemMonitor::~MemMonitor()
+{
+    stop();
+}
+
+void MemMonitor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void MemMonitor::run()
+{
+    const auto period = std::chrono::duration<double>(m_period);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_cond.wait_for(lock, period, [this]{ return m_stopping; })) {
+            break;
+        }
+        // Read /proc without holding the lock.
+        lock.unlock();
+        record(take());
+        lock.lock();
+    }
+}
+
+MemMonitor::Sample MemMonitor::take()
+{
+    Sample s;
+    s.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_t0).count();
+    const auto sm = memusage_statm();
+    s.size = sm.size;
+    s.resident = sm.resident;
+    s.shared = sm.shared;
+    s.pss = s.swap = -1;
+    if (m_rollup) {
+        const auto ru = memusage_rollup();
+        s.pss = ru.pss;
+        s.swap = ru.swap;
+    }
+    return s;
+}
+
+void MemMonitor::record(const Sample& s)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samples.push_back(s);
+    m_peak = std::max(m_peak, s.resident);
+    for (size_t ind : m_open) {
+        auto& ss = m_scopes[ind];
+        ss.peak_resident = std::max(ss.peak_resident, s.resident);
+    }
+}
+
+MemMonitor::Sample MemMonitor::sample()
+{
+    Sample s = take();
+    record(s);
+    return s;
+}
+
+MemMonitor::Scope MemMonitor::scope(const std::string& name)
+{
+    Sample s = take();
+    size_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        index = m_scopes.size();
+        m_scopes.push_back(ScopeStats{name, s.time, -1, s.resident, -1, s.resident, {0, 0, 0}});
+        m_open.push_back(index);
+    }
+    record(s);
+    return Scope(this, index);
+}
+
+void MemMonitor::close(size_t index, const MemCount::Counts& start)
+{
+    const MemCount::Counts& now = MemCount::thread_counts();
+    const MemCount::Counts allocs{now.nnew - start.nnew, now.ndelete - start.ndelete,
+                                  now.bytes - start.bytes};
+    Sample s = take();
+    record(s);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& ss = m_scopes[index];
+    ss.stop = s.time;
+    ss.stop_resident = s.resident;
+    ss.allocs = allocs;
+    m_open.erase(std::remove(m_open.begin(), m_open.end(), index), m_open.end());
+}
+
+double MemMonitor::peak_resident() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+std::vector<MemMonitor::Sample> MemMonitor::samples() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_samples;
+}
+
+std::vector<MemMonitor::ScopeStats> MemMonitor::scopes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scopes;
+}
+
+Json::Value MemMonitor::to_json() const
+{
+    const auto ss = samples();
+    const auto scs = scopes();
+
+    Json::Value ret;
+    ret["period"] = m_period;
+    ret["peak_resident"] = peak_resident();
+    ret["kernel_peak_resident"] = memusage_peak();
+    ret["memcount"] = MemCount::enabled();
+
+    // The time series is column-wise to keep it compact.
+    Json::Value jss(Json::objectValue);
+    for (const char* key : {"time", "size", "resident", "shared", "pss", "swap"}) {
+        jss[key] = Json::Value(Json::arrayValue);
+    }
+    for (const auto& s : ss) {
+        jss["time"].append(s.time);
+        jss["size"].append(s.size);
+        jss["resident"].append(s.resident);
+        jss["shared"].append(s.shared);
+        jss["pss"].append(s.pss);
+        jss["swap"].append(s.swap);
+    }
+    ret["samples"] = jss;
+
+    Json::Value jscs(Json::arrayValue);
+    for (const auto& sc : scs) {
+        Json::Value j;
+        j["name"] = sc.name;
+        j["start"] = sc.start;
+        j["stop"] = sc.stop;
+        j["start_resident"] = sc.start_resident;
+        j["stop_resident"] = sc.stop_resident;
+        j["peak_resident"] = sc.peak_resident;
+        j["nnew"] = Json::UInt64(sc.allocs.nnew);
+        j["ndelete"] = Json::UInt64(sc.allocs.ndelete);
+        j["bytes"] = Json::UInt64(sc.allocs.bytes);
+        jscs.append(j);
+    }
+    ret["scopes"] = jscs;
+    return ret;
+}
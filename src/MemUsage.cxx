@@ -1,65 +1,96 @@
 #include "WireCellUtil/MemUsage.h"
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <cstdlib>
 #include <sstream>
 
 using namespace std;
 using namespace WireCell;
 
-static double memusage_linux_resident() {
-    int tSize = 0, resident = 0, share = 0;
-    ifstream buffer("/proc/self/statm");
-    buffer >> tSize >> resident >> share;
-    buffer.close();
-
-    long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024; // in case x86-64 is configured to use 2MB pages
-    double rss = resident * page_size_kb;
-    return rss;
-}
-
-static double memusage_linux_shared() {
-    int tSize = 0, resident = 0, share = 0;
-    ifstream buffer("/proc/self/statm");
-    buffer >> tSize >> resident >> share;
-    buffer.close();
-
-    long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024; // in case x86-64 is configured to use 2MB pages
-    double shm = share * page_size_kb;
-    return shm;
+// Read a small /proc file whole without the overhead of a stream.
+static std::string read_proc(const char* path)
+{
+    std::string ret;
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return ret;
+    }
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        ret.append(buf, n);
+    }
+    ::close(fd);
+    return ret;
 }
 
-static double memusage_linux_size() {
-    int tSize = 0, resident = 0, share = 0;
-    ifstream buffer("/proc/self/statm");
-    buffer >> tSize >> resident >> share;
-    buffer.close();
-
-    long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024; // in case x86-64 is configured to use 2MB pages
-    double siz = tSize * page_size_kb;
-    return siz;
+WireCell::memusage_statm_t WireCell::memusage_statm()
+{
+    memusage_statm_t ret{-1, -1, -1};
+#ifdef __linux__
+    const std::string text = read_proc("/proc/self/statm");
+    if (text.empty()) {
+        return ret;
+    }
+    const char* ptr = text.c_str();
+    char* end = nullptr;
+    const long tsize = strtol(ptr, &end, 10);
+    const long resident = strtol(end, &end, 10);
+    const long share = strtol(end, &end, 10);
+
+    const double page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024; // in case x86-64 is configured to use 2MB pages
+    ret.size = tsize * page_size_kb;
+    ret.resident = resident * page_size_kb;
+    ret.shared = share * page_size_kb;
+#endif
+    return ret;
 }
 
-
-double WireCell::memusage_resident() {
+double WireCell::memusage_peak()
+{
 #ifdef __linux__
-    return memusage_linux_resident();
+    const std::string text = read_proc("/proc/self/status");
+    const size_t pos = text.find("VmHWM:");
+    if (pos != std::string::npos) {
+        return strtod(text.c_str() + pos + 6, nullptr);
+    }
 #endif
     return -1;
 }
 
-double WireCell::memusage_shared()
+WireCell::memusage_rollup_t WireCell::memusage_rollup()
 {
+    memusage_rollup_t ret{-1, -1, -1};
 #ifdef __linux__
-    return memusage_linux_shared();
+    const std::string text = read_proc("/proc/self/smaps_rollup");
+    auto get = [&](const std::string& key) {
+        const size_t pos = text.find("\n" + key + ":");
+        if (pos == std::string::npos) {
+            return -1.0;
+        }
+        return strtod(text.c_str() + pos + key.size() + 2, nullptr);
+    };
+    ret.rss = get("Rss");
+    ret.pss = get("Pss");
+    ret.swap = get("Swap");
 #endif
-    return -1;
+    return ret;
+}
+
+double WireCell::memusage_resident()
+{
+    return memusage_statm().resident;
+}
+
+double WireCell::memusage_shared()
+{
+    return memusage_statm().shared;
 }
+
 double WireCell::memusage_size()
 {
-#ifdef __linux__
-    return memusage_linux_size();
-#endif
-    return -1;
+    return memusage_statm().size;
 }
 
 
@@ -74,7 +105,8 @@ MemUsage::~MemUsage()
 
 MemUsage::memusage MemUsage::current() const
 {
-    return memusage(memusage_size(), memusage_resident());
+    const auto sm = memusage_statm();
+    return memusage(sm.size, sm.resident);
 }
 void MemUsage::push(const std::string& msg, MemUsage::memusage mu)
 {
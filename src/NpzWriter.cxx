@@ -0,0 +1,381 @@
+#include "WireCellUtil/NpzWriter.h"
+#include "WireCellUtil/Logging.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace WireCell;
+using cnpy::operator+=;
+
+using spdlog::error;
+
+namespace {
+
+    // Data is deflated (or just checksummed) in blocks of this many
+    // bytes, each an independent job.
+    const size_t block_size = 1<<20;
+
+    const uint32_t saturated = 0xffffffff;
+
+    // Call func(ind) for ind in [0,njobs) over nthreads threads.
+    template<typename Func>
+    void run_jobs(size_t njobs, int nthreads, Func func) {
+        const size_t nth = std::max<size_t>(1, std::min<size_t>(nthreads, njobs));
+        if (nth == 1) {
+            for (size_t ind=0; ind<njobs; ++ind) {
+                func(ind);
+            }
+            return;
+        }
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t ind = next++; ind < njobs; ind = next++) {
+                func(ind);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t ith=0; ith<nth; ++ith) {
+            threads.emplace_back(worker);
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    // Deflate one block as a raw stream ending in a sync flush so
+    // that blocks may be concatenated.  A final empty block is
+    // added at the end of the member.
+    bool deflate_block(const char* data, size_t size, int level, std::vector<char>& out) {
+        z_stream zs;
+        zs.zalloc = Z_NULL;
+        zs.zfree = Z_NULL;
+        zs.opaque = Z_NULL;
+        if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        out.resize(deflateBound(&zs, size) + 16);
+        zs.next_in = (Bytef*)data;
+        zs.avail_in = size;
+        zs.next_out = (Bytef*)out.data();
+        zs.avail_out = out.size();
+        int rc = deflate(&zs, Z_SYNC_FLUSH);
+        while (rc == Z_OK && zs.avail_out == 0) {
+            const size_t have = zs.total_out;
+            out.resize(2*out.size());
+            zs.next_out = (Bytef*)(out.data() + have);
+            zs.avail_out = out.size() - have;
+            rc = deflate(&zs, Z_SYNC_FLUSH);
+        }
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return rc == Z_OK || rc == Z_BUF_ERROR;
+    }
+}
+
+Numpy::NpzWriter::NpzWriter(const std::string& filename, Compression compression,
+                            int nthreads, int level)
+    : m_filename(filename)
+    , m_out(filename, std::ios::binary | std::ios::trunc)
+    , m_compression(compression)
+    , m_nthreads(std::max(1, nthreads))
+    , m_level(level)
+    , m_pos(0)
+    , m_open(false)
+    , m_word_size(0)
+    , m_rowsize(0)
+    , m_remaining(0)
+{
+    if (!m_out) {
+        THROW(IOError() << errmsg{"NpzWriter: failed to open " + filename});
+    }
+}
+
+Numpy::NpzWriter::~NpzWriter()
+{
+    if (!m_out.is_open()) {
+        return;
+    }
+    try {
+        m_open = false;         // drop any unfinished array
+        close();
+    }
+    catch (...) {
+        error("NpzWriter: failed to close {}", m_filename);
+    }
+}
+
+void Numpy::NpzWriter::put(const std::vector<char>& bytes)
+{
+    m_out.write(bytes.data(), bytes.size());
+    m_pos += bytes.size();
+}
+
+void Numpy::NpzWriter::start(const std::string& name, const std::vector<char>& header,
+                             size_t word_size, size_t rowsize, size_t nvals)
+{
+    if (!m_out.is_open()) {
+        THROW(ValueError() << errmsg{"NpzWriter: write after close to " + m_filename});
+    }
+    if (m_open) {
+        THROW(ValueError() << errmsg{"NpzWriter: array " + m_cur.name + " not ended before " + name});
+    }
+    const std::string fname = name + ".npy";
+    const bool stored = m_compression == Compression::stored;
+
+    m_cur.name = name;
+    m_cur.method = stored ? 0 : 8;
+    m_cur.crc = 0;
+    m_cur.csize = 0;
+    m_cur.usize = header.size() + uint64_t(nvals)*word_size;
+    m_cur.offset = m_pos;
+
+    // Sizes go in a zip64 extra field as they may be large and the
+    // compressed size is patched in by end().  Stored members are
+    // padded, as by npz_save(), to leave the array data aligned.
+    size_t extra_len = 20;
+    size_t pad = 0;
+    if (stored) {
+        const size_t align = 16;
+        pad = 6;
+        pad += (align - (m_pos + 30 + fname.size() + extra_len + pad) % align) % align;
+        extra_len += pad;
+    }
+
+    std::vector<char> local;
+    local += (uint32_t) 0x04034b50;
+    local += (uint16_t) 45;     // version needed, for zip64
+    local += (uint16_t) 0;      // flags
+    local += (uint16_t) m_cur.method;
+    local += (uint16_t) 0;      // time
+    local += (uint16_t) 0;      // date
+    local += (uint32_t) 0;      // crc, patched by end()
+    local += (uint32_t) saturated; // compressed size
+    local += (uint32_t) saturated; // uncompressed size
+    local += (uint16_t) fname.size();
+    local += (uint16_t) extra_len;
+    local += fname;
+    local += (uint16_t) 0x0001; // zip64
+    local += (uint16_t) 16;
+    local += (uint64_t) m_cur.usize;
+    local += (uint64_t) 0;      // compressed size, patched by end()
+    if (pad) {
+        local += (uint16_t) 0xd935; // alignment
+        local += (uint16_t) (pad - 4);
+        local += (uint16_t) 16;
+        local.resize(local.size() + pad - 6, 0);
+    }
+    put(local);
+
+    m_open = true;
+    m_pending.clear();          // of any dropped array
+    m_word_size = word_size;
+    m_rowsize = rowsize;
+    m_remaining = m_cur.usize;
+    write(header.data(), header.size());
+}
+
+void Numpy::NpzWriter::check_word(size_t word_size)
+{
+    if (!m_open) {
+        THROW(ValueError() << errmsg{"NpzWriter: append without begin to " + m_filename});
+    }
+    if (word_size != m_word_size) {
+        THROW(ValueError() << errmsg{"NpzWriter: append of wrong type to " + m_cur.name});
+    }
+}
+
+void Numpy::NpzWriter::write(const char* data, size_t size)
+{
+    if (size > m_remaining) {
+        THROW(ValueError() << errmsg{"NpzWriter: too much data for " + m_cur.name});
+    }
+    m_remaining -= size;
+
+    // Whole blocks go straight to the jobs, bounding the deflated
+    // output held at once.  Smaller pieces, as from appends of a few
+    // rows, are gathered into a block first so each is not deflated
+    // and flushed on its own.
+    const size_t batch = block_size * 4 * m_nthreads;
+    while (size) {
+        if (m_pending.empty() && size >= block_size) {
+            const size_t len = std::min(size, batch) / block_size * block_size;
+            write_batch(data, len);
+            data += len;
+            size -= len;
+            continue;
+        }
+        const size_t len = std::min(size, block_size - m_pending.size());
+        m_pending.insert(m_pending.end(), data, data + len);
+        data += len;
+        size -= len;
+        if (m_pending.size() == block_size) {
+            flush();
+        }
+    }
+}
+
+void Numpy::NpzWriter::flush()
+{
+    if (m_pending.empty()) {
+        return;
+    }
+    write_batch(m_pending.data(), m_pending.size());
+    m_pending.clear();
+}
+
+void Numpy::NpzWriter::write_batch(const char* data, size_t size)
+{
+    const size_t nblocks = (size + block_size - 1) / block_size;
+    std::vector<uint32_t> crcs(nblocks);
+    const bool stored = m_cur.method == 0;
+    if (!stored && m_blocks.size() < nblocks) {
+        m_blocks.resize(nblocks);
+    }
+    std::atomic<bool> ok{true};
+    run_jobs(nblocks, m_nthreads, [&](size_t ib) {
+            const char* beg = data + ib*block_size;
+            const size_t len = std::min(block_size, size - ib*block_size);
+            crcs[ib] = crc32(0L, (const Bytef*)beg, len);
+            if (!stored && !deflate_block(beg, len, m_level, m_blocks[ib])) {
+                ok = false;
+            }
+        });
+    if (!ok) {
+        THROW(IOError() << errmsg{"NpzWriter: failed to deflate " + m_cur.name});
+    }
+
+    for (size_t ib=0; ib<nblocks; ++ib) {
+        const size_t len = std::min(block_size, size - ib*block_size);
+        m_cur.crc = crc32_combine(m_cur.crc, crcs[ib], len);
+        if (!stored) {
+            put(m_blocks[ib]);
+            m_cur.csize += m_blocks[ib].size();
+        }
+    }
+    if (stored) {
+        m_out.write(data, size);
+        m_pos += size;
+        m_cur.csize += size;
+    }
+    if (!m_out) {
+        THROW(IOError() << errmsg{"NpzWriter: failed to write " + m_filename});
+    }
+}
+
+void Numpy::NpzWriter::end()
+{
+    if (!m_open) {
+        THROW(ValueError() << errmsg{"NpzWriter: end without begin to " + m_filename});
+    }
+    if (m_remaining) {
+        THROW(ValueError() << errmsg{"NpzWriter: array " + m_cur.name + " ended before it was filled"});
+    }
+    flush();
+    if (m_cur.method == 8) {
+        put({0x03, 0x00});      // final, empty, static block
+        m_cur.csize += 2;
+    }
+
+    std::vector<char> bytes;
+    bytes += (uint32_t) m_cur.crc;
+    m_out.seekp(m_cur.offset + 14);
+    m_out.write(bytes.data(), bytes.size());
+    bytes.clear();
+    bytes += (uint64_t) m_cur.csize;
+    // after the name (.npy included), zip64 id and size and usize
+    m_out.seekp(m_cur.offset + 30 + m_cur.name.size() + 4 + 4 + 8);
+    m_out.write(bytes.data(), bytes.size());
+    m_out.seekp(m_pos);
+    if (!m_out) {
+        THROW(IOError() << errmsg{"NpzWriter: failed to write " + m_filename});
+    }
+
+    m_members.push_back(m_cur);
+    m_open = false;
+}
+
+void Numpy::NpzWriter::close()
+{
+    if (!m_out.is_open()) {
+        return;
+    }
+    if (m_open) {
+        THROW(ValueError() << errmsg{"NpzWriter: array " + m_cur.name + " not ended before close"});
+    }
+
+    const uint64_t cdoffset = m_pos;
+    std::vector<char> cd;
+    for (const auto& mem : m_members) {
+        const std::string fname = mem.name + ".npy";
+        std::vector<char> extra;
+        for (uint64_t val : {mem.usize, mem.csize, mem.offset}) {
+            if (val >= saturated) {
+                extra += (uint64_t) val;
+            }
+        }
+        if (!extra.empty()) {
+            std::vector<char> head;
+            head += (uint16_t) 0x0001;
+            head += (uint16_t) extra.size();
+            extra.insert(extra.begin(), head.begin(), head.end());
+        }
+        cd += (uint32_t) 0x02014b50;
+        cd += (uint16_t) 45;    // version made by
+        cd += (uint16_t) 45;    // version needed
+        cd += (uint16_t) 0;
+        cd += (uint16_t) mem.method;
+        cd += (uint16_t) 0;
+        cd += (uint16_t) 0;
+        cd += (uint32_t) mem.crc;
+        cd += (uint32_t) std::min<uint64_t>(mem.csize, saturated);
+        cd += (uint32_t) std::min<uint64_t>(mem.usize, saturated);
+        cd += (uint16_t) fname.size();
+        cd += (uint16_t) extra.size();
+        cd += (uint16_t) 0;     // comment
+        cd += (uint16_t) 0;     // disk
+        cd += (uint16_t) 0;     // internal attributes
+        cd += (uint32_t) 0;     // external attributes
+        cd += (uint32_t) std::min<uint64_t>(mem.offset, saturated);
+        cd += fname;
+        cd.insert(cd.end(), extra.begin(), extra.end());
+    }
+    put(cd);
+
+    const uint64_t nrecs = m_members.size();
+    const uint64_t cdsize = cd.size();
+    std::vector<char> tail;
+    if (nrecs >= 0xffff || cdsize >= saturated || cdoffset >= saturated) {
+        const uint64_t z64 = m_pos;
+        tail += (uint32_t) 0x06064b50;
+        tail += (uint64_t) 44;
+        tail += (uint16_t) 45;
+        tail += (uint16_t) 45;
+        tail += (uint32_t) 0;
+        tail += (uint32_t) 0;
+        tail += (uint64_t) nrecs;
+        tail += (uint64_t) nrecs;
+        tail += (uint64_t) cdsize;
+        tail += (uint64_t) cdoffset;
+        tail += (uint32_t) 0x07064b50;
+        tail += (uint32_t) 0;
+        tail += (uint64_t) z64;
+        tail += (uint32_t) 1;
+    }
+    tail += (uint32_t) 0x06054b50;
+    tail += (uint16_t) 0;
+    tail += (uint16_t) 0;
+    tail += (uint16_t) std::min<uint64_t>(nrecs, 0xffff);
+    tail += (uint16_t) std::min<uint64_t>(nrecs, 0xffff);
+    tail += (uint32_t) std::min<uint64_t>(cdsize, saturated);
+    tail += (uint32_t) std::min<uint64_t>(cdoffset, saturated);
+    tail += (uint16_t) 0;
+    put(tail);
+
+    m_out.close();
+    if (m_out.fail()) {
+        THROW(IOError() << errmsg{"NpzWriter: failed to write " + m_filename});
+    }
+}
@@ -0,0 +1,339 @@
+#include "WireCellUtil/Percentile.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace WireCell;
+using namespace WireCell::Waveform;
+
+namespace {
+
+    // Number of bins of each locating pass.  Each pass narrows the
+    // range of values holding the wanted rank to one bin until few
+    // enough samples remain to copy and select.
+    const size_t select_nbins = 256;
+    const int select_maxpass = 8;
+
+    // Copy the samples in [lo,hi], or all if all, and select the one
+    // of rank k among them.
+    real_t select_copy(const real_t* data, size_t n, size_t stride,
+                       real_t lo, real_t hi, bool all, size_t k)
+    {
+        static thread_local std::vector<real_t> cands;
+        cands.clear();
+        for (size_t ind=0; ind<n; ++ind) {
+            const real_t val = data[ind*stride];
+            if (all or (lo <= val and val <= hi)) {
+                cands.push_back(val);
+            }
+        }
+        auto mid = cands.begin() + std::min(k, cands.size()-1);
+        std::nth_element(cands.begin(), mid, cands.end());
+        return *mid;
+    }
+
+    // Exact selection of the sample of rank floor(n*p) among data[i*stride].
+    real_t select_strided(const real_t* data, size_t n, size_t stride, real_t percentage)
+    {
+        if (n == 0) {
+            return 0;
+        }
+        size_t rank = n*percentage;
+        rank = std::min(rank, n-1);
+
+        real_t lo = data[0], hi = data[0];
+        bool finite = true;
+        for (size_t ind=0; ind<n; ++ind) {
+            const real_t val = data[ind*stride];
+            finite = finite and std::isfinite(val);
+            lo = std::min(lo, val);
+            hi = std::max(hi, val);
+        }
+        if (!finite) {
+            return select_copy(data, n, stride, lo, hi, true, rank);
+        }
+
+        // The wanted sample is among the count samples in [lo,hi]
+        // and has rank rank-before among them.  Another pass costs
+        // about as much as copying and selecting a quarter of the
+        // samples.
+        size_t before = 0, count = n;
+        const size_t small = std::max(select_nbins, n/4);
+        for (int pass=0; pass<select_maxpass; ++pass) {
+            if (lo == hi) {
+                return lo;
+            }
+            if (count <= small) {
+                break;
+            }
+            // Shrink the scale a little so hi lands in the last bin.
+            const real_t scale = 0.999f * select_nbins / (hi - lo);
+            if (!(std::isfinite(scale) and scale > 0)) {
+                break;
+            }
+            auto binof = [&](real_t val) {
+                const int bin = (val - lo) * scale;
+                return std::max(0, std::min(int(select_nbins)-1, bin));
+            };
+
+            // Bins are monotonic in value so [bmin,bmax] of the
+            // chosen bin holds exactly its samples.
+            size_t hist[select_nbins] = {0};
+            real_t bmin[select_nbins], bmax[select_nbins];
+            std::fill(bmin, bmin+select_nbins, hi);
+            std::fill(bmax, bmax+select_nbins, lo);
+            auto fill = [&](real_t val) {
+                const int bin = binof(val);
+                ++hist[bin];
+                bmin[bin] = std::min(bmin[bin], val);
+                bmax[bin] = std::max(bmax[bin], val);
+            };
+            if (count == n) {   // all samples are in range
+                for (size_t ind=0; ind<n; ++ind) {
+                    fill(data[ind*stride]);
+                }
+            }
+            else {
+                for (size_t ind=0; ind<n; ++ind) {
+                    const real_t val = data[ind*stride];
+                    if (lo <= val and val <= hi) {
+                        fill(val);
+                    }
+                }
+            }
+            size_t bin = 0;
+            while (before + hist[bin] <= rank) {
+                before += hist[bin];
+                ++bin;
+            }
+            lo = bmin[bin];
+            hi = bmax[bin];
+            count = hist[bin];
+        }
+        if (lo == hi) {
+            return lo;
+        }
+        return select_copy(data, n, stride, lo, hi, false, rank - before);
+    }
+}
+
+real_t Waveform::select_percentile(crealspan_t wave, real_t percentage)
+{
+    return select_strided(wave.data(), wave.size(), 1, percentage);
+}
+
+Array::array_xf Waveform::percentile_rows(const Array::array_xxf& arr, real_t percentage)
+{
+    const size_t nrows = arr.rows();
+    const size_t ncols = arr.cols();
+    Array::array_xf ret(nrows);
+    for (size_t irow=0; irow<nrows; ++irow) {
+        // column-major: a row is strided by the number of rows
+        ret(irow) = select_strided(arr.data() + irow, ncols, nrows, percentage);
+    }
+    return ret;
+}
+
+
+P2Percentile::P2Percentile(real_t percentage)
+    : m_p(percentage)
+{
+    reset();
+}
+
+void P2Percentile::reset()
+{
+    m_count = 0;
+    const double p = m_p;
+    const double np[5] = {0, 2*p, 4*p, 2+2*p, 4};
+    const double dn[5] = {0, p/2, p, (1+p)/2, 1};
+    for (int ind=0; ind<5; ++ind) {
+        m_q[ind] = 0;
+        m_n[ind] = ind;
+        m_np[ind] = np[ind];
+        m_dn[ind] = dn[ind];
+    }
+}
+
+void P2Percentile::operator()(real_t x)
+{
+    // The first five samples are simply kept in order.
+    if (m_count < 5) {
+        m_q[m_count] = x;
+        ++m_count;
+        std::sort(m_q, m_q+m_count);
+        return;
+    }
+    ++m_count;
+
+    int k = 0;
+    if (x < m_q[0]) {
+        m_q[0] = x;
+        k = 0;
+    }
+    else if (x >= m_q[4]) {
+        m_q[4] = x;
+        k = 3;
+    }
+    else {
+        while (k < 3 and x >= m_q[k+1]) {
+            ++k;
+        }
+    }
+    for (int ind=k+1; ind<5; ++ind) {
+        m_n[ind] += 1;
+    }
+    for (int ind=0; ind<5; ++ind) {
+        m_np[ind] += m_dn[ind];
+    }
+
+    // Adjust the three middle markers.
+    for (int i=1; i<4; ++i) {
+        const double d = m_np[i] - m_n[i];
+        if ((d >= 1 and m_n[i+1] - m_n[i] > 1) or
+            (d <= -1 and m_n[i-1] - m_n[i] < -1)) {
+            const int s = d > 0 ? 1 : -1;
+
+            // piecewise parabolic prediction
+            const double qp = m_q[i] + s/(m_n[i+1] - m_n[i-1]) *
+                ((m_n[i] - m_n[i-1] + s) * (m_q[i+1] - m_q[i]) / (m_n[i+1] - m_n[i]) +
+                 (m_n[i+1] - m_n[i] - s) * (m_q[i] - m_q[i-1]) / (m_n[i] - m_n[i-1]));
+            if (m_q[i-1] < qp and qp < m_q[i+1]) {
+                m_q[i] = qp;
+            }
+            else {              // fall back to linear
+                m_q[i] += s * (m_q[i+s] - m_q[i]) / (m_n[i+s] - m_n[i]);
+            }
+            m_n[i] += s;
+        }
+    }
+}
+
+real_t P2Percentile::value() const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+    if (m_count <= 5) {
+        size_t rank = m_count*m_p;
+        return m_q[std::min(rank, m_count-1)];
+    }
+    return m_q[2];
+}
+
+
+BinnedPercentile::BinnedPercentile(size_t nbins, real_t lo, real_t hi)
+    : m_lo(lo)
+    , m_binsize((hi-lo)/nbins)
+    , m_hist(nbins, 0)
+    , m_count(0)
+{
+    if (nbins == 0) {
+        THROW(ValueError() << errmsg{"BinnedPercentile: need at least one bin"});
+    }
+    if (!(hi > lo)) {
+        THROW(ValueError() << errmsg{"BinnedPercentile: need hi > lo"});
+    }
+}
+
+void BinnedPercentile::reset()
+{
+    std::fill(m_hist.begin(), m_hist.end(), 0);
+    m_count = 0;
+}
+
+void BinnedPercentile::operator()(real_t x)
+{
+    const size_t nbins = m_hist.size();
+    // Clamp before converting so that huge or NaN values are safe.
+    const double pos = std::floor((x - m_lo)/m_binsize);
+    const size_t bin = !(pos >= 0) ? 0 : pos >= nbins ? nbins-1 : size_t(pos);
+    ++m_hist[bin];
+    ++m_count;
+}
+
+real_t BinnedPercentile::percentile(real_t percentage) const
+{
+    if (m_count == 0) {
+        return m_lo;
+    }
+    const double rank = std::min(double(m_count*percentage), double(m_count-1));
+    const size_t nbins = m_hist.size();
+    size_t before = 0;
+    for (size_t bin=0; bin<nbins; ++bin) {
+        const size_t inbin = m_hist[bin];
+        if (before + inbin > rank) {
+            const double frac = (rank - before + 0.5) / inbin;
+            return m_lo + (bin + frac)*m_binsize;
+        }
+        before += inbin;
+    }
+    return m_lo + nbins*m_binsize;
+}
+
+
+RunningMedian::RunningMedian(size_t window)
+    : m_window(std::max<size_t>(window, 1))
+    , m_ring(m_window, 0)
+    , m_head(0)
+{
+    m_sorted.reserve(m_window+1);
+}
+
+void RunningMedian::reset()
+{
+    m_sorted.clear();
+    m_head = 0;
+}
+
+void RunningMedian::pop()
+{
+    if (m_sorted.empty()) {
+        return;
+    }
+    const real_t old = m_ring[m_head];
+    m_sorted.erase(std::lower_bound(m_sorted.begin(), m_sorted.end(), old));
+    m_head = (m_head + 1) % m_window;
+}
+
+void RunningMedian::push(real_t x)
+{
+    if (m_sorted.size() == m_window) {
+        pop();
+    }
+    m_ring[(m_head + m_sorted.size()) % m_window] = x;
+    m_sorted.insert(std::upper_bound(m_sorted.begin(), m_sorted.end(), x), x);
+}
+
+real_t RunningMedian::percentile(real_t percentage) const
+{
+    const size_t n = m_sorted.size();
+    if (!n) {
+        return 0;
+    }
+    size_t rank = n*percentage;
+    return m_sorted[std::min(rank, n-1)];
+}
+
+
+void Waveform::running_median(crealspan_t in, realspan_t out, size_t window)
+{
+    const size_t n = in.size();
+    const size_t half = window/2;
+    RunningMedian rm(2*half+1);
+
+    // prime with the leading half window
+    for (size_t ind=0; ind<std::min(half, n); ++ind) {
+        rm.push(in[ind]);
+    }
+    for (size_t ind=0; ind<n; ++ind) {
+        if (ind + half < n) {
+            rm.push(in[ind+half]); // drops in[ind-half-1] when full
+        }
+        else if (ind > half) {
+            rm.pop();           // nothing new, shrink from the back
+        }
+        out[ind] = rm.median();
+    }
+}
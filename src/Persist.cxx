@@ -1,4 +1,5 @@
 #include "WireCellUtil/Persist.h"
+#include "WireCellUtil/PersistCache.h"
 #include "WireCellUtil/String.h"
 #include "WireCellUtil/Logging.h"
 #include "WireCellUtil/Exceptions.h"
@@ -134,6 +135,11 @@ Json::Value WireCell::Persist::load(const std::string& filename,
     }
 
 
+    Json::Value jroot;
+    if (load_cached(fname, jroot)) {
+        return jroot;
+    }
+
     // use jsoncpp file interface
     std::fstream fp(fname.c_str(), std::ios::binary|std::ios::in);
     boost::iostreams::filtering_stream<boost::iostreams::input> infilt;	
@@ -142,9 +148,8 @@ Json::Value WireCell::Persist::load(const std::string& filename,
 	infilt.push(boost::iostreams::bzip2_decompressor());
     }
     infilt.push(fp);
-    std::string text;
-    Json::Value jroot;    
     infilt >> jroot;
+    save_cached(fname, jroot);
     //return update(jroot, extvar); fixme
     return jroot;
 }
@@ -294,6 +299,11 @@ Json::Value WireCell::Persist::Parser::load(const std::string& filename)
 
     // also support JSON, possibly compressed
 
+    Json::Value jroot;
+    if (Persist::load_cached(fname, jroot)) {
+        return jroot;
+    }
+
     // use jsoncpp file interface
     std::fstream fp(fname.c_str(), std::ios::binary|std::ios::in);
     boost::iostreams::filtering_stream<boost::iostreams::input> infilt;	
@@ -302,9 +312,8 @@ Json::Value WireCell::Persist::Parser::load(const std::string& filename)
 	infilt.push(boost::iostreams::bzip2_decompressor());
     }
     infilt.push(fp);
-    std::string text;
-    Json::Value jroot;    
     infilt >> jroot;
+    Persist::save_cached(fname, jroot);
     //return update(jroot, extvar); fixme
     return jroot;
 }
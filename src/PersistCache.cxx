@@ -0,0 +1,378 @@
+#include "WireCellUtil/PersistCache.h"
+#include "WireCellUtil/Logging.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+
+#include <sys/stat.h>           // stat
+#include <unistd.h>             // getpid
+
+using namespace WireCell;
+
+#define WIRECELL_JSON_CACHE_VARNAME "WIRECELL_JSON_CACHE"
+
+namespace {
+
+    // Images are in the byte order of the machine writing them and
+    // images of another byte order are not read.
+    const char magic[8] = {'W','C','J','B','0','0','0','3'};
+    const uint32_t byteorder = 0x01020304;
+
+    // Tags for each value in the image.
+    enum Tag : char {
+        tag_null='n', tag_true='t', tag_false='f',
+        tag_int='i', tag_uint='u', tag_real='r', tag_string='s',
+        tag_array='a', tag_object='o',
+        tag_ints='I', tag_reals='R', // packed arrays
+    };
+
+    // FNV-1a style hash taking 8 bytes at a time.
+    uint64_t hash_bytes(const char* data, size_t size)
+    {
+        const uint64_t prime = 0x100000001b3ULL;
+        uint64_t h = 0xcbf29ce484222325ULL;
+        size_t ind = 0;
+        for (; ind+8 <= size; ind += 8) {
+            uint64_t word;
+            std::memcpy(&word, data+ind, 8);
+            h = (h ^ word) * prime;
+        }
+        for (; ind < size; ++ind) {
+            h = (h ^ (unsigned char)data[ind]) * prime;
+        }
+        return h;
+    }
+
+    uint64_t hash_file(const std::string& fname)
+    {
+        if (boost::filesystem::file_size(fname) == 0) {
+            return hash_bytes(nullptr, 0);
+        }
+        boost::iostreams::mapped_file_source mf(fname);
+        return hash_bytes(mf.data(), mf.size());
+    }
+
+    // An image matches a file of the same size and modification
+    // time.  Only if the time differs is the content hashed, so a
+    // touched but unchanged file still matches.
+    struct Key {
+        uint64_t size;
+        int64_t mtime;          // ns
+        uint64_t hash;
+    };
+
+    // Size and modification time, to the resolution of the file
+    // system, of an existing file.
+    Key stat_file(const std::string& fname)
+    {
+        struct stat st;
+        if (::stat(fname.c_str(), &st)) {
+            THROW(IOError() << errmsg{"can not stat " + fname});
+        }
+        return Key{uint64_t(st.st_size),
+                   int64_t(st.st_mtim.tv_sec)*1000000000 + st.st_mtim.tv_nsec, 0};
+    }
+
+    // Offset of the key in an image.
+    const size_t key_offset = sizeof(magic) + 2*sizeof(uint32_t);
+
+    std::mutex g_mutex;
+    bool g_initialized = false;
+    std::string g_cache_dir;
+
+    /*
+     * Writing
+     */
+
+    struct Writer {
+        std::string buf;
+
+        template<typename T>
+        void put(const T& val) {
+            buf.append(reinterpret_cast<const char*>(&val), sizeof(T));
+        }
+        void put_string(const std::string& str) {
+            put<uint32_t>(str.size());
+            buf.append(str);
+        }
+
+        void value(const Json::Value& jv) {
+            switch (jv.type()) {
+            case Json::nullValue: put(tag_null); return;
+            case Json::booleanValue: put(jv.asBool() ? tag_true : tag_false); return;
+            case Json::intValue: put(tag_int); put<int64_t>(jv.asInt64()); return;
+            case Json::uintValue: put(tag_uint); put<uint64_t>(jv.asUInt64()); return;
+            case Json::realValue: put(tag_real); put<double>(jv.asDouble()); return;
+            case Json::stringValue: put(tag_string); put_string(jv.asString()); return;
+            case Json::arrayValue: array(jv); return;
+            case Json::objectValue:
+                put(tag_object);
+                put<uint32_t>(jv.size());
+                for (auto it = jv.begin(); it != jv.end(); ++it) {
+                    put_string(it.name());
+                    value(*it);
+                }
+                return;
+            }
+        }
+
+        void array(const Json::Value& jv) {
+            const uint32_t n = jv.size();
+            bool ints = n > 0, reals = n > 0;
+            for (const auto& one : jv) {
+                ints = ints and one.type() == Json::intValue;
+                reals = reals and one.type() == Json::realValue;
+                if (!ints and !reals) {
+                    break;
+                }
+            }
+            if (ints) {
+                put(tag_ints);
+                put(n);
+                for (const auto& one : jv) {
+                    put<int64_t>(one.asInt64());
+                }
+                return;
+            }
+            if (reals) {
+                put(tag_reals);
+                put(n);
+                for (const auto& one : jv) {
+                    put<double>(one.asDouble());
+                }
+                return;
+            }
+            put(tag_array);
+            put(n);
+            for (const auto& one : jv) {
+                value(one);
+            }
+        }
+    };
+
+    /*
+     * Reading
+     */
+
+    struct Reader {
+        const char* ptr;
+        const char* end;
+
+        void need(size_t n) {
+            if (size_t(end - ptr) < n) {
+                THROW(ValueError() << errmsg{"truncated JSON cache image"});
+            }
+        }
+        template<typename T>
+        T get() {
+            need(sizeof(T));
+            T val;
+            std::memcpy(&val, ptr, sizeof(T));
+            ptr += sizeof(T);
+            return val;
+        }
+        std::string get_string() {
+            const uint32_t n = get<uint32_t>();
+            need(n);
+            std::string ret(ptr, n);
+            ptr += n;
+            return ret;
+        }
+
+        void value(Json::Value& jv) {
+            const char tag = get<char>();
+            switch (tag) {
+            case tag_null: jv = Json::Value(); return;
+            case tag_true: jv = true; return;
+            case tag_false: jv = false; return;
+            case tag_int: jv = Json::Value(Json::Int64(get<int64_t>())); return;
+            case tag_uint: jv = Json::Value(Json::UInt64(get<uint64_t>())); return;
+            case tag_real: jv = get<double>(); return;
+            case tag_string: jv = get_string(); return;
+            case tag_ints: {
+                const uint32_t n = get<uint32_t>();
+                need(size_t(n)*sizeof(int64_t));
+                jv = Json::Value(Json::arrayValue);
+                jv.resize(n);
+                for (uint32_t ind=0; ind<n; ++ind) {
+                    jv[ind] = Json::Value(Json::Int64(get<int64_t>()));
+                }
+                return;
+            }
+            case tag_reals: {
+                const uint32_t n = get<uint32_t>();
+                need(size_t(n)*sizeof(double));
+                jv = Json::Value(Json::arrayValue);
+                jv.resize(n);
+                for (uint32_t ind=0; ind<n; ++ind) {
+                    jv[ind] = get<double>();
+                }
+                return;
+            }
+            case tag_array: {
+                const uint32_t n = get<uint32_t>();
+                jv = Json::Value(Json::arrayValue);
+                jv.resize(n);
+                for (uint32_t ind=0; ind<n; ++ind) {
+                    value(jv[ind]);
+                }
+                return;
+            }
+            case tag_object: {
+                const uint32_t n = get<uint32_t>();
+                jv = Json::Value(Json::objectValue);
+                for (uint32_t ind=0; ind<n; ++ind) {
+                    const std::string key = get_string();
+                    value(jv[key]);
+                }
+                return;
+            }
+            }
+            THROW(ValueError() << errmsg{"corrupt JSON cache image"});
+        }
+    };
+}
+
+
+std::string Persist::cache_dir()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_initialized) {
+        g_initialized = true;
+        const char* dir = std::getenv(WIRECELL_JSON_CACHE_VARNAME);
+        if (dir and dir[0]) {
+            boost::system::error_code ec;
+            boost::filesystem::create_directories(dir, ec);
+            if (ec) {
+                spdlog::warn("Persist: can not make JSON cache directory {}: {}", dir, ec.message());
+            }
+            else {
+                g_cache_dir = dir;
+            }
+        }
+    }
+    return g_cache_dir;
+}
+
+void Persist::set_cache_dir(const std::string& dirname)
+{
+    if (!dirname.empty()) {
+        boost::filesystem::create_directories(dirname);
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_initialized = true;
+    g_cache_dir = dirname;
+}
+
+std::string Persist::cache_file(const std::string& fname)
+{
+    const std::string dir = cache_dir();
+    if (dir.empty()) {
+        return "";
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx",
+                  (unsigned long long)hash_bytes(fname.data(), fname.size()));
+    const std::string base = boost::filesystem::path(fname).filename().string();
+    return (boost::filesystem::path(dir) / (std::string(hex) + "-" + base + ".wcjb")).string();
+}
+
+bool Persist::load_cached(const std::string& fname, Json::Value& top)
+{
+    const std::string cname = cache_file(fname);
+    if (cname.empty() or !boost::filesystem::exists(cname)) {
+        return false;
+    }
+    try {
+        boost::iostreams::mapped_file_source mf(cname);
+        Reader reader{mf.data(), mf.data() + mf.size()};
+        reader.need(sizeof(magic));
+        if (std::memcmp(reader.ptr, magic, sizeof(magic))) {
+            spdlog::warn("Persist: ignoring JSON cache of unknown format: {}", cname);
+            return false;
+        }
+        reader.ptr += sizeof(magic);
+        const uint32_t order = reader.get<uint32_t>();
+        reader.get<uint32_t>(); // unused
+        if (order != byteorder) {
+            spdlog::warn("Persist: ignoring JSON cache of {} byte order: {}",
+                         order == __builtin_bswap32(byteorder) ? "the other" : "unknown", cname);
+            return false;
+        }
+        const Key key = reader.get<Key>();
+        if (reader.get_string() != fname) {
+            return false;       // hash collision of file names
+        }
+
+        const Key now = stat_file(fname);
+        if (now.size != key.size) {
+            return false;
+        }
+        if (now.mtime != key.mtime) {
+            if (hash_file(fname) != key.hash) {
+                return false;
+            }
+            // Record the new time so the next load need not hash.
+            // This is best effort, a concurrent rewrite replaces the
+            // file rather than the contents seen here.
+            std::fstream out(cname, std::ios::binary|std::ios::in|std::ios::out);
+            out.seekp(key_offset + offsetof(Key, mtime));
+            out.write(reinterpret_cast<const char*>(&now.mtime), sizeof(now.mtime));
+        }
+        reader.value(top);
+        spdlog::debug("Persist: loaded {} from cache {}", fname, cname);
+        return true;
+    }
+    catch (const std::exception& err) {
+        spdlog::warn("Persist: ignoring bad JSON cache {}: {}", cname, err.what());
+    }
+    return false;
+}
+
+void Persist::save_cached(const std::string& fname, const Json::Value& top)
+{
+    const std::string cname = cache_file(fname);
+    if (cname.empty()) {
+        return;
+    }
+    // Write aside and move in place so concurrent jobs never see a
+    // partial image.
+    const std::string tmp = cname + "." + std::to_string(::getpid()) + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    try {
+        Writer writer;
+        writer.buf.append(magic, sizeof(magic));
+        writer.put(byteorder);
+        writer.put<uint32_t>(0);
+        Key key = stat_file(fname);
+        key.hash = hash_file(fname);
+        writer.put(key);
+        writer.put_string(fname);
+        writer.value(top);
+
+        {
+            std::ofstream out(tmp, std::ios::binary);
+            out.write(writer.buf.data(), writer.buf.size());
+            if (!out) {
+                THROW(IOError() << errmsg{"failed to write " + tmp});
+            }
+        }
+        boost::filesystem::rename(tmp, cname);
+        spdlog::debug("Persist: cached {} as {}", fname, cname);
+    }
+    catch (const std::exception& err) {
+        spdlog::warn("Persist: failed to cache {}: {}", fname, err.what());
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmp, ec);
+    }
+}
@@ -0,0 +1,284 @@
+#include "WireCellUtil/Profiler.h"
+#include "WireCellUtil/Persist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace WireCell;
+
+// Finished zones of one thread.  Only the owning thread appends.
+// Events go into a chain of fixed chunks which never move, and the
+// count is published after each event is written so readers on
+// other threads see only whole events.
+struct Profiler::Buffer {
+    static const size_t chunk_size = 4096;
+    struct Chunk {
+        Event events[chunk_size];
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    std::thread::id tid;
+    std::string name;           // guarded by Profiler::m_mutex
+    Chunk head;
+    Chunk* tail{&head};         // owner only
+    size_t ntail{0};            // owner only
+    int depth{0};               // owner only
+    std::atomic<size_t> count{0};
+
+    ~Buffer() {
+        Chunk* c = head.next.load();
+        while (c) {
+            Chunk* next = c->next.load();
+            delete c;
+            c = next;
+        }
+    }
+
+    void push(const Event& e) {
+        if (ntail == chunk_size) {
+            Chunk* c = new Chunk;
+            tail->next.store(c, std::memory_order_release);
+            tail = c;
+            ntail = 0;
+        }
+        tail->events[ntail++] = e;
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void copy(std::vector<Event>& out) const {
+        const size_t n = count.load(std::memory_order_acquire);
+        out.reserve(out.size() + n);
+        const Chunk* c = &head;
+        for (size_t ind=0; ind<n; ++ind) {
+            if (ind and ind % chunk_size == 0) {
+                c = c->next.load(std::memory_order_acquire);
+            }
+            out.push_back(c->events[ind % chunk_size]);
+        }
+    }
+};
+
+namespace {
+    std::atomic<uint64_t> g_next_id{1};
+
+    // The calling thread's buffer for the Profiler last used by it.
+    struct BufferCache {
+        uint64_t owner;
+        void* buffer;
+    };
+    thread_local BufferCache t_cache{0, nullptr};
+}
+
+
+Profiler::Zone::Zone(Profiler& prof, const char* name)
+    : m_prof(prof), m_buf(nullptr), m_name(name), m_start(0)
+{
+    if (!prof.m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    m_buf = prof.buffer();
+    ++m_buf->depth;
+    m_start = prof.now();
+}
+
+Profiler::Zone::~Zone()
+{
+    if (!m_buf) {
+        return;
+    }
+    const int64_t stop = m_prof.now();
+    const int depth = --m_buf->depth;
+    m_buf->push(Event{m_name, m_start, stop, depth});
+}
+
+
+Profiler::Profiler(bool enabled)
+    : m_id(g_next_id++)
+    , m_t0(std::chrono::steady_clock::now())
+    , m_enabled(enabled)
+{
+}
+
+Profiler::~Profiler()
+{
+}
+
+Profiler::Buffer* Profiler::buffer()
+{
+    if (t_cache.owner == m_id) {
+        return static_cast<Buffer*>(t_cache.buffer);
+    }
+    const auto tid = std::this_thread::get_id();
+    Buffer* buf = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& b : m_buffers) {
+            if (b->tid == tid) {
+                buf = b.get();
+                break;
+            }
+        }
+        if (!buf) {
+            m_buffers.emplace_back(new Buffer);
+            buf = m_buffers.back().get();
+            buf->tid = tid;
+        }
+    }
+    t_cache = BufferCache{m_id, buf};
+    return buf;
+}
+
+const char* Profiler::intern(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.insert(name).first->c_str();
+}
+
+void Profiler::name_thread(const std::string& name)
+{
+    Buffer* buf = buffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buf->name = name;
+}
+
+size_t Profiler::nzones() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t n = 0;
+    for (const auto& b : m_buffers) {
+        n += b->count.load(std::memory_order_acquire);
+    }
+    return n;
+}
+
+std::vector<std::vector<Profiler::Event> >
+Profiler::events(std::vector<std::string>& thread_names) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::vector<Event> > ret(m_buffers.size());
+    thread_names.clear();
+    for (size_t ind=0; ind<m_buffers.size(); ++ind) {
+        m_buffers[ind]->copy(ret[ind]);
+        thread_names.push_back(m_buffers[ind]->name);
+    }
+    return ret;
+}
+
+std::vector<Profiler::ZoneStats> Profiler::stats() const
+{
+    std::vector<std::string> tnames;
+    auto all = events(tnames);
+
+    struct Agg {
+        std::vector<int64_t> durs;
+        int64_t self{0};
+    };
+    std::map<std::string, Agg> aggs;
+
+    for (auto& evs : all) {
+        // Parents start no later and are less deep than children.
+        std::sort(evs.begin(), evs.end(), [](const Event& a, const Event& b) {
+            return a.start < b.start or (a.start == b.start and a.depth < b.depth);
+        });
+        std::vector<int64_t> child(evs.size(), 0);
+        std::vector<size_t> stack;
+        for (size_t ind=0; ind<evs.size(); ++ind) {
+            const Event& ev = evs[ind];
+            while (!stack.empty() and evs[stack.back()].depth >= ev.depth) {
+                stack.pop_back();
+            }
+            if (!stack.empty()) {
+                child[stack.back()] += ev.stop - ev.start;
+            }
+            stack.push_back(ind);
+        }
+        for (size_t ind=0; ind<evs.size(); ++ind) {
+            const Event& ev = evs[ind];
+            auto& agg = aggs[ev.name];
+            agg.durs.push_back(ev.stop - ev.start);
+            agg.self += ev.stop - ev.start - child[ind];
+        }
+    }
+
+    std::vector<ZoneStats> ret;
+    for (auto& it : aggs) {
+        auto& durs = it.second.durs;
+        std::sort(durs.begin(), durs.end());
+        ZoneStats zs;
+        zs.name = it.first;
+        zs.count = durs.size();
+        int64_t tot = 0;
+        for (auto d : durs) { tot += d; }
+        zs.total = tot*1e-9;
+        zs.self = it.second.self*1e-9;
+        zs.min = durs.front()*1e-9;
+        zs.max = durs.back()*1e-9;
+        const size_t i99 = std::max<size_t>(1, std::ceil(0.99*durs.size())) - 1;
+        zs.p99 = durs[i99]*1e-9;
+        ret.push_back(zs);
+    }
+    std::sort(ret.begin(), ret.end(), [](const ZoneStats& a, const ZoneStats& b) {
+        return a.total > b.total;
+    });
+    return ret;
+}
+
+std::string Profiler::summary() const
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (const auto& zs : stats()) {
+        ss << "ZONE: " << zs.name
+           << " count=" << zs.count
+           << " total=" << zs.total*1e3 << " ms"
+           << " self=" << zs.self*1e3 << " ms"
+           << " min=" << zs.min*1e3 << " ms"
+           << " max=" << zs.max*1e3 << " ms"
+           << " p99=" << zs.p99*1e3 << " ms\n";
+    }
+    return ss.str();
+}
+
+Json::Value Profiler::trace() const
+{
+    std::vector<std::string> tnames;
+    auto all = events(tnames);
+    const int pid = getpid();
+
+    Json::Value jevs(Json::arrayValue);
+    for (size_t itid=0; itid<all.size(); ++itid) {
+        if (!tnames[itid].empty()) {
+            Json::Value jm;
+            jm["name"] = "thread_name";
+            jm["ph"] = "M";
+            jm["pid"] = pid;
+            jm["tid"] = (int)itid;
+            jm["args"]["name"] = tnames[itid];
+            jevs.append(jm);
+        }
+        for (const auto& ev : all[itid]) {
+            Json::Value jev;
+            jev["name"] = ev.name;
+            jev["ph"] = "X";
+            jev["pid"] = pid;
+            jev["tid"] = (int)itid;
+            jev["ts"] = ev.start*1e-3; // us
+            jev["dur"] = (ev.stop - ev.start)*1e-3;
+            jevs.append(jev);
+        }
+    }
+    Json::Value ret;
+    ret["traceEvents"] = jevs;
+    ret["displayTimeUnit"] = "ms";
+    return ret;
+}
+
+void Profiler::write_trace(const std::string& filename) const
+{
+    Persist::dump(filename, trace());
+}
@@ -0,0 +1,152 @@
+#include "WireCellUtil/Projector.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <algorithm>
+
+using namespace WireCell;
+
+// Points per block.  Small enough that a block's inputs and
+// outputs for all planes stay in cache.
+static const size_t block_size = 1024;
+
+void Projector::Projected::resize(size_t npoints)
+{
+    wire.resize(npoints);
+    impact.resize(npoints);
+    channel.resize(npoints);
+    pitch.resize(npoints);
+    drift.resize(npoints);
+}
+
+Projector::Projector(const std::vector<Pimpos>& pimpos,
+                     const std::vector<std::vector<int> >& channels)
+    : m_pimpos(pimpos)
+    , m_channels(channels)
+{
+    if (!m_channels.empty() and m_channels.size() != m_pimpos.size()) {
+        THROW(ValueError() << errmsg{"Projector: channels not given for each plane"});
+    }
+    m_channels.resize(m_pimpos.size());
+    init();
+}
+
+Projector::Projector(const WireSchema::Store& store, const WireSchema::Face& face,
+                     int nimpact_bins_per_wire)
+{
+    for (const auto& plane : store.planes(face)) {
+        auto wires = store.wires(plane);
+        if (wires.size() < 2) {
+            THROW(ValueError() << errmsg{"Projector: plane with fewer than two wires"});
+        }
+        const auto& wp = store.wire_pitch(plane);
+        const Vector& wdir = wp.first;
+        const Vector& pdir = wp.second;
+        const Point first = 0.5*(wires.front().tail + wires.front().head);
+        const Point last = 0.5*(wires.back().tail + wires.back().head);
+        const double pmax = pdir.dot(last - first);
+        if (pmax <= 0) {
+            THROW(ValueError() << errmsg{"Projector: wires not in order of pitch"});
+        }
+        m_pimpos.emplace_back((int)wires.size(), 0.0, pmax, wdir, pdir, first,
+                              nimpact_bins_per_wire);
+        m_channels.push_back(store.channels(plane));
+    }
+    init();
+}
+
+void Projector::init()
+{
+    m_geoms.clear();
+    for (size_t ind=0; ind<m_pimpos.size(); ++ind) {
+        const Pimpos& pp = m_pimpos[ind];
+        Geom g;
+        for (int i=0; i<3; ++i) {
+            g.origin[i] = pp.origin()[i];
+            g.drift[i] = pp.axis(0)[i];
+            g.pitch[i] = pp.axis(2)[i];
+        }
+        g.pmin = pp.region_binning().min();
+        g.wire_binsize = pp.region_binning().binsize();
+        g.impact_binsize = pp.impact_binning().binsize();
+        m_geoms.push_back(g);
+
+        const int nwires = pp.region_binning().nbins();
+        auto& chans = m_channels[ind];
+        if (!chans.empty() and (int)chans.size() != nwires) {
+            THROW(ValueError() << errmsg{"Projector: channels do not match number of wires"});
+        }
+    }
+}
+
+void Projector::project(size_t npoints, const double* x, const double* y, const double* z,
+                        std::vector<Projected>& results) const
+{
+    const size_t nplanes = m_geoms.size();
+    results.resize(nplanes);
+    for (auto& res : results) {
+        res.resize(npoints);
+    }
+
+    for (size_t beg = 0; beg < npoints; beg += block_size) {
+        const size_t n = std::min(block_size, npoints - beg);
+        const double* bx = x + beg;
+        const double* by = y + beg;
+        const double* bz = z + beg;
+
+        for (size_t ipl=0; ipl<nplanes; ++ipl) {
+            const Geom& g = m_geoms[ipl];
+            Projected& res = results[ipl];
+            double* pitch = res.pitch.data() + beg;
+            double* drift = res.drift.data() + beg;
+            int* wire = res.wire.data() + beg;
+            int* impact = res.impact.data() + beg;
+            int* channel = res.channel.data() + beg;
+
+            // Same operations and order as Pimpos::distance() and
+            // Pimpos::closest() so results agree exactly.
+            const double ox = g.origin[0], oy = g.origin[1], oz = g.origin[2];
+            const double px = g.pitch[0], py = g.pitch[1], pz = g.pitch[2];
+            const double dx = g.drift[0], dy = g.drift[1], dz = g.drift[2];
+            for (size_t ind=0; ind<n; ++ind) {
+                const double rx = bx[ind] - ox;
+                const double ry = by[ind] - oy;
+                const double rz = bz[ind] - oz;
+                pitch[ind] = px*rx + py*ry + pz*rz;
+                drift[ind] = dx*rx + dy*ry + dz*rz;
+            }
+
+            const double pmin = g.pmin, wbin = g.wire_binsize, ibin = g.impact_binsize;
+            for (size_t ind=0; ind<n; ++ind) {
+                wire[ind] = int((pitch[ind] - pmin)/wbin);
+            }
+            for (size_t ind=0; ind<n; ++ind) {
+                const double remainder = pitch[ind] - (pmin + (wire[ind]+0.5)*wbin);
+                // round() half away from zero, written so the loop
+                // vectorizes.  The fraction is exact.
+                const double rel = remainder/ibin;
+                const int trunc = int(rel);
+                const double frac = rel - trunc;
+                impact[ind] = trunc + (frac >= 0.5) - (frac <= -0.5);
+            }
+
+            const auto& chans = m_channels[ipl];
+            const int nchans = chans.size();
+            for (size_t ind=0; ind<n; ++ind) {
+                const int iw = wire[ind];
+                channel[ind] = (0 <= iw and iw < nchans) ? chans[iw] : -1;
+            }
+        }
+    }
+}
+
+std::vector<Projector::Projected> Projector::project(const std::vector<double>& x,
+                                                     const std::vector<double>& y,
+                                                     const std::vector<double>& z) const
+{
+    if (y.size() != x.size() or z.size() != x.size()) {
+        THROW(ValueError() << errmsg{"Projector: coordinate arrays differ in size"});
+    }
+    std::vector<Projected> ret;
+    project(x.size(), x.data(), y.data(), z.data(), ret);
+    return ret;
+}
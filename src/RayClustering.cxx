@@ -1,5 +1,9 @@
 #include "WireCellUtil/RayClustering.h"
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+
 using namespace WireCell;
 using namespace WireCell::RayGrid;
 
@@ -88,17 +92,190 @@ bool WireCell::RayGrid::surrounding(const blobref_t& a, const blobref_t& b)
 }
 
 
+BlobIndex::BlobIndex(const blobs_t& blobs)
+    : m_nblobs(blobs.size())
+    , m_nlayers(blobs.empty() ? 0 : blobs[0].strips().size())
+    , m_layer(0)
+{
+    if (!m_nblobs or !m_nlayers) {
+        return;
+    }
+
+    m_bounds.resize(m_nblobs*m_nlayers*2);
+    for (size_t ind=0; ind<m_nblobs; ++ind) {
+        const auto& strips = blobs[ind].strips();
+        grid_index_t* bounds = &m_bounds[ind*m_nlayers*2];
+        for (int layer=0; layer<m_nlayers; ++layer) {
+            bounds[2*layer] = strips[layer].bounds.first;
+            bounds[2*layer+1] = strips[layer].bounds.second;
+        }
+    }
+
+    // Pick the layer where strips are narrowest compared to their
+    // spread as it gives the fewest false candidates.
+    double best = -1;
+    for (int layer=0; layer<m_nlayers; ++layer) {
+        grid_index_t lo = m_bounds[2*layer], hi = m_bounds[2*layer+1];
+        double width = 0;
+        for (size_t ind=0; ind<m_nblobs; ++ind) {
+            const grid_index_t* b = &m_bounds[(ind*m_nlayers + layer)*2];
+            lo = std::min(lo, b[0]);
+            hi = std::max(hi, b[1]);
+            width += b[1] - b[0];
+        }
+        const double spread = (hi - lo) / (width + 1);
+        if (spread > best) {
+            best = spread;
+            m_layer = layer;
+        }
+    }
+
+    m_order.reserve(m_nblobs);
+    for (size_t ind=0; ind<m_nblobs; ++ind) {
+        const grid_index_t* b = &m_bounds[(ind*m_nlayers + m_layer)*2];
+        if (b[0] < b[1]) {      // empty strips overlap nothing
+            m_order.push_back(ind);
+        }
+    }
+    std::sort(m_order.begin(), m_order.end(), [&](size_t a, size_t b) {
+            return m_bounds[(a*m_nlayers + m_layer)*2] < m_bounds[(b*m_nlayers + m_layer)*2];
+        });
+    const size_t nord = m_order.size();
+    m_begs.resize(nord);
+    m_ends.resize(nord);
+    m_maxend.resize(nord);
+    for (size_t ind=0; ind<nord; ++ind) {
+        const grid_index_t* b = &m_bounds[(m_order[ind]*m_nlayers + m_layer)*2];
+        m_begs[ind] = b[0];
+        m_ends[ind] = b[1];
+    }
+    build(0, nord);
+}
+
+// The subtree over [lo,hi) is rooted at the midpoint.
+grid_index_t BlobIndex::build(size_t lo, size_t hi)
+{
+    if (lo >= hi) {
+        return std::numeric_limits<grid_index_t>::min();
+    }
+    const size_t mid = (lo+hi)/2;
+    grid_index_t maxend = m_ends[mid];
+    maxend = std::max(maxend, build(lo, mid));
+    maxend = std::max(maxend, build(mid+1, hi));
+    m_maxend[mid] = maxend;
+    return maxend;
+}
+
+// Collect positions in [lo, min(hi,lim)) with an end beyond beg.
+// All positions before lim begin before the query's end.
+void BlobIndex::search(size_t lo, size_t hi, size_t lim, grid_index_t beg,
+                       std::vector<size_t>& out) const
+{
+    if (lo >= hi or lo >= lim) {
+        return;
+    }
+    const size_t mid = (lo+hi)/2;
+    if (m_maxend[mid] <= beg) {
+        return;
+    }
+    search(lo, mid, lim, beg, out);
+    if (mid < lim and m_ends[mid] > beg) {
+        out.push_back(mid);
+    }
+    search(mid+1, hi, lim, beg, out);
+}
+
+void BlobIndex::query(const Blob& blob, std::vector<size_t>& out) const
+{
+    out.clear();
+    const auto& strips = blob.strips();
+    if (m_order.empty() or (int)strips.size() != m_nlayers) {
+        return;
+    }
+    const auto& bounds = strips[m_layer].bounds;
+    if (bounds.first >= bounds.second) {
+        return;
+    }
+
+    const size_t lim = std::lower_bound(m_begs.begin(), m_begs.end(), bounds.second) - m_begs.begin();
+    search(0, m_begs.size(), lim, bounds.first, out);
+
+    // Positions to blob indices keeping those overlapping in all
+    // other layers.
+    size_t nkeep = 0;
+    for (size_t pos : out) {
+        const size_t ind = m_order[pos];
+        const grid_index_t* b = &m_bounds[ind*m_nlayers*2];
+        bool keep = true;
+        for (int layer=0; layer<m_nlayers; ++layer) {
+            const auto& s = strips[layer].bounds;
+            const grid_index_t b1 = b[2*layer], b2 = b[2*layer+1];
+            if (b1 >= b2 or s.first >= s.second or b1 >= s.second or s.first >= b2) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            out[nkeep++] = ind;
+        }
+    }
+    out.resize(nkeep);
+    std::sort(out.begin(), out.end());
+}
+
+std::vector<blobpair_t> WireCell::RayGrid::overlaps(const blobs_t& one, const blobs_t& two, int nthreads)
+{
+    std::vector<blobpair_t> ret;
+    if (one.empty() or two.empty()) {
+        return ret;
+    }
+    const BlobIndex index(two);
+
+    // Each thread takes a contiguous chunk of one so concatenating
+    // the per-chunk results keeps the order.
+    const size_t none = one.size();
+    nthreads = std::max(1, std::min<int>(nthreads, none));
+    std::vector< std::vector<blobpair_t> > chunks(nthreads);
+    auto worker = [&](int ichunk) {
+        const size_t beg = none*ichunk/nthreads;
+        const size_t end = none*(ichunk+1)/nthreads;
+        std::vector<size_t> found;
+        auto& pairs = chunks[ichunk];
+        for (size_t ind=beg; ind<end; ++ind) {
+            index.query(one[ind], found);
+            for (size_t other : found) {
+                pairs.emplace_back(ind, other);
+            }
+        }
+    };
+    if (nthreads == 1) {
+        worker(0);
+        return std::move(chunks[0]);
+    }
+    std::vector<std::thread> threads;
+    for (int ith=0; ith<nthreads; ++ith) {
+        threads.emplace_back(worker, ith);
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (const auto& pairs : chunks) {
+        ret.insert(ret.end(), pairs.begin(), pairs.end());
+    }
+    return ret;
+}
+
 void WireCell::RayGrid::associate(const blobs_t& one, const blobs_t& two, associator_t func)
 {
     if (one.empty() or two.empty()) {
         return;
     }
-    const size_t nlayers = two[0].strips().size();
-    const size_t ilayer = nlayers-1;
-    const auto proj = projection(references(two), ilayer);
+    const BlobIndex index(two);
+    std::vector<size_t> found;
     for (blobref_t blob = one.begin(); blob != one.end(); ++blob) {
-        auto assoc = overlap(blob, proj, ilayer); // recursive call
-        for (blobref_t other : assoc) {
+        index.query(*blob, found);
+        for (size_t ind : found) {
+            blobref_t other = two.begin() + ind;
             func(blob, other);
         }
     }
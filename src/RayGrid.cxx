@@ -112,6 +112,21 @@ Coordinates::Coordinates(const ray_pair_vector_t& rays,
             }
         }
     }
+
+    const size_t ncoef = m_nlayers*m_nlayers*m_nlayers;
+    m_aj.resize(ncoef);
+    m_ai.resize(ncoef);
+    m_bc.resize(ncoef);
+    for (layer_index_t in=0; in<m_nlayers; ++in) {
+        for (layer_index_t il=0; il<m_nlayers; ++il) {
+            for (layer_index_t im=0; im<m_nlayers; ++im) {
+                const size_t k = coef_index(il, im, in);
+                m_aj[k] = m_a[il][im][in];
+                m_ai[k] = m_a[im][il][in];
+                m_bc[k] = m_b[il][im][in];
+            }
+        }
+    }
 }
 
 Vector Coordinates::zero_crossing(layer_index_t one, layer_index_t two) const
@@ -130,9 +145,20 @@ Vector Coordinates::ray_crossing(const coordinate_t& one, const coordinate_t& tw
     return res;
 }
 
-double Coordinates::pitch_location(const coordinate_t& one, const coordinate_t& two, layer_index_t other) const
+void Coordinates::pitch_locations(const crossings_t& crossings, layer_index_t other,
+                                  std::vector<double>& out) const
 {
-    const tensor_t::index il=one.layer, im=two.layer, in=other;
-    const tensor_t::index i=one.grid, j=two.grid;
-    return  j*m_a[il][im][in] + i*m_a[im][il][in] + m_b[il][im][in];
+    const size_t ncross = crossings.size();
+    out.resize(ncross);
+
+    // All coefficients for this layer are in one small block.
+    const size_t off = coef_index(0, 0, other);
+    const double* aj = m_aj.data() + off;
+    const double* ai = m_ai.data() + off;
+    const double* bc = m_bc.data() + off;
+    for (size_t ind=0; ind<ncross; ++ind) {
+        const auto& c = crossings[ind];
+        const size_t k = size_t(c.first.layer)*m_nlayers + c.second.layer;
+        out[ind] = c.second.grid*aj[k] + c.first.grid*ai[k] + bc[k];
+    }
 }
@@ -1,58 +1,154 @@
 #include "WireCellUtil/RaySolving.h"
 #include "WireCellUtil/Ress.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
 
 using namespace WireCell;
 
-RayGrid::Grouping::vertex_t RayGrid::Grouping::wire_node(ident_t wid)
+size_t RayGrid::Grouping::find(size_t node)
 {
-    auto it = m_wid2vtx.find(wid);
-    if (it != m_wid2vtx.end()) {
-        return it->second;
+    // path halving
+    while (m_parent[node] != node) {
+        m_parent[node] = m_parent[m_parent[node]];
+        node = m_parent[node];
     }
-    vertex_t node = boost::add_vertex(m_graph);
-    m_wid2vtx[wid] = node;
-    m_graph[node].ntype = 'w';
-    m_graph[node].ident = wid;
-    m_graph[node].value = 0.0;
-    m_graph[node].weight = 1.0;
     return node;
 }
 
-void RayGrid::Grouping::add(char ntype, ident_t chid, std::vector<ident_t> wids, float value, float weight)
+void RayGrid::Grouping::join(size_t one, size_t two)
 {
-    vertex_t node = boost::add_vertex(m_graph);
-    m_graph[node].ntype = ntype;
-    m_graph[node].ident = chid;
-    m_graph[node].value = value;
-    m_graph[node].weight = weight;
+    one = find(one);
+    two = find(two);
+    if (one == two) {
+        return;
+    }
+    // Keep the older root so roots stay the first node of a cluster.
+    if (two < one) {
+        std::swap(one, two);
+    }
+    m_parent[two] = one;
+    --m_nclusters;
+}
+
+size_t RayGrid::Grouping::push(const node_t& node)
+{
+    const size_t ind = m_nodes.size();
+    m_nodes.push_back(node);
+    m_parent.push_back(ind);
+    ++m_nclusters;
+    return ind;
+}
 
+void RayGrid::Grouping::join_wire(ident_t wid, size_t node)
+{
+    auto it = m_wid2node.find(wid);
+    if (it == m_wid2node.end()) {
+        m_wid2node.emplace(wid, node);
+        return;
+    }
+    join(it->second, node);
+}
+
+void RayGrid::Grouping::add(char ntype, ident_t chid, std::vector<ident_t> wids, float value, float weight)
+{
+    const size_t node = push(node_t{ntype, chid, value, weight});
+    m_wids.insert(m_wids.end(), wids.begin(), wids.end());
+    m_offsets.push_back(m_wids.size());
     for (const auto wid : wids) {
-        auto wnode = wire_node(wid);
-        boost::add_edge(node, wnode, m_graph);
+        join_wire(wid, node);
     }
 }
 
+void RayGrid::Grouping::add(const std::vector<node_t>& nodes,
+                            const std::vector<size_t>& offsets,
+                            const std::vector<ident_t>& wids)
+{
+    const size_t nnew = nodes.size();
+    if (offsets.size() != nnew+1) {
+        THROW(ValueError() << errmsg{"Grouping: need one more offset than nodes"});
+    }
+    const size_t first = m_nodes.size();
+    m_nodes.reserve(first + nnew);
+    m_parent.reserve(first + nnew);
+    m_offsets.reserve(m_offsets.size() + nnew);
+    for (size_t ind=0; ind<nnew; ++ind) {
+        push(nodes[ind]);
+        m_offsets.push_back(m_wids.size() + offsets[ind+1] - offsets[0]);
+    }
+    m_wids.insert(m_wids.end(), wids.begin() + offsets[0], wids.begin() + offsets[nnew]);
+
+    // Sorting by wire brings together all new nodes sharing a wire
+    // so each distinct wire is looked up only once.
+    std::vector<std::pair<ident_t, size_t> > wirenode;
+    wirenode.reserve(offsets[nnew] - offsets[0]);
+    for (size_t ind=0; ind<nnew; ++ind) {
+        for (size_t iw=offsets[ind]; iw<offsets[ind+1]; ++iw) {
+            wirenode.emplace_back(wids[iw], first+ind);
+        }
+    }
+    std::sort(wirenode.begin(), wirenode.end());
+    const size_t npairs = wirenode.size();
+    for (size_t beg=0; beg<npairs; ) {
+        const ident_t wid = wirenode[beg].first;
+        const size_t node = wirenode[beg].second;
+        size_t end = beg+1;
+        while (end < npairs and wirenode[end].first == wid) {
+            join(node, wirenode[end].second);
+            ++end;
+        }
+        join_wire(wid, node);
+        beg = end;
+    }
+}
 
 RayGrid::Grouping::clusterset_t RayGrid::Grouping::clusters()
 {
     clusterset_t ret;
-
-    std::unordered_map<vertex_t, int> stripes;
-    int nstripes = boost::connected_components(m_graph, boost::make_assoc_property_map(stripes));
-    if (!nstripes) {
-        return ret;
+    const size_t nnodes = m_nodes.size();
+    std::vector<int> number(nnodes, -1); // by root
+    int ncl = 0;
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        const size_t root = find(ind);
+        if (number[root] < 0) {
+            number[root] = ncl++;
+        }
+        ret[number[root]].push_back(m_nodes[ind]);
     }
+    return ret;
+}
 
-    for (auto& vci : stripes) {
-        vertex_t vtx = vci.first;
-        char ntype = m_graph[vtx].ntype;
-        if (ntype == 'w') {
-            continue;
+const RayGrid::Grouping::graph_t& RayGrid::Grouping::graph()
+{
+    const size_t nnodes = m_nodes.size();
+    if (nnodes == m_graph_nodes) {
+        return m_graph;
+    }
+    graph_t graph(nnodes);
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        graph[ind] = m_nodes[ind];
+    }
+    std::unordered_map<ident_t, vertex_t> wid2vtx;
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        for (size_t iw=m_offsets[ind]; iw<m_offsets[ind+1]; ++iw) {
+            const ident_t wid = m_wids[iw];
+            auto it = wid2vtx.find(wid);
+            vertex_t wvtx;
+            if (it == wid2vtx.end()) {
+                wvtx = boost::add_vertex(node_t{'w', wid, 0.0, 1.0}, graph);
+                wid2vtx[wid] = wvtx;
+            }
+            else {
+                wvtx = it->second;
+            }
+            boost::add_edge(ind, wvtx, graph);
         }
-        const size_t stripe_index = vci.second;
-        ret[stripe_index].push_back(m_graph[vtx]);
     }
-    return ret;
+    m_graph.swap(graph);
+    m_graph_nodes = nnodes;
+    return m_graph;
 }
 
 //
@@ -118,74 +214,163 @@ void RayGrid::Solving::add(const Grouping::clusterset_t& cset)
 }
 
 
-void RayGrid::Solving::solve_one(solution_t& answer,
-                                 const std::vector<vertex_t>& sources,
-                                 const std::vector<vertex_t>& measures)
+void RayGrid::Solving::solve_one(Component& comp, std::vector<size_t>& mindex)
 {
     // convert source nodes and their edge end mnodes to m vector and G matrix
-    Ress::vector_t meas = Ress::vector_t::Zero(measures.size());
-    Ress::vector_t init = Ress::vector_t::Zero(sources.size());
-    Ress::vector_t weight = Ress::vector_t::Zero(sources.size());
-    Ress::matrix_t geom = Ress::matrix_t::Zero(measures.size(), sources.size());
-    std::unordered_map<vertex_t, size_t> sv2ind, mv2ind;
-    for (size_t mind=0; mind<measures.size(); ++mind) {
+    const auto& sources = comp.sources;
+    const auto& measures = comp.measures;
+    const size_t nmeas = measures.size();
+    const size_t nsrcs = sources.size();
+    Ress::vector_t meas(nmeas);
+    Ress::vector_t init(nsrcs);
+    Ress::vector_t weight(nsrcs);
+    for (size_t mind=0; mind<nmeas; ++mind) {
         vertex_t mvtx = measures[mind];
-        mv2ind[mvtx] = mind;
+        mindex[mvtx] = mind;
         meas(mind) = m_graph[mvtx].value;
     }
-    for (size_t sind=0; sind<sources.size(); ++sind) {
-        vertex_t svtx = sources[sind];
-        sv2ind[svtx] = sind;
-        init(sind) = m_graph[svtx].value;
-        weight(sind) = m_graph[svtx].weight;
-        auto medges = boost::out_edges(svtx, m_graph);
-        for (auto mit = medges.first; mit != medges.second; ++mit) {
-            auto mvtx = target(*mit, m_graph);
-            size_t mind = mv2ind[mvtx];
-            geom(mind, sind) = 1.0;
-        }
-        // fixme: this ignores measurement weights.
+    for (size_t sind=0; sind<nsrcs; ++sind) {
+        init(sind) = m_graph[sources[sind]].value;
+        weight(sind) = m_graph[sources[sind]].weight;
     }
 
-    Ress::Params params;
-    params.model = Ress::lasso;
-    Ress::vector_t solved = Ress::solve(geom, meas, params, init, weight);
+    if (!comp.solver) {
+        // G is 0/1 and very sparse, collect only its nonzeros.
+        std::vector<Eigen::Triplet<double> > nonzeros;
+        for (size_t sind=0; sind<nsrcs; ++sind) {
+            auto medges = boost::out_edges(sources[sind], m_graph);
+            for (auto mit = medges.first; mit != medges.second; ++mit) {
+                auto mvtx = target(*mit, m_graph);
+                nonzeros.emplace_back(mindex[mvtx], sind, 1.0);
+            }
+            // fixme: this ignores measurement weights.
+        }
+        Ress::sparse_matrix_t geom(nmeas, nsrcs);
+        geom.setFromTriplets(nonzeros.begin(), nonzeros.end());
+
+        Ress::Params params;
+        params.model = Ress::lasso;
+        comp.solver.reset(new Ress::SparseSolver(geom, params));
+    }
+    comp.solver->warm_start(init);
+    const Ress::vector_t& solved = comp.solver->solve(meas, weight);
     for (int sind = 0; sind < solved.size(); ++sind) {
-        auto svtx = sources[sind];
-        m_graph[svtx].value = solved[sind];
-        answer[m_graph[svtx].ident] = solved[sind];
+        m_graph[sources[sind]].value = solved[sind];
     }
 }
 
 RayGrid::Solving::solution_t
-RayGrid::Solving::solve()
+RayGrid::Solving::solve(int nthreads)
 {
-    std::unordered_map<vertex_t, int> probs;
-    int nprobs = boost::connected_components(m_graph, boost::make_assoc_property_map(probs));
-
-
     solution_t answer;
-    if (!nprobs) {
+    const size_t nverts = boost::num_vertices(m_graph);
+    if (!nverts) {
         return answer;
     }
-    
+
+    std::vector<int> probs(nverts);
+    const int nprobs = boost::connected_components(m_graph, &probs[0]);
+
     struct SMVecs {
         std::vector<vertex_t> sources, measures;
     };
-    std::unordered_map<int, SMVecs> smvecs;
-    for (auto it : probs) {
-        auto vtx = it.first;
+    std::vector<SMVecs> smvecs(nprobs);
+    for (vertex_t vtx=0; vtx<nverts; ++vtx) {
         if (m_graph[vtx].ntype == 's') {
-            smvecs[it.second].sources.push_back(vtx);
+            smvecs[probs[vtx]].sources.push_back(vtx);
         }
         if (m_graph[vtx].ntype == 'm') {
-            smvecs[it.second].measures.push_back(vtx);
+            smvecs[probs[vtx]].measures.push_back(vtx);
         }
     }
 
-    for (auto sit : smvecs) {
-        solve_one(answer, sit.second.sources, sit.second.measures);
+    // Carry over the solver of each component which is unchanged
+    // and forget those of components which are no more.
+    std::unordered_map<vertex_t, Component> components;
+    for (const auto& sm : smvecs) {
+        if (sm.sources.empty() or sm.measures.empty()) {
+            continue;
+        }
+        const vertex_t key = sm.sources.front();
+        auto& comp = components[key];
+        auto it = m_components.find(key);
+        if (it != m_components.end() and it->second.sources == sm.sources
+            and it->second.measures == sm.measures) {
+            comp = std::move(it->second);
+            continue;
+        }
+        comp.sources = sm.sources;
+        comp.measures = sm.measures;
     }
-    return answer;
+    m_components.swap(components);
 
+    // Typically there are very many tiny problems and a few large
+    // ones.  Start the large ones first so they do not end up last
+    // on one thread and gang up the small ones so each task is worth
+    // the scheduling.
+    std::vector<size_t> order(nprobs);
+    for (int ind=0; ind<nprobs; ++ind) {
+        order[ind] = ind;
+    }
+    auto cost = [&](size_t ind) {
+        return smvecs[ind].sources.size() * smvecs[ind].measures.size();
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return cost(a) > cost(b);
+        });
+    const size_t min_task_cost = 1024;
+    std::vector<size_t> tasks;  // start of each task in order
+    size_t task_cost = min_task_cost;
+    for (int ind=0; ind<nprobs; ++ind) {
+        if (task_cost >= min_task_cost) {
+            tasks.push_back(ind);
+            task_cost = 0;
+        }
+        task_cost += cost(order[ind]);
+    }
+    tasks.push_back(nprobs);
+    const size_t ntasks = tasks.size()-1;
+
+    // Components have distinct vertices so solving them concurrently
+    // touches distinct parts of the graph and of mindex.
+    std::vector<size_t> mindex(nverts);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        while (true) {
+            const size_t itask = next++;
+            if (itask >= ntasks) {
+                return;
+            }
+            for (size_t ind=tasks[itask]; ind<tasks[itask+1]; ++ind) {
+                const auto& sm = smvecs[order[ind]];
+                if (sm.sources.empty() or sm.measures.empty()) {
+                    continue;
+                }
+                solve_one(m_components.at(sm.sources.front()), mindex);
+            }
+        }
+    };
+    nthreads = std::max(1, std::min<int>(nthreads, ntasks));
+    if (nthreads == 1) {
+        worker();
+    }
+    else {
+        std::vector<std::thread> threads;
+        for (int ith=0; ith<nthreads; ++ith) {
+            threads.emplace_back(worker);
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    // Every source gets an answer.  Those with no measurement to
+    // constrain them keep their initial value.
+    for (const auto& sm : smvecs) {
+        for (auto svtx : sm.sources) {
+            const auto& node = m_graph[svtx];
+            answer[node.ident] = node.value;
+        }
+    }
+    return answer;
 }
@@ -2,7 +2,9 @@
 #include "WireCellUtil/Logging.h"
 
 #include <algorithm>
+#include <atomic>
 #include <sstream>
+#include <thread>
 
 
 using namespace WireCell;
@@ -145,21 +147,27 @@ crossings_t find_corners(const Strip& one, const Strip& two)
 
 void Blob::add(const Coordinates& coords, const Strip& strip)
 {
+    crossings_t surviving;
+    corners_with(coords, strip, surviving);
+    m_corners.swap(surviving);
+    m_strips.push_back(strip);
+}
+
+void Blob::corners_with(const Coordinates& coords, const Strip& strip,
+                        crossings_t& surviving) const
+{
+    surviving.clear();
     const size_t nstrips = m_strips.size();
 
     if (nstrips == 0) {         // special case
-        m_strips.push_back(strip);
         return;
     }
 
     if (nstrips == 1) {         // special case
-        m_strips.push_back(strip);
-        m_corners = find_corners(m_strips.front(), m_strips.back());
+        surviving = find_corners(m_strips.front(), strip);
         return;
     }
 
-    crossings_t surviving;
-
     // See what old corners are inside the new strip
     for (const auto& c : m_corners) {
         const double pitch = coords.pitch_location(c.first, c.second, strip.layer);
@@ -195,8 +203,16 @@ void Blob::add(const Coordinates& coords, const Strip& strip)
             }
         }
     }
-    m_corners = surviving;
-    m_strips.push_back(strip);
+}
+
+Blob Blob::extend(const Strip& strip, const crossings_t& corners) const
+{
+    Blob ret;
+    ret.m_strips.reserve(m_strips.size()+1);
+    ret.m_strips = m_strips;
+    ret.m_strips.push_back(strip);
+    ret.m_corners = corners;
+    return ret;
 }
 
 const crossings_t& Blob::corners() const
@@ -236,15 +252,12 @@ Activity Tiling::projection(const Blob& blob, const Activity& activity)
     const double pitch_mag = m_coords.pitch_mags()[activity.layer()];
 
     // find extreme pitches
-    std::vector<double> pitches;
-    const auto corners = blob.corners();
+    auto& pitches = m_pitches;
+    const auto& corners = blob.corners();
     if (corners.empty()) {
         return Activity(activity.layer());
     }
-    for (const auto& c : blob.corners()) {
-        const double p = m_coords.pitch_location(c.first, c.second, activity.layer());
-        pitches.push_back(p);
-    }
+    m_coords.pitch_locations(corners, activity.layer(), pitches);
     if (pitches.empty()) {
         return Activity(activity.layer());
     }
@@ -309,13 +322,13 @@ blobs_t Tiling::operator()(const blobs_t& prior_blobs,
             continue;
         }
         auto strips = proj.make_strips();
-        for (auto strip : strips) {
-            Blob newblob = blob; // copy
-            newblob.add(m_coords, strip);
-            if (newblob.corners().empty()) {
+        for (const auto& strip : strips) {
+            // Only candidates which keep some corners are copied.
+            blob.corners_with(m_coords, strip, m_corners);
+            if (m_corners.empty()) {
                 continue;
             }
-            ret.push_back(newblob);
+            ret.push_back(blob.extend(strip, m_corners));
         }
     }
 
@@ -368,9 +381,9 @@ void WireCell::RayGrid::prune(const Coordinates& coords, blobs_t& blobs)
     }
 }
 
-blobs_t WireCell::RayGrid::make_blobs(const Coordinates& coords, const activities_t& activities)
+static
+blobs_t tile_one(Tiling& rc, const Coordinates& coords, const activities_t& activities)
 {
-    Tiling rc(coords);
     blobs_t blobs;
 
     for (const auto& activity : activities) {
@@ -390,3 +403,46 @@ blobs_t WireCell::RayGrid::make_blobs(const Coordinates& coords, const activitie
     return blobs;
 }
 
+blobs_t WireCell::RayGrid::make_blobs(const Coordinates& coords, const activities_t& activities)
+{
+    Tiling rc(coords);
+    return tile_one(rc, coords, activities);
+}
+
+std::vector<blobs_t> WireCell::RayGrid::make_blobs(const Coordinates& coords,
+                                                   const std::vector<activities_t>& slices,
+                                                   int nthreads)
+{
+    const size_t nslices = slices.size();
+    std::vector<blobs_t> ret(nslices);
+
+    // Slices vary a lot in cost so each thread takes the next
+    // untiled slice.  Results go by slice index so the output does
+    // not depend on scheduling.  Each thread has its own Tiling and
+    // thus its own scratch.
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        Tiling rc(coords);
+        while (true) {
+            const size_t ind = next++;
+            if (ind >= nslices) {
+                return;
+            }
+            ret[ind] = tile_one(rc, coords, slices[ind]);
+        }
+    };
+
+    nthreads = std::max(1, std::min<int>(nthreads, nslices));
+    if (nthreads == 1) {
+        worker();
+        return ret;
+    }
+    std::vector<std::thread> threads;
+    for (int ith=0; ith<nthreads; ++ith) {
+        threads.emplace_back(worker);
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    return ret;
+}
@@ -2,13 +2,26 @@
 #include "WireCellUtil/ExecMon.h"
 #include "WireCellUtil/Response.h"
 #include "WireCellUtil/Logging.h"
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/SingleFlight.h"
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
 #include <cmath>
+#include <cstring>
+#include <fstream>
 #include <set>
 
 using spdlog::error;
 
 using namespace WireCell;
 
+namespace {
+    // True if the file starts with the binary format's magic,
+    // whether or not this build can read it.
+    bool wcfr_marked(const std::string& filename);
+}
+
 
 Response::Schema::FieldResponse::~FieldResponse()
 {
@@ -42,6 +55,11 @@ WireCell::Response::Schema::FieldResponse WireCell::Response::Schema::load(const
         error("Response::Schema::load(): empty field response file name");
         return FieldResponse();
     }
+    const std::string path = WireCell::Persist::resolve(filename);
+    if (!path.empty() and wcfr_marked(path)) {
+        // Binary files this build can not read are reported as such.
+        return MappedFieldResponse(path).field_response();
+    }
     Json::Value top = WireCell::Persist::load(filename);
     if (top.isNull()) {
         error("Response::Schema::load(): failed to load {}", filename);
@@ -52,44 +70,390 @@ WireCell::Response::Schema::FieldResponse WireCell::Response::Schema::load(const
     using namespace WireCell::Response::Schema;
 
     std::vector<PlaneResponse> planes;
-    for (auto plane : fr["planes"]) {
+    planes.reserve(fr["planes"].size());
+    for (const auto& plane : fr["planes"]) {
 
-	auto plr = plane["PlaneResponse"];
+	const auto& plr = plane["PlaneResponse"];
 
 	std::vector<PathResponse> paths;
-	for (auto path : plr["paths"]) {
-	    auto par = path["PathResponse"];
-	    WireCell::Waveform::realseq_t current;
-	    for (auto c : par["current"]["array"]["elements"]) {
-		current.push_back(c.asDouble());
+	paths.reserve(plr["paths"].size());
+	for (const auto& path : plr["paths"]) {
+	    const auto& par = path["PathResponse"];
+	    const auto& jcur = par["current"]["array"]["elements"];
+	    paths.emplace_back();
+	    auto& wcpath = paths.back();
+	    wcpath.pitchpos = par["pitchpos"].asDouble();
+	    wcpath.wirepos = par["wirepos"].asDouble();
+	    wcpath.current.reserve(jcur.size());
+	    for (const auto& c : jcur) {
+		wcpath.current.push_back(c.asDouble());
 	    }
-	    auto wcpath = PathResponse(current, par["pitchpos"].asDouble(), par["wirepos"].asDouble());
-	    paths.push_back(wcpath);
 	}
 
-	PlaneResponse wcplr(paths,
-                            plr["planeid"].asInt(),
-                            plr["location"].asDouble(),
-                            plr["pitch"].asDouble());
-
-	planes.push_back(wcplr);
+	planes.emplace_back();
+	auto& wcplr = planes.back();
+	wcplr.paths = std::move(paths);
+	wcplr.planeid = plr["planeid"].asInt();
+	wcplr.location = plr["location"].asDouble();
+	wcplr.pitch = plr["pitch"].asDouble();
     }
     
     auto adir = fr["axis"];
-    auto axis = WireCell::Vector(adir[0].asDouble(),adir[1].asDouble(),adir[2].asDouble());
-    auto ret = FieldResponse(planes, axis,
-			     fr["origin"].asDouble(),
-                             fr["tstart"].asDouble(),
-                             fr["period"].asDouble(),
-                             fr["speed"].asDouble());
+    FieldResponse ret;
+    ret.planes = std::move(planes);
+    ret.axis = WireCell::Vector(adir[0].asDouble(),adir[1].asDouble(),adir[2].asDouble());
+    ret.origin = fr["origin"].asDouble();
+    ret.tstart = fr["tstart"].asDouble();
+    ret.period = fr["period"].asDouble();
+    ret.speed = fr["speed"].asDouble();
     return ret;
 }
 
 
+/*
+ Binary field response format.  All values are in the byte order of
+ the writer, which the header records, and every field is naturally
+ aligned.
+
+ header:      char magic[4] = "WCFR"; uint32 byteorder = 0x01020304;
+              uint32 version; uint32 unused;
+              double axis[3], origin, tstart, period, speed;
+              uint64 nplanes;
+ plane table: nplanes x {int64 planeid; double location, pitch;
+                         uint64 npaths, nticks, offset}
+ plane data:  at offset (a multiple of 8) from the start of file:
+              double pitchpos[npaths], wirepos[npaths];
+              uint64 nsamples[npaths];
+              float current[npaths][nticks], zero padded per path,
+              then padding to a multiple of 8 bytes.
+ */
+namespace {
+    const char wcfr_magic[4] = {'W','C','F','R'};
+    const uint32_t wcfr_byteorder = 0x01020304;
+    const uint32_t wcfr_version = 2;
+
+    struct wcfr_prefix_t {
+        char magic[4];
+        uint32_t byteorder;
+        uint32_t version;
+        uint32_t unused;
+    };
+
+    struct wcfr_header_t {
+        wcfr_prefix_t prefix;
+        double axis[3];
+        double origin, tstart, period, speed;
+        uint64_t nplanes;
+    };
+    struct wcfr_plane_t {
+        int64_t planeid;
+        double location, pitch;
+        uint64_t npaths, nticks, offset;
+    };
+
+    size_t wcfr_padded(size_t nbytes) { return (nbytes + 7) & ~size_t(7); }
+
+    size_t wcfr_plane_size(size_t npaths, size_t nticks) {
+        return wcfr_padded(npaths*(2*sizeof(double) + sizeof(uint64_t)) + npaths*nticks*sizeof(float));
+    }
+
+    bool wcfr_has_magic(const wcfr_prefix_t& pre) {
+        return std::memcmp(pre.magic, wcfr_magic, 4) == 0;
+    }
+
+    // Return why a file with this prefix can not be read in place or
+    // empty if it can.
+    std::string wcfr_problem(const wcfr_prefix_t& pre) {
+        if (!wcfr_has_magic(pre)) {
+            return "not a binary field response";
+        }
+        if (pre.byteorder != wcfr_byteorder) {
+            if (pre.byteorder == __builtin_bswap32(wcfr_byteorder)) {
+                return "binary field response of the other byte order";
+            }
+            return "binary field response of unknown byte order";
+        }
+        if (pre.version != wcfr_version) {
+            return "binary field response of unsupported version "
+                + std::to_string(pre.version);
+        }
+        return "";
+    }
+
+    // Read the prefix, returning false if the file is too short.
+    bool wcfr_read_prefix(const std::string& filename, wcfr_prefix_t& pre) {
+        std::ifstream fp(filename, std::ios::binary);
+        fp.read(reinterpret_cast<char*>(&pre), sizeof(pre));
+        return bool(fp);
+    }
+
+    bool wcfr_marked(const std::string& filename) {
+        wcfr_prefix_t pre;
+        return wcfr_read_prefix(filename, pre) and wcfr_has_magic(pre);
+    }
+
+    bool ends_with(const std::string& str, const std::string& suffix) {
+        return str.size() >= suffix.size()
+            and str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    Json::Value to_json(const Response::Schema::FieldResponse& fr)
+    {
+        Json::Value jplanes(Json::arrayValue);
+        for (const auto& plane : fr.planes) {
+            Json::Value jpaths(Json::arrayValue);
+            for (const auto& path : plane.paths) {
+                Json::Value jcur(Json::arrayValue);
+                for (auto c : path.current) {
+                    jcur.append(c);
+                }
+                Json::Value jarr;
+                jarr["shape"].append((Json::UInt64)path.current.size());
+                jarr["elements"] = jcur;
+                Json::Value jpath;
+                jpath["current"]["array"] = jarr;
+                jpath["pitchpos"] = path.pitchpos;
+                jpath["wirepos"] = path.wirepos;
+                Json::Value one;
+                one["PathResponse"] = jpath;
+                jpaths.append(one);
+            }
+            Json::Value jplane;
+            jplane["paths"] = jpaths;
+            jplane["planeid"] = plane.planeid;
+            jplane["location"] = plane.location;
+            jplane["pitch"] = plane.pitch;
+            Json::Value one;
+            one["PlaneResponse"] = jplane;
+            jplanes.append(one);
+        }
+        Json::Value jfr;
+        jfr["planes"] = jplanes;
+        for (int ind=0; ind<3; ++ind) {
+            jfr["axis"].append(fr.axis[ind]);
+        }
+        jfr["origin"] = fr.origin;
+        jfr["tstart"] = fr.tstart;
+        jfr["period"] = fr.period;
+        jfr["speed"] = fr.speed;
+        Json::Value top;
+        top["FieldResponse"] = jfr;
+        return top;
+    }
+
+    void dump_binary(const std::string& filename, const Response::Schema::FieldResponse& fr)
+    {
+        const size_t nplanes = fr.planes.size();
+
+        wcfr_header_t head;
+        std::memcpy(head.prefix.magic, wcfr_magic, 4);
+        head.prefix.byteorder = wcfr_byteorder;
+        head.prefix.version = wcfr_version;
+        head.prefix.unused = 0;
+        for (int ind=0; ind<3; ++ind) {
+            head.axis[ind] = fr.axis[ind];
+        }
+        head.origin = fr.origin;
+        head.tstart = fr.tstart;
+        head.period = fr.period;
+        head.speed = fr.speed;
+        head.nplanes = nplanes;
+
+        std::vector<wcfr_plane_t> table(nplanes);
+        size_t offset = sizeof(wcfr_header_t) + nplanes*sizeof(wcfr_plane_t);
+        for (size_t ipl=0; ipl<nplanes; ++ipl) {
+            const auto& plane = fr.planes[ipl];
+            size_t nticks = 0;
+            for (const auto& path : plane.paths) {
+                nticks = std::max(nticks, path.current.size());
+            }
+            auto& tab = table[ipl];
+            tab.planeid = plane.planeid;
+            tab.location = plane.location;
+            tab.pitch = plane.pitch;
+            tab.npaths = plane.paths.size();
+            tab.nticks = nticks;
+            tab.offset = offset;
+            offset += wcfr_plane_size(tab.npaths, nticks);
+        }
+
+        std::ofstream fp(filename, std::ios::binary);
+        if (!fp) {
+            THROW(IOError() << errmsg{"Response::Schema::dump(): can not open " + filename});
+        }
+        fp.write(reinterpret_cast<const char*>(&head), sizeof(head));
+        fp.write(reinterpret_cast<const char*>(table.data()), nplanes*sizeof(wcfr_plane_t));
+
+        std::vector<char> buf;
+        for (size_t ipl=0; ipl<nplanes; ++ipl) {
+            const auto& plane = fr.planes[ipl];
+            const auto& tab = table[ipl];
+            const size_t npaths = tab.npaths, nticks = tab.nticks;
+            buf.assign(wcfr_plane_size(npaths, nticks), 0);
+            double* pitchpos = reinterpret_cast<double*>(buf.data());
+            double* wirepos = pitchpos + npaths;
+            uint64_t* nsamples = reinterpret_cast<uint64_t*>(wirepos + npaths);
+            float* current = reinterpret_cast<float*>(nsamples + npaths);
+            for (size_t ipath=0; ipath<npaths; ++ipath) {
+                const auto& path = plane.paths[ipath];
+                pitchpos[ipath] = path.pitchpos;
+                wirepos[ipath] = path.wirepos;
+                nsamples[ipath] = path.current.size();
+                std::copy(path.current.begin(), path.current.end(), current + ipath*nticks);
+            }
+            fp.write(buf.data(), buf.size());
+        }
+        if (!fp) {
+            THROW(IOError() << errmsg{"Response::Schema::dump(): failed to write " + filename});
+        }
+    }
+}
 
 void Response::Schema::dump(const char* filename, const Response::Schema::FieldResponse& fr)
+{
+    const std::string fname = filename;
+    if (ends_with(fname, ".json") or ends_with(fname, ".json.bz2")) {
+        Persist::dump(fname, to_json(fr));
+        return;
+    }
+    dump_binary(fname, fr);
+}
+
+
+struct Response::Schema::MappedFieldResponse::Mapping {
+    boost::iostreams::mapped_file_source file;
+};
+
+bool Response::Schema::MappedFieldResponse::is_binary(const std::string& filename)
+{
+    wcfr_prefix_t pre;
+    return wcfr_read_prefix(filename, pre) and wcfr_problem(pre).empty();
+}
+
+Response::Schema::MappedFieldResponse::MappedFieldResponse(const std::string& filename)
+    : m_map(std::make_shared<Mapping>())
+{
+    const std::string bad = "MappedFieldResponse: not a binary field response: " + filename;
+    try {
+        m_map->file.open(filename);
+    }
+    catch (const std::exception& err) {
+        THROW(IOError() << errmsg{"MappedFieldResponse: failed to map " + filename + ": " + err.what()});
+    }
+    const char* data = m_map->file.data();
+    const size_t size = m_map->file.size();
+    if (size < sizeof(wcfr_header_t)) {
+        THROW(IOError() << errmsg{bad});
+    }
+    const std::string problem = wcfr_problem(*reinterpret_cast<const wcfr_prefix_t*>(data));
+    if (!problem.empty()) {
+        THROW(IOError() << errmsg{"MappedFieldResponse: " + problem + ": " + filename});
+    }
+
+    // The mapping is page aligned and every field is naturally
+    // aligned so the image may be used in place.
+    const auto* head = reinterpret_cast<const wcfr_header_t*>(data);
+    m_axis = WireCell::Vector(head->axis[0], head->axis[1], head->axis[2]);
+    m_origin = head->origin;
+    m_tstart = head->tstart;
+    m_period = head->period;
+    m_speed = head->speed;
+
+    const size_t nplanes = head->nplanes;
+    if (nplanes > (size - sizeof(wcfr_header_t))/sizeof(wcfr_plane_t)) {
+        THROW(IOError() << errmsg{bad});
+    }
+    const auto* table = reinterpret_cast<const wcfr_plane_t*>(data + sizeof(wcfr_header_t));
+    m_planes.resize(nplanes);
+    for (size_t ipl=0; ipl<nplanes; ++ipl) {
+        const auto& tab = table[ipl];
+        const size_t npaths = tab.npaths, nticks = tab.nticks;
+        if (tab.offset % 8 or tab.offset > size
+            or (nticks and npaths > size/nticks)
+            or wcfr_plane_size(npaths, nticks) > size - tab.offset) {
+            THROW(IOError() << errmsg{bad});
+        }
+        auto& pl = m_planes[ipl];
+        pl.planeid = tab.planeid;
+        pl.location = tab.location;
+        pl.pitch = tab.pitch;
+        pl.npaths = npaths;
+        pl.nticks = nticks;
+        pl.pitchpos = reinterpret_cast<const double*>(data + tab.offset);
+        pl.wirepos = pl.pitchpos + npaths;
+        pl.nsamples = reinterpret_cast<const uint64_t*>(pl.wirepos + npaths);
+        pl.current = reinterpret_cast<const float*>(pl.nsamples + npaths);
+        for (size_t ipath=0; ipath<npaths; ++ipath) {
+            if (pl.nsamples[ipath] > nticks) {
+                THROW(IOError() << errmsg{bad});
+            }
+        }
+    }
+}
+
+const Response::Schema::MappedFieldResponse::Plane*
+Response::Schema::MappedFieldResponse::plane(int ident) const
+{
+    for (const auto& pl : m_planes) {
+        if (pl.planeid == ident) {
+            return &pl;
+        }
+    }
+    return nullptr;
+}
+
+Response::Schema::FieldResponse Response::Schema::MappedFieldResponse::field_response() const
+{
+    FieldResponse ret;
+    ret.axis = m_axis;
+    ret.origin = m_origin;
+    ret.tstart = m_tstart;
+    ret.period = m_period;
+    ret.speed = m_speed;
+    ret.planes.resize(m_planes.size());
+    for (size_t ipl=0; ipl<m_planes.size(); ++ipl) {
+        const auto& pl = m_planes[ipl];
+        auto& plane = ret.planes[ipl];
+        plane.planeid = pl.planeid;
+        plane.location = pl.location;
+        plane.pitch = pl.pitch;
+        plane.paths.resize(pl.npaths);
+        for (size_t ipath=0; ipath<pl.npaths; ++ipath) {
+            auto& path = plane.paths[ipath];
+            path.pitchpos = pl.pitchpos[ipath];
+            path.wirepos = pl.wirepos[ipath];
+            const float* cur = pl.current + ipath*pl.nticks;
+            path.current.assign(cur, cur + pl.nsamples[ipath]);
+        }
+    }
+    return ret;
+}
+
+
+namespace {
+    SingleFlight<Response::Schema::FieldResponsePtr> gFieldResponseCache;
+}
+
+Response::Schema::FieldResponsePtr Response::Schema::load_shared(const char* filename)
+{
+    if (!filename) {
+        error("Response::Schema::load_shared(): empty field response file name");
+        return std::make_shared<const FieldResponse>();
+    }
+    std::string key = WireCell::Persist::resolve(filename);
+    if (key.empty()) {
+        key = filename;
+    }
+    // An empty response is a failed load, which is not kept so that
+    // a later call may retry.
+    return gFieldResponseCache.get(key, [&]() {
+            return std::make_shared<const FieldResponse>(load(key.c_str()));
+        }, [](const FieldResponsePtr& fr) { return !fr->planes.empty(); });
+}
 
+void Response::Schema::clear_shared()
 {
+    gFieldResponseCache.clear();
 }
 
 
@@ -4,11 +4,11 @@
 
 using namespace WireCell;
 
-Ress::vector_t Ress::solve(Ress::matrix_t matrix,
-                           Ress::vector_t measured,
+Ress::vector_t Ress::solve(const Ress::matrix_t& matrix,
+                           const Ress::vector_t& measured,
                            const Ress::Params& params,
-                           Ress::vector_t initial,
-                           Ress::vector_t weights)
+                           const Ress::vector_t& initial,
+                           const Ress::vector_t& weights)
 {
     // Provide a uniform interface to RESS solving models.  RESS
     // *almost* already provides this.
@@ -44,22 +44,22 @@ Ress::vector_t Ress::solve(Ress::matrix_t matrix,
     return Ress::vector_t();
 }
 
-double Ress::chi2_l1(vector_t measured, vector_t solved, double lambda)
+double Ress::chi2_l1(const vector_t& measured, const vector_t& solved, double lambda)
 {
     return 2 * lambda * solved.lpNorm<1>() * measured.size();
 }
 
-Ress::vector_t Ress::predict(matrix_t response, vector_t source)
+Ress::vector_t Ress::predict(const matrix_t& response, const vector_t& source)
 {
     return response * source;
 }
 
-double Ress::chi2(vector_t measured, vector_t predicted)
+double Ress::chi2(const vector_t& measured, const vector_t& predicted)
 {
     return ( measured- predicted ).squaredNorm();
 }
 
-double Ress::mean_residual(vector_t measured, vector_t predicted)
+double Ress::mean_residual(const vector_t& measured, const vector_t& predicted)
 {
     return ( measured - predicted ).norm() / measured.size();
 }
@@ -0,0 +1,139 @@
+#include "WireCellUtil/Ress.h"
+#include "WireCellUtil/Exceptions.h"
+
+using namespace WireCell;
+
+Ress::SparseSolver::SparseSolver(const sparse_matrix_t& response, const Params& params)
+    : m_response(response)
+    , m_gram(response.transpose() * response)
+    , m_diag(m_gram.diagonal())
+    , m_params(params)
+    , m_beta(vector_t::Zero(response.cols()))
+    , m_niter(0)
+{
+    m_response.makeCompressed();
+    m_gram.makeCompressed();
+    if (m_params.model == lasso) {
+        m_params.alpha = 1.0;
+    }
+}
+
+void Ress::SparseSolver::warm_start(const vector_t& source)
+{
+    if (source.size() != m_beta.size()) {
+        THROW(ValueError() << errmsg{"Ress::SparseSolver: warm start of wrong size"});
+    }
+    m_beta = source;
+}
+
+const Ress::vector_t& Ress::SparseSolver::solve(const vector_t& measured, const vector_t& weights)
+{
+    const int nbeta = m_beta.size();
+    if (measured.size() != m_response.rows()) {
+        THROW(ValueError() << errmsg{"Ress::SparseSolver: measurement of wrong size"});
+    }
+    if (weights.size() and weights.size() != nbeta) {
+        THROW(ValueError() << errmsg{"Ress::SparseSolver: weights of wrong size"});
+    }
+
+    // With c = R^T*m and q = G*s, the correlation of column j with
+    // the residual excluding j is c_j - q_j + G_jj*s_j.  Keeping q
+    // up to date costs one sparse Gram column per changed s_j.
+    const vector_t corr = m_response.transpose() * measured;
+    vector_t gs = m_gram * m_beta;
+
+    // As wire-cell-ress, the l1 penalty grows with the number of
+    // measurements (see chi2_l1()) and the l2 penalty shrinks the
+    // coefficient by a factor 1+lambda*(1-alpha)*w.
+    const double lambda = m_params.lambda;
+    const double nmeas = measured.size();
+    const double alpha = m_params.alpha;
+    const bool nonneg = m_params.non_negative;
+
+    auto update = [&](int j) -> double {
+        const double gjj = m_diag[j];
+        if (gjj <= 0) {         // column unused
+            m_beta[j] = 0;
+            return 0;
+        }
+        const double wj = weights.size() ? weights[j] : 1.0;
+        const double l1 = lambda * alpha * wj * nmeas;
+        const double shrink = gjj * (1 + lambda * (1-alpha) * wj);
+        const double rho = corr[j] - gs[j] + gjj*m_beta[j];
+
+        double val = 0;
+        if (rho > l1) {
+            val = (rho - l1) / shrink;
+        }
+        else if (rho < -l1 and !nonneg) {
+            val = (rho + l1) / shrink;
+        }
+
+        const double delta = val - m_beta[j];
+        if (delta == 0) {
+            return 0;
+        }
+        for (sparse_matrix_t::InnerIterator it(m_gram, j); it; ++it) {
+            gs[it.row()] += it.value() * delta;
+        }
+        m_beta[j] = val;
+        return delta*delta;
+    };
+
+    // Same convergence criteria as wire-cell-ress.
+    const double tol2 = m_params.tolerance * m_params.tolerance * nbeta;
+
+    m_niter = 0;
+    while (m_niter < m_params.max_iter) {
+        // A full sweep lets any coefficient join the active set.
+        double change = 0;
+        for (int j=0; j<nbeta; ++j) {
+            change += update(j);
+        }
+        ++m_niter;
+        if (change < tol2) {
+            break;
+        }
+
+        m_active.clear();
+        for (int j=0; j<nbeta; ++j) {
+            if (m_beta[j] != 0) {
+                m_active.push_back(j);
+            }
+        }
+        while (m_niter < m_params.max_iter) {
+            change = 0;
+            for (int j : m_active) {
+                change += update(j);
+            }
+            ++m_niter;
+            if (change < tol2) {
+                break;
+            }
+        }
+    }
+
+    m_active.clear();
+    for (int j=0; j<nbeta; ++j) {
+        if (m_beta[j] != 0) {
+            m_active.push_back(j);
+        }
+    }
+    return m_beta;
+}
+
+Ress::vector_t Ress::solve(const sparse_matrix_t& response,
+                           const vector_t& measured,
+                           const Params& params,
+                           const vector_t& source,
+                           const vector_t& weights)
+{
+    if (params.model != lasso and params.model != elnet) {
+        return vector_t();
+    }
+    SparseSolver solver(response, params);
+    if (source.size()) {
+        solver.warm_start(source);
+    }
+    return solver.solve(measured, weights);
+}
@@ -0,0 +1,148 @@
+#include "WireCellUtil/RingHistogram2D.h"
+
+#include <algorithm>
+
+using namespace WireCell;
+using namespace std;
+
+
+template<typename T>
+RingHistogram2D<T>::RingHistogram2D(int ny, double xbinsize, double ybinsize,
+				    double xmin, double ymin, int nxreserve)
+    : m_ny(std::max(ny, 0))
+    , m_xmin(xmin), m_ymin(ymin), m_xbinsize(xbinsize), m_ybinsize(ybinsize)
+    , m_cap(0), m_head(0), m_nx(0)
+{
+    reserve(std::max(nxreserve, 1));
+}
+
+template<typename T>
+void RingHistogram2D<T>::reserve(int nx)
+{
+    if (nx <= m_cap) {
+	return;
+    }
+    int cap = std::max(m_cap, 1);
+    while (cap < nx) {
+	cap *= 2;
+    }
+    std::vector<T> buf(size_t(cap)*m_ny, 0);
+    for (int ind=0; ind<m_nx; ++ind) {
+	const T* src = m_buf.data() + offset(ind);
+	std::copy(src, src + m_ny, buf.data() + size_t(ind)*m_ny);
+    }
+    m_buf.swap(buf);
+    m_cap = cap;
+    m_head = 0;
+}
+
+// Binning as BufferedHistogram2D::fill().
+template<typename T>
+bool RingHistogram2D<T>::fill(double x, double y, T v)
+{
+    int ybin = (y - m_ymin)/m_ybinsize;
+    if (ybin < 0 or ybin >= m_ny) {
+	return false;
+    }
+    int xbin = (x - m_xmin)/m_xbinsize;
+    if (xbin < 0) {
+	return false;
+    }
+    if (xbin >= m_nx) {
+	reserve(xbin+1);
+	m_nx = xbin+1;
+    }
+    m_buf[offset(xbin) + ybin] += v;
+    return true;
+}
+
+template<typename T>
+size_t RingHistogram2D<T>::fill(size_t n, const double* xs, const double* ys, const T* vs)
+{
+    const double xmin = m_xmin, ymin = m_ymin, xbs = m_xbinsize, ybs = m_ybinsize;
+    const int ny = m_ny;
+
+    // Find the extent first so the buffer grows at most once.
+    int xmax = m_nx;
+    for (size_t ind=0; ind<n; ++ind) {
+	const int ybin = (ys[ind] - ymin)/ybs;
+	const int xbin = (xs[ind] - xmin)/xbs;
+	if (ybin < 0 or ybin >= ny) {
+	    continue;
+	}
+	xmax = std::max(xmax, xbin+1);
+    }
+    if (xmax > m_nx) {
+	reserve(xmax);
+    }
+
+    T* buf = m_buf.data();
+    const int mask = m_cap-1, head = m_head;
+    int nx = m_nx;
+    size_t nfilled = 0;
+    for (size_t ind=0; ind<n; ++ind) {
+	const int ybin = (ys[ind] - ymin)/ybs;
+	const int xbin = (xs[ind] - xmin)/xbs;
+	if (ybin < 0 or ybin >= ny or xbin < 0) {
+	    continue;
+	}
+	nx = std::max(nx, xbin+1);
+	buf[size_t((head+xbin) & mask)*ny + ybin] += vs ? vs[ind] : T(1);
+	++nfilled;
+    }
+    m_nx = nx;
+    return nfilled;
+}
+
+template<typename T>
+size_t RingHistogram2D<T>::fill(const std::vector<double>& xs, const std::vector<double>& ys,
+				const std::vector<T>& vs)
+{
+    size_t n = std::min(xs.size(), ys.size());
+    if (vs.empty()) {
+	return fill(n, xs.data(), ys.data());
+    }
+    n = std::min(n, vs.size());
+    return fill(n, xs.data(), ys.data(), vs.data());
+}
+
+template<typename T>
+const T* RingHistogram2D<T>::xbin(int ind) const
+{
+    if (ind < 0 or ind >= m_nx) {
+	return nullptr;
+    }
+    return m_buf.data() + offset(ind);
+}
+
+template<typename T>
+bool RingHistogram2D<T>::popx(T* out)
+{
+    if (!m_nx) {
+	return false;
+    }
+    T* first = m_buf.data() + offset(0);
+    if (out) {
+	std::copy(first, first + m_ny, out);
+    }
+    std::fill(first, first + m_ny, 0);
+    m_head = (m_head + 1) & (m_cap-1);
+    --m_nx;
+    m_xmin += m_xbinsize;
+    return true;
+}
+
+template<typename T>
+std::vector<T> RingHistogram2D<T>::popx()
+{
+    std::vector<T> ret;
+    if (!m_nx) { return ret; }
+    ret.resize(m_ny);
+    popx(ret.data());
+    return ret;
+}
+
+namespace WireCell {
+    template class RingHistogram2D<double>;
+    template class RingHistogram2D<float>;
+}
@@ -0,0 +1,135 @@
+#include "WireCellUtil/ShortHistogram.h"
+
+#include <algorithm>
+
+using namespace WireCell;
+using namespace WireCell::Waveform;
+
+// Number of partial histograms filled round robin.
+static const size_t nways = 4;
+
+void ShortHistogram::fill(const short* vals, size_t n, size_t stride)
+{
+    if (!n) {
+        m_lo = 0;
+        m_nbins = 0;
+        return;
+    }
+
+    // The counting loop below needs contiguous samples.
+    if (stride != 1) {
+        m_gather.resize(n);
+        for (size_t ind=0; ind<n; ++ind) {
+            m_gather[ind] = vals[ind*stride];
+        }
+        vals = m_gather.data();
+    }
+
+    // Simple min/max reduction which the compiler vectorizes.
+    short lo = vals[0], hi = vals[0];
+    for (size_t ind=0; ind<n; ++ind) {
+        lo = std::min(lo, vals[ind]);
+        hi = std::max(hi, vals[ind]);
+    }
+    m_lo = lo;
+    m_nbins = int(hi) - int(lo) + 1;
+
+    const size_t nbins = m_nbins;
+    if (m_hist.size() < nways*nbins) {
+        m_hist.resize(nways*nbins);
+    }
+    std::fill(m_hist.begin(), m_hist.begin() + nways*nbins, 0);
+
+    unsigned int* h0 = m_hist.data();
+    unsigned int* h1 = h0 + nbins;
+    unsigned int* h2 = h1 + nbins;
+    unsigned int* h3 = h2 + nbins;
+
+    size_t ind = 0;
+    for (; ind + nways <= n; ind += nways) {
+        ++h0[vals[ind+0] - lo];
+        ++h1[vals[ind+1] - lo];
+        ++h2[vals[ind+2] - lo];
+        ++h3[vals[ind+3] - lo];
+    }
+    for (; ind<n; ++ind) {
+        ++h0[vals[ind] - lo];
+    }
+    for (size_t bin=0; bin<nbins; ++bin) {
+        h0[bin] += h1[bin] + h2[bin] + h3[bin];
+    }
+}
+
+short ShortHistogram::mode() const
+{
+    if (!m_nbins) {
+        return 0;
+    }
+    auto beg = m_hist.begin();
+    auto it = std::max_element(beg, beg + m_nbins);
+    return m_lo + (it - beg);
+}
+
+unsigned int ShortHistogram::count(short val) const
+{
+    const int bin = int(val) - m_lo;
+    if (bin < 0 or bin >= (int)m_nbins) {
+        return 0;
+    }
+    return m_hist[bin];
+}
+
+std::vector<short> Waveform::most_frequent_rows(const Array::array_xxs& arr)
+{
+    const size_t nrows = arr.rows();
+    const size_t ncols = arr.cols();
+    std::vector<short> ret(nrows, 0);
+    if (!ncols) {
+        return ret;
+    }
+
+    // Rows are strided in the column-major array.  Work on a band of
+    // rows at a time, sweeping down each column so memory is read in
+    // order.  The band's histograms are distinct so neighboring
+    // increments never depend on each other.
+    const size_t nband = 32;
+    short lo[nband], hi[nband];
+    size_t offset[nband+1];
+    std::vector<unsigned int> hist;
+
+    for (size_t row0=0; row0<nrows; row0 += nband) {
+        const size_t nin = std::min(nband, nrows-row0);
+        const short* src = arr.data() + row0;
+
+        std::copy(src, src+nin, lo);
+        std::copy(src, src+nin, hi);
+        for (size_t icol=1; icol<ncols; ++icol) {
+            const short* col = src + icol*nrows;
+            for (size_t ind=0; ind<nin; ++ind) {
+                lo[ind] = std::min(lo[ind], col[ind]);
+                hi[ind] = std::max(hi[ind], col[ind]);
+            }
+        }
+
+        offset[0] = 0;
+        for (size_t ind=0; ind<nin; ++ind) {
+            offset[ind+1] = offset[ind] + int(hi[ind]) - int(lo[ind]) + 1;
+        }
+        hist.assign(offset[nin], 0);
+        unsigned int* h = hist.data();
+
+        for (size_t icol=0; icol<ncols; ++icol) {
+            const short* col = src + icol*nrows;
+            for (size_t ind=0; ind<nin; ++ind) {
+                ++h[offset[ind] + col[ind] - lo[ind]];
+            }
+        }
+
+        for (size_t ind=0; ind<nin; ++ind) {
+            auto beg = hist.begin() + offset[ind];
+            auto it = std::max_element(beg, hist.begin() + offset[ind+1]);
+            ret[row0+ind] = lo[ind] + (it - beg);
+        }
+    }
+    return ret;
+}
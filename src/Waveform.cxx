@@ -1,11 +1,10 @@
 #include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/DFT.h"
+#include "WireCellUtil/FFTBestLength.h"
+#include "WireCellUtil/ShortHistogram.h"
 
 #include <algorithm>
 
-// for FFT
-#include <Eigen/Core>
-#include <unsupported/Eigen/FFT>
-
 #include <complex>
 
 using namespace WireCell;
@@ -45,6 +44,7 @@ WireCell::Waveform::mean_rms(const realseq_t& wf)
 
 
 template<class Func>
+static
 Waveform::realseq_t c2r(const Waveform::compseq_t& seq, Func func)
 {
     Waveform::realseq_t ret(seq.size());
@@ -73,6 +73,34 @@ Waveform::realseq_t WireCell::Waveform::phase(const Waveform::compseq_t& seq)
 }
 
 
+template<class Func>
+static
+void c2r(Waveform::ccompspan_t seq, Waveform::realspan_t out, Func func)
+{
+    std::transform(seq.begin(), seq.end(), out.begin(), func);
+}
+
+void WireCell::Waveform::real(Waveform::ccompspan_t seq, Waveform::realspan_t out)
+{
+    c2r(seq, out, [](Waveform::complex_t c) { return std::real(c); });
+}
+
+void WireCell::Waveform::imag(Waveform::ccompspan_t seq, Waveform::realspan_t out)
+{
+    c2r(seq, out, [](Waveform::complex_t c) { return std::imag(c); });
+}
+
+void WireCell::Waveform::magnitude(Waveform::ccompspan_t seq, Waveform::realspan_t out)
+{
+    c2r(seq, out, [](Waveform::complex_t c) { return std::abs(c); });
+}
+
+void WireCell::Waveform::phase(Waveform::ccompspan_t seq, Waveform::realspan_t out)
+{
+    c2r(seq, out, [](Waveform::complex_t c) { return std::arg(c); });
+}
+
+
 Waveform::real_t WireCell::Waveform::median(Waveform::realseq_t& wave)
 {
     return percentile(wave,0.5);
@@ -140,46 +168,89 @@ std::pair<int, int> WireCell::Waveform::edge(const realseq_t& wave)
 
 Waveform::compseq_t WireCell::Waveform::dft(realseq_t wave)
 {
-    auto v = Eigen::Map<Eigen::VectorXf>(wave.data(), wave.size());
-    Eigen::FFT<Waveform::real_t> trans;
-    Eigen::VectorXcf ret = trans.fwd(v);
-    return compseq_t(ret.data(), ret.data()+ret.size());
+    compseq_t ret(wave.size());
+    DFT::fwd_r2c(wave.data(), ret.data(), wave.size());
+    return ret;
 }
 
 Waveform::realseq_t WireCell::Waveform::idft(compseq_t spec)
 {
-    Eigen::FFT<Waveform::real_t> trans;
-    auto v = Eigen::Map<Eigen::VectorXcf>(spec.data(), spec.size());
-    Eigen::VectorXf ret;
-    trans.inv(ret, v);
-    return realseq_t(ret.data(), ret.data()+ret.size());
+    realseq_t ret(spec.size());
+    DFT::inv_c2r(spec.data(), ret.data(), spec.size());
+    return ret;
 }
 
-// Linear convolution, returns in1.size()+in2.size()-1.
-Waveform::realseq_t WireCell::Waveform::linear_convolve(Waveform::realseq_t in1,
-                                                        Waveform::realseq_t in2,
-                                                        bool truncate)
+void WireCell::Waveform::dft(Waveform::crealspan_t seq, Waveform::compspan_t out)
 {
-    size_t n1_orig = in1.size(), n2_orig = in2.size();
-    size_t n_out = n1_orig + n2_orig - 1;
+    DFT::fwd_r2c(seq.data(), out.data(), seq.size());
+}
 
-    in1.resize(n_out, 0);
-    in2.resize(n_out, 0);
+void WireCell::Waveform::idft(Waveform::ccompspan_t spec, Waveform::realspan_t out)
+{
+    DFT::inv_c2r(spec.data(), out.data(), spec.size());
+}
 
-    auto v1 = Eigen::Map<Eigen::VectorXf>(in1.data(), in1.size());
-    auto v2 = Eigen::Map<Eigen::VectorXf>(in2.data(), in2.size());
+void WireCell::Waveform::dft(Waveform::compspan_t seq)
+{
+    DFT::fwd_c2c(seq.data(), seq.data(), seq.size());
+}
 
-    Eigen::FFT<Waveform::real_t> trans;
+void WireCell::Waveform::idft(Waveform::compspan_t spec)
+{
+    DFT::inv_c2c(spec.data(), spec.data(), spec.size());
+}
 
-    Eigen::VectorXcf s1 = trans.fwd(v1);
-    Eigen::VectorXcf s2 = trans.fwd(v2);
-    Eigen::VectorXcf s12 = (s1.array() * s2.array()).matrix();
-    Eigen::VectorXf vret;
-    trans.inv(vret, s12);
-    realseq_t ret(vret.data(), vret.data()+vret.size());
-    if (truncate) {
-        ret.resize(n1_orig);
+void WireCell::Waveform::linear_convolve(Waveform::crealspan_t in1,
+                                         Waveform::crealspan_t in2,
+                                         Waveform::realspan_t out)
+{
+    if (in1.size() == 0 or in2.size() == 0) {
+        std::fill(out.begin(), out.end(), 0);
+        return;
     }
+    const size_t n_out = in1.size() + in2.size() - 1;
+
+    // Any longer length is also free of wrap-around so pick one
+    // which is fast to transform.
+    const int n_fft = fft_best_length(n_out);
+    const int n_half = n_fft/2 + 1;
+    const DFT::Layout lay{1, n_fft};
+
+    // Per-thread scratch which only ever grows so that repeated calls
+    // do not allocate.
+    static thread_local realseq_t rwork;
+    static thread_local compseq_t cwork;
+    if (rwork.size() < size_t(n_fft)) { rwork.resize(n_fft); }
+    if (cwork.size() < size_t(2*n_half)) { cwork.resize(2*n_half); }
+    complex_t* s1 = cwork.data();
+    complex_t* s2 = cwork.data() + n_half;
+
+    std::copy(in1.begin(), in1.end(), rwork.begin());
+    std::fill(rwork.begin()+in1.size(), rwork.begin()+n_fft, 0);
+    DFT::fwd_r2c_many(rwork.data(), s1, n_fft, 1, lay, lay);
+
+    std::copy(in2.begin(), in2.end(), rwork.begin());
+    std::fill(rwork.begin()+in2.size(), rwork.begin()+n_fft, 0);
+    DFT::fwd_r2c_many(rwork.data(), s2, n_fft, 1, lay, lay);
+
+    for (int ind=0; ind<n_half; ++ind) {
+        s1[ind] *= s2[ind];
+    }
+    DFT::inv_c2r_many(s1, rwork.data(), n_fft, 1, lay, lay);
+
+    const size_t ncopy = std::min(out.size(), n_out);
+    std::copy(rwork.begin(), rwork.begin()+ncopy, out.begin());
+    std::fill(out.begin()+ncopy, out.end(), 0);
+}
+
+// Linear convolution, returns in1.size()+in2.size()-1.
+Waveform::realseq_t WireCell::Waveform::linear_convolve(Waveform::realseq_t in1,
+                                                        Waveform::realseq_t in2,
+                                                        bool truncate)
+{
+    const size_t n_out = in1.size() + in2.size() - 1;
+    realseq_t ret(truncate ? in1.size() : n_out);
+    linear_convolve(crealspan_t(in1), crealspan_t(in2), realspan_t(ret));
     return ret;
 }
 
@@ -196,21 +267,16 @@ Waveform::realseq_t WireCell::Waveform::replace_convolve(Waveform::realseq_t wav
     newres.resize(n_out, 0);
     oldres.resize(n_out, 0);
 
-    auto v1 = Eigen::Map<Eigen::VectorXf>(wave.data(),     wave.size());
-    auto v2 = Eigen::Map<Eigen::VectorXf>(newres.data(), newres.size());
-    auto v3 = Eigen::Map<Eigen::VectorXf>(oldres.data(), oldres.size());
-
-    Eigen::FFT<Waveform::real_t> trans;
-
-    Eigen::VectorXcf s1 = trans.fwd(v1);
-    Eigen::VectorXcf s2 = trans.fwd(v2);
-    Eigen::VectorXcf s3 = trans.fwd(v3);
-
-    Eigen::VectorXcf s123 = (s1.array() * s2.array() / s3.array()).matrix();
+    compseq_t s1(n_out), s2(n_out), s3(n_out);
+    DFT::fwd_r2c(wave.data(), s1.data(), n_out);
+    DFT::fwd_r2c(newres.data(), s2.data(), n_out);
+    DFT::fwd_r2c(oldres.data(), s3.data(), n_out);
+    for (size_t ind=0; ind<n_out; ++ind) {
+        s1[ind] = s1[ind] * s2[ind] / s3[ind];
+    }
 
-    Eigen::VectorXf vret;
-    trans.inv(vret, s123);
-    realseq_t ret(vret.data(), vret.data()+vret.size());
+    realseq_t ret(n_out);
+    DFT::inv_c2r(s1.data(), ret.data(), n_out);
     if (truncate) {
         ret.resize(sizes[0]);
     }
@@ -288,13 +354,8 @@ void WireCell::Waveform::merge(ChannelMaskMap &one,  ChannelMaskMap &two, std::m
 
 short WireCell::Waveform::most_frequent(const std::vector<short>& vals)
 {
-    const size_t nbins = 1<<16;
-    std::vector<unsigned int> hist(nbins, 0);
-    for (unsigned short val : vals) {
-	hist[val] += 1;
-    }
-    auto it = std::max_element(hist.begin(), hist.end());
-    return it - hist.begin();	// casts back to signed short
+    static thread_local ShortHistogram hist;
+    return hist.most_frequent(vals.data(), vals.size());
 }
 
 
@@ -1,137 +1,204 @@
 #include "WireCellUtil/WireSchema.h"
 #include "WireCellUtil/Persist.h"
 #include "WireCellUtil/Configuration.h"
+#include "WireCellUtil/SingleFlight.h"
+
+#include <algorithm>
 
 
 using namespace WireCell;
 using namespace WireCell::WireSchema;
 
 
-static std::map<std::string, StoreDBPtr> gStoreCache;
-
+namespace {
 
+    // Stores by resolved path, or path and anode idents.  Stores of
+    // anode sets are made from the store of the whole file.
+    SingleFlight<StoreDBPtr> gStoreCache;
 
-Store WireCell::WireSchema::load(const char* filename)
-{
-    // turn into absolute real path
-    std::string realpath = WireCell::Persist::resolve(filename);
-    auto maybe = gStoreCache.find(realpath);
-    if (maybe != gStoreCache.end()) {
-        return Store(maybe->second);
+    void fill_list(std::vector<int>& out, const Json::Value& jarr)
+    {
+        const int num = jarr.size();
+        out.resize(num);
+        for (int ind=0; ind<num; ++ind) {
+            out[ind] = convert<int>(jarr[ind]);
+        }
     }
-    
-
-    Json::Value jtop = WireCell::Persist::load(filename);
-    Json::Value jstore = jtop["Store"];
 
-    StoreDB* store = new StoreDB;
+    Point make_point(const Json::Value& jpoints, int ind)
+    {
+        const Json::Value& jp = jpoints[ind]["Point"];
+        return Point(get<double>(jp,"x"), get<double>(jp,"y"), get<double>(jp,"z"));
+    }
 
-    
-    
-    std::vector<Point> points;
+    Wire make_wire(const Json::Value& jwire, const std::vector<Point>& points)
     {
-        Json::Value jpoints = jstore["points"];
-        const int npoints = jpoints.size();
-        points.resize(npoints);
-        for (int ipoint=0; ipoint<npoints; ++ipoint) {
-            Json::Value jp = jpoints[ipoint]["Point"];
-            points[ipoint].set(get<double>(jp,"x"), get<double>(jp,"y"), get<double>(jp,"z"));
-        }        
+        Wire wire;
+        wire.ident = get<int>(jwire, "ident");
+        wire.channel = get<int>(jwire, "channel");
+        wire.segment = get<int>(jwire, "segment");
+        wire.tail = points[get<int>(jwire,"tail")];
+        wire.head = points[get<int>(jwire,"head")];
+        return wire;
     }
 
-    {// wires
-        Json::Value jwires = jstore["wires"];
-        const int nwires = jwires.size();
-        std::vector<Wire>& wires = store->wires;
-        wires.resize(nwires);
-        for (int iwire=0; iwire<nwires; ++iwire) {
-            Json::Value jwire = jwires[iwire]["Wire"];
-            Wire& wire = wires[iwire];
-            wire.ident = get<int>(jwire, "ident");
-            wire.channel = get<int>(jwire, "channel");
-            wire.segment = get<int>(jwire, "segment");
-
-            int itail = get<int>(jwire,"tail");
-            int ihead = get<int>(jwire,"head");
-            wire.tail = points[itail];
-            wire.head = points[ihead];
+    // The whole store, each collection in file order.
+    StoreDBPtr make_full(const Json::Value& jstore)
+    {
+        auto store = std::make_shared<StoreDB>();
+
+        const Json::Value& jpoints = jstore["points"];
+        std::vector<Point> points(jpoints.size());
+        for (size_t ipoint=0; ipoint<points.size(); ++ipoint) {
+            points[ipoint] = make_point(jpoints, ipoint);
         }
-    }
 
-    
-    {// planes
-        Json::Value jplanes = jstore["planes"];
-        const int nplanes = jplanes.size();
-        std::vector<Plane>& planes = store->planes;
-        planes.resize(nplanes);
-        for (int iplane=0; iplane<nplanes; ++iplane) {
-            Json::Value jplane = jplanes[iplane]["Plane"];
-            Plane& plane = planes[iplane];
-            plane.ident = get<int>(jplane, "ident");        
-            Json::Value jwires = jplane["wires"];
-            const int nwires = jwires.size();
-            plane.wires.resize(nwires);
-            for (int iwire=0; iwire<nwires; ++iwire) {
-                plane.wires[iwire] = convert<int>(jwires[iwire]);
-            }
+        const Json::Value& jwires = jstore["wires"];
+        store->wires.resize(jwires.size());
+        for (size_t iwire=0; iwire<store->wires.size(); ++iwire) {
+            store->wires[iwire] = make_wire(jwires[(int)iwire]["Wire"], points);
         }
+
+        const Json::Value& jplanes = jstore["planes"];
+        store->planes.resize(jplanes.size());
+        for (size_t ind=0; ind<store->planes.size(); ++ind) {
+            const Json::Value& jplane = jplanes[(int)ind]["Plane"];
+            store->planes[ind].ident = get<int>(jplane, "ident");
+            fill_list(store->planes[ind].wires, jplane["wires"]);
+        }
+
+        const Json::Value& jfaces = jstore["faces"];
+        store->faces.resize(jfaces.size());
+        for (size_t ind=0; ind<store->faces.size(); ++ind) {
+            const Json::Value& jface = jfaces[(int)ind]["Face"];
+            store->faces[ind].ident = get<int>(jface, "ident");
+            fill_list(store->faces[ind].planes, jface["planes"]);
+        }
+
+        const Json::Value& janodes = jstore["anodes"];
+        store->anodes.resize(janodes.size());
+        for (size_t ind=0; ind<store->anodes.size(); ++ind) {
+            const Json::Value& janode = janodes[(int)ind]["Anode"];
+            store->anodes[ind].ident = get<int>(janode, "ident");
+            fill_list(store->anodes[ind].faces, janode["faces"]);
+        }
+
+        const Json::Value& jdets = jstore["detectors"];
+        store->detectors.resize(jdets.size());
+        for (size_t ind=0; ind<store->detectors.size(); ++ind) {
+            const Json::Value& jdet = jdets[(int)ind]["Detector"];
+            store->detectors[ind].ident = get<int>(jdet, "ident");
+            fill_list(store->detectors[ind].anodes, jdet["anodes"]);
+        }
+
+        store->make_indices();
+        return store;
     }
-    
-    {// faces
-        Json::Value jfaces = jstore["faces"];
-        const int nfaces = jfaces.size();
-        std::vector<Face>& faces = store->faces;
-        faces.resize(nfaces);
-        for (int iface=0; iface<nfaces; ++iface) {
-            Json::Value jface = jfaces[iface]["Face"];
-            Face& face = faces[iface];
-            face.ident = get<int>(jface, "ident");
-            Json::Value jplanes = jface["planes"];
-            const int nplanes = jplanes.size();
-            face.planes.resize(nplanes);
-            for (int iplane=0; iplane<nplanes; ++iplane) {
-                face.planes[iplane] = convert<int>(jplanes[iplane]);
+
+    // A store holding only the given anodes, in their order in the
+    // full store, with their faces, planes and wires and the detectors
+    // holding them.
+    StoreDBPtr make_partial(const StoreDB& full, const std::vector<int>& idents)
+    {
+        auto store = std::make_shared<StoreDB>();
+
+        const int nanodes = full.anodes.size();
+        std::vector<int> anode_map(nanodes, -1);
+        for (int ident : idents) {
+            auto it = full.indices.anode.find(ident);
+            if (it == full.indices.anode.end()) {
+                THROW(KeyError() << errmsg{String::format("Unknown anode: %d", ident)});
             }
+            anode_map[it->second] = 0;
         }
-    }
 
-    {// anodes
-        Json::Value janodes = jstore["anodes"];
-        const int nanodes = janodes.size();
-        std::vector<Anode>& anodes = store->anodes;
-        anodes.resize(nanodes);
         for (int ianode=0; ianode<nanodes; ++ianode) {
-            Json::Value janode = janodes[ianode]["Anode"];
-            Anode& anode = anodes[ianode];
-            anode.ident = get<int>(janode, "ident");        
-            Json::Value jfaces = janode["faces"];
-            const int nfaces = jfaces.size();
-            anode.faces.resize(nfaces);
-            for (int iface=0; iface<nfaces; ++iface) {
-                anode.faces[iface] = convert<int>(jfaces[iface]);
+            if (anode_map[ianode] < 0) {
+                continue;
+            }
+            anode_map[ianode] = store->anodes.size();
+            const Anode& fanode = full.anodes[ianode];
+            Anode anode{fanode.ident, {}};
+            for (int iface : fanode.faces) {
+                const Face& fface = full.faces[iface];
+                Face face{fface.ident, {}};
+                for (int iplane : fface.planes) {
+                    const Plane& fplane = full.planes[iplane];
+                    Plane plane{fplane.ident, {}};
+                    plane.wires.reserve(fplane.wires.size());
+                    for (int iwire : fplane.wires) {
+                        plane.wires.push_back(store->wires.size());
+                        store->wires.push_back(full.wires[iwire]);
+                    }
+                    face.planes.push_back(store->planes.size());
+                    store->planes.push_back(std::move(plane));
+                }
+                anode.faces.push_back(store->faces.size());
+                store->faces.push_back(std::move(face));
             }
+            store->anodes.push_back(std::move(anode));
         }
-    }
 
-    {// detectors
-        Json::Value jdets = jstore["detectors"];
-        const int ndets = jdets.size();
-        std::vector<Detector>& dets = store->detectors;
-        dets.resize(ndets);
-        for (int idet=0; idet<ndets; ++idet) {
-            Json::Value jdet = jdets[idet]["Detector"];
-            Detector& det = dets[idet];
-            det.ident = get<int>(jdet, "ident");        
-            Json::Value janodes = jdet["anodes"];
-            const int nanodes = janodes.size();
-            det.anodes.resize(nanodes);
-            for (int ianode=0; ianode<nanodes; ++ianode) {
-                det.anodes[ianode] = convert<int>(janodes[ianode]);
+        for (const auto& fdet : full.detectors) {
+            Detector det{fdet.ident, {}};
+            for (int ianode : fdet.anodes) {
+                if (ianode >= 0 and ianode < nanodes and anode_map[ianode] >= 0) {
+                    det.anodes.push_back(anode_map[ianode]);
+                }
+            }
+            if (!det.anodes.empty()) {
+                store->detectors.push_back(std::move(det));
             }
         }
+
+        store->make_indices();
+        return store;
+    }
+
+    // Turn into absolute real path, keeping the name if that fails
+    // so that Persist::load() gives its usual error.
+    std::string resolve(const char* filename)
+    {
+        std::string realpath = WireCell::Persist::resolve(filename);
+        if (realpath.empty()) {
+            realpath = filename;
+        }
+        return realpath;
+    }
+
+    StoreDBPtr load_full(const std::string& realpath)
+    {
+        return gStoreCache.get(realpath, [&]() {
+                return make_full(WireCell::Persist::load(realpath)["Store"]);
+            });
     }
-    gStoreCache[realpath] = StoreDBPtr(store);
-    return Store(gStoreCache[realpath]);
+}
+
+
+Store WireCell::WireSchema::load(const char* filename)
+{
+    return Store(load_full(resolve(filename)));
+}
+
+Store WireCell::WireSchema::load(const char* filename, std::vector<int> anodes)
+{
+    const std::string realpath = resolve(filename);
+    std::sort(anodes.begin(), anodes.end());
+    anodes.erase(std::unique(anodes.begin(), anodes.end()), anodes.end());
+    std::string key = realpath + "#anodes";
+    for (int ident : anodes) {
+        key += ":" + std::to_string(ident);
+    }
+    return Store(gStoreCache.get(key, [&]() {
+                // The file is parsed once, by the first load of any
+                // anodes, and each set is then copied out of it.
+                return make_partial(*load_full(realpath), anodes);
+            }));
+}
+
+void WireCell::WireSchema::clear_cache()
+{
+    gStoreCache.clear();
 }
 
 
@@ -141,9 +208,118 @@ Store WireCell::WireSchema::load(const char* filename)
 // }
 
 
+void StoreDB::make_indices()
+{
+    Indices idx;
+
+    for (size_t ind=0; ind<detectors.size(); ++ind) {
+        idx.detector[detectors[ind].ident] = ind;
+    }
+    for (size_t ind=0; ind<anodes.size(); ++ind) {
+        idx.anode[anodes[ind].ident] = ind;
+    }
+
+    // channel to wires, as a CSR list ordered by segment
+    {
+        std::vector<int> order(wires.size());
+        for (size_t ind=0; ind<order.size(); ++ind) {
+            order[ind] = ind;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                const Wire& wa = wires[a];
+                const Wire& wb = wires[b];
+                if (wa.channel != wb.channel) { return wa.channel < wb.channel; }
+                return wa.segment < wb.segment;
+            });
+        idx.channel.reserve(order.size());
+        size_t beg = 0;
+        while (beg < order.size()) {
+            const int chan = wires[order[beg]].channel;
+            size_t end = beg+1;
+            while (end < order.size() and wires[order[end]].channel == chan) {
+                ++end;
+            }
+            idx.channel[chan] = std::make_pair(int(beg), int(end));
+            beg = end;
+        }
+        idx.channel_wires = std::move(order);
+    }
+
+    const size_t nplanes = planes.size();
+    idx.plane_first.resize(nplanes, -1);
+    idx.plane_channels.resize(nplanes);
+    idx.plane_bb.resize(nplanes);
+    idx.plane_pitch.resize(nplanes);
+    for (size_t ipl=0; ipl<nplanes; ++ipl) {
+        const auto& plwires = planes[ipl].wires;
+        bool contiguous = true;
+        for (size_t ind=1; ind<plwires.size(); ++ind) {
+            if (plwires[ind] != plwires[0] + int(ind)) {
+                contiguous = false;
+                break;
+            }
+        }
+        if (contiguous and !plwires.empty()) {
+            idx.plane_first[ipl] = plwires[0];
+        }
+
+        auto& chans = idx.plane_channels[ipl];
+        chans.reserve(plwires.size());
+        BoundingBox& bb = idx.plane_bb[ipl];
+        Vector wtot;
+        for (int iwire : plwires) {
+            const Wire& wire = wires[iwire];
+            chans.push_back(wire.channel);
+            Ray ray(wire.tail, wire.head);
+            bb(ray);
+            wtot += ray_vector(ray);
+        }
+        if (plwires.empty()) {
+            continue;
+        }
+        wtot = wtot.norm();
+
+        const Wire& w1 = wires[plwires.front()];
+        const Wire& w2 = wires[plwires.back()];
+
+        const Vector c1 = 0.5*(w1.tail + w1.head);
+        const Vector c2 = 0.5*(w2.tail + w2.head);
+
+        // approximate pitch, in the plane
+        Vector pit = ray_vector(Ray(c1,c2)); 
+        Vector ecks = wtot.cross(pit); // X-axis
+        pit = ecks.cross(wtot);
+        idx.plane_pitch[ipl] = Ray(wtot, pit.norm());
+    }
+
+    idx.face_bb.resize(faces.size());
+    for (size_t ind=0; ind<faces.size(); ++ind) {
+        for (int ipl : faces[ind].planes) {
+            idx.face_bb[ind](idx.plane_bb[ipl].bounds());
+        }
+    }
+    idx.anode_bb.resize(anodes.size());
+    for (size_t ind=0; ind<anodes.size(); ++ind) {
+        for (int iface : anodes[ind].faces) {
+            idx.anode_bb[ind](idx.face_bb[iface].bounds());
+        }
+    }
+
+    idx.done = true;
+    indices = std::move(idx);
+}
+
+
 Store::Store() : m_db(nullptr) {}
 
-Store::Store(StoreDBPtr db) : m_db(db) { }
+Store::Store(StoreDBPtr db) : m_db(db)
+{
+    if (m_db and !m_db->indices.done) {
+        auto indexed = std::make_shared<StoreDB>(*m_db);
+        indexed->make_indices();
+        m_db = indexed;
+    }
+}
 
 Store::Store(const Store& other)
     : m_db(other.db())
@@ -165,105 +341,107 @@ const std::vector<Plane>& Store::planes() const { return m_db->planes; }
 const std::vector<Wire>& Store::wires() const { return m_db->wires; }
 
 const Anode& Store::anode(int ident) const {
-    for (auto& a : m_db->anodes) {
-        if (a.ident == ident) {
-            return a;
-        }
+    const auto& lu = m_db->indices.anode;
+    auto it = lu.find(ident);
+    if (it == lu.end()) {
+        THROW(KeyError() << errmsg{String::format("Unknown anode: %d", ident)});
     }
-    THROW(KeyError() << errmsg{String::format("Unknown anode: %d", ident)});
+    return m_db->anodes[it->second];
 }
 
-std::vector<Anode> Store::anodes(const Detector& detector) const {
-    std::vector<Anode> ret;
-    for (auto ind : detector.anodes) {
-        ret.push_back(m_db->anodes[ind]);
+const Detector& Store::detector(int ident) const {
+    const auto& lu = m_db->indices.detector;
+    auto it = lu.find(ident);
+    if (it == lu.end()) {
+        THROW(KeyError() << errmsg{String::format("Unknown detector: %d", ident)});
     }
-    return ret;
+    return m_db->detectors[it->second];
 }
 
+namespace {
+    bool same(const Detector& a, const Detector& b) { return a.ident == b.ident and a.anodes == b.anodes; }
+    bool same(const Anode& a, const Anode& b) { return a.ident == b.ident and a.faces == b.faces; }
+    bool same(const Face& a, const Face& b) { return a.ident == b.ident and a.planes == b.planes; }
+    bool same(const Plane& a, const Plane& b) { return a.ident == b.ident and a.wires == b.wires; }
+}
 
-std::vector<Face> Store::faces(const Anode& anode) const {
-    std::vector<Face> ret;
-    for (auto ind : anode.faces) {
-        ret.push_back(m_db->faces[ind]);
+// Return the position of obj in all.  References into the store are
+// found directly, copies (as older versions of this class returned)
+// by comparing contents.
+template<typename T>
+size_t Store::position(const std::vector<T>& all, const T& obj) const
+{
+    const T* ptr = &obj;
+    if (!all.empty() and ptr >= all.data() and ptr < all.data() + all.size()) {
+        return ptr - all.data();
+    }
+    for (size_t ind=0; ind<all.size(); ++ind) {
+        if (same(all[ind], obj)) {
+            return ind;
+        }
     }
-    return ret;
+    THROW(KeyError() << errmsg{String::format("Object with ident %d is not in store", obj.ident)});
 }
 
+// Views index through the store's own objects, never the argument,
+// which may be a copy.
+View<Anode> Store::anodes(const Detector& detector) const {
+    const auto& det = m_db->detectors[position(m_db->detectors, detector)];
+    return View<Anode>(m_db->anodes.data(), det.anodes.data(), det.anodes.size());
+}
+
+View<Face> Store::faces(const Anode& anode) const {
+    const auto& an = m_db->anodes[position(m_db->anodes, anode)];
+    return View<Face>(m_db->faces.data(), an.faces.data(), an.faces.size());
+}
 
-std::vector<Plane> Store::planes(const Face& face) const
+View<Plane> Store::planes(const Face& face) const
 {
-    std::vector<Plane> ret;
-    for (auto ind : face.planes) {
-        ret.push_back(m_db->planes[ind]);
-    }
-    return ret;
+    const auto& fa = m_db->faces[position(m_db->faces, face)];
+    return View<Plane>(m_db->planes.data(), fa.planes.data(), fa.planes.size());
 }
 
-std::vector<Wire> Store::wires(const Plane& plane) const
+View<Wire> Store::wires(const Plane& plane) const
 {
-    std::vector<Wire> ret;
-    for (auto ind : plane.wires) {
-        ret.push_back(m_db->wires[ind]);
+    const size_t ipl = position(m_db->planes, plane);
+    const auto& wires = m_db->planes[ipl].wires;
+    const int first = m_db->indices.plane_first[ipl];
+    if (first >= 0) {
+        return View<Wire>(m_db->wires.data() + first, wires.size());
     }
-    return ret;
+    return View<Wire>(m_db->wires.data(), wires.data(), wires.size());
 }
 
-BoundingBox Store::bounding_box(const Anode& anode) const
+View<Wire> Store::channel_wires(int channel) const
 {
-    BoundingBox bb;
-    for (const auto& face : faces(anode)) {
-        bb(bounding_box(face).bounds());
+    const auto& idx = m_db->indices;
+    auto it = idx.channel.find(channel);
+    if (it == idx.channel.end()) {
+        return View<Wire>();
     }
-    return bb;
+    return View<Wire>(m_db->wires.data(), idx.channel_wires.data() + it->second.first,
+                      it->second.second - it->second.first);
 }
-BoundingBox Store::bounding_box(const Face& face) const
+
+const BoundingBox& Store::bounding_box(const Anode& anode) const
 {
-    BoundingBox bb;
-    for (const auto& plane : planes(face)) {
-        bb(bounding_box(plane).bounds());
-    }
-    return bb;
+    return m_db->indices.anode_bb[position(m_db->anodes, anode)];
 }
-BoundingBox Store::bounding_box(const Plane& plane) const
+const BoundingBox& Store::bounding_box(const Face& face) const
 {
-    BoundingBox bb;
-    for (const auto& wire : wires(plane)) {
-        Ray ray(wire.tail, wire.head);
-        bb(ray);
-    }
-    return bb;
-    
+    return m_db->indices.face_bb[position(m_db->faces, face)];
 }
-
-Ray Store::wire_pitch(const Plane& plane) const 
+const BoundingBox& Store::bounding_box(const Plane& plane) const
 {
-    Vector wtot;
-    for (const auto& wire : wires(plane)) {
-        Ray ray(wire.tail, wire.head);
-        wtot += ray_vector(ray);
-    }
-    wtot = wtot.norm();
-
-    const Wire& w1 = m_db->wires[plane.wires.front()];
-    const Wire& w2 = m_db->wires[plane.wires.back()];
-
-    const Vector c1 = 0.5*(w1.tail + w1.head);
-    const Vector c2 = 0.5*(w2.tail + w2.head);
-
-    // approximate pitch, in the plane
-    Vector pit = ray_vector(Ray(c1,c2)); 
-    Vector ecks = wtot.cross(pit); // X-axis
-    pit = ecks.cross(wtot);
-    return Ray(wtot, pit.norm());
+    return m_db->indices.plane_bb[position(m_db->planes, plane)];
 }
 
+const Ray& Store::wire_pitch(const Plane& plane) const 
+{
+    return m_db->indices.plane_pitch[position(m_db->planes, plane)];
+}
 
-std::vector<int> Store::channels(const Plane& plane) const
+const std::vector<int>& Store::channels(const Plane& plane) const
 {
-    std::vector<int> ret;
-    for (const auto& wire : wires(plane)) {
-        ret.push_back(wire.channel);
-    }
-    return ret;    
+    return m_db->indices.plane_channels[position(m_db->planes, plane)];
 }
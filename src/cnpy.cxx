@@ -12,6 +12,9 @@
 #include<stdint.h>
 #include<stdexcept>
 #include <regex>
+#include <limits>
+
+#include <boost/iostreams/device/mapped_file.hpp>
 
 char cnpy::BigEndianTest() {
     int x = 1;
@@ -60,22 +63,23 @@ template<> std::vector<char>& cnpy::operator+=(std::vector<char>& lhs, const cha
     return lhs;
 }
 
-void cnpy::parse_npy_header(unsigned char* buffer,size_t& word_size, std::vector<size_t>& shape, bool& fortran_order) {
-    //std::string magic_string(buffer,6);
-    //uint8_t major_version = *reinterpret_cast<uint8_t*>(buffer+6);
-    //uint8_t minor_version = *reinterpret_cast<uint8_t*>(buffer+7);
-    uint16_t header_len = *reinterpret_cast<uint16_t*>(buffer+8);
-    std::string header(reinterpret_cast<char*>(buffer+9),header_len);
-
+// Parse the header dictionary text.
+static void parse_header_dict(const std::string& header, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order)
+{
     size_t loc1, loc2;
 
     //fortran order
-    loc1 = header.find("fortran_order")+16;
+    loc1 = header.find("fortran_order");
+    if (loc1 == std::string::npos)
+        throw std::runtime_error("parse_npy_header: failed to find header keyword: 'fortran_order'");
+    loc1 += 16;
     fortran_order = (header.substr(loc1,4) == "True" ? true : false);
 
     //shape
     loc1 = header.find("(");
     loc2 = header.find(")");
+    if (loc1 == std::string::npos || loc2 == std::string::npos)
+        throw std::runtime_error("parse_npy_header: failed to find header keyword: '(' or ')'");
 
     std::regex num_regex("[0-9][0-9]*");
     std::smatch sm;
@@ -83,14 +87,17 @@ void cnpy::parse_npy_header(unsigned char* buffer,size_t& word_size, std::vector
 
     std::string str_shape = header.substr(loc1+1,loc2-loc1-1);
     while(std::regex_search(str_shape, sm, num_regex)) {
-        shape.push_back(std::stoi(sm[0].str()));
+        shape.push_back(std::stoull(sm[0].str()));
         str_shape = sm.suffix().str();
     }
 
     //endian, word size, data type
     //byte order code | stands for not applicable. 
     //not sure when this applies except for byte array
-    loc1 = header.find("descr")+9;
+    loc1 = header.find("descr");
+    if (loc1 == std::string::npos)
+        throw std::runtime_error("parse_npy_header: failed to find header keyword: 'descr'");
+    loc1 += 9;
     bool littleEndian = (header[loc1] == '<' || header[loc1] == '|' ? true : false);
     if (!littleEndian) {
         throw std::runtime_error("parse_npy_header: header is not little endian");
@@ -104,6 +111,42 @@ void cnpy::parse_npy_header(unsigned char* buffer,size_t& word_size, std::vector
     word_size = atoi(str_ws.substr(0,loc2).c_str());
 }
 
+size_t cnpy::parse_npy_header(const char* buffer, size_t size, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order)
+{
+    // Version 1 has a 2 byte header length, versions 2 and 3 have 4.
+    if (size < 10 || buffer[0] != (char)0x93 || std::memcmp(buffer+1, "NUMPY", 5) != 0) {
+        throw std::runtime_error("parse_npy_header: not a npy header");
+    }
+    const uint8_t major_version = buffer[6];
+    size_t header_len=0, prelude=0;
+    if (major_version == 1) {
+        uint16_t len;
+        std::memcpy(&len, buffer+8, 2);
+        header_len = len;
+        prelude = 10;
+    }
+    else {
+        if (size < 12) {
+            throw std::runtime_error("parse_npy_header: truncated header");
+        }
+        uint32_t len;
+        std::memcpy(&len, buffer+8, 4);
+        header_len = len;
+        prelude = 12;
+    }
+    if (prelude + header_len > size) {
+        throw std::runtime_error("parse_npy_header: truncated header");
+    }
+    parse_header_dict(std::string(buffer+prelude, header_len), word_size, shape, fortran_order);
+    return prelude + header_len;
+}
+
+void cnpy::parse_npy_header(unsigned char* buffer,size_t& word_size, std::vector<size_t>& shape, bool& fortran_order) {
+    // Caller promises the whole header is there.
+    parse_npy_header(reinterpret_cast<const char*>(buffer), std::numeric_limits<size_t>::max(),
+                     word_size, shape, fortran_order);
+}
+
 void cnpy::parse_npy_header(FILE* fp, size_t& word_size, std::vector<size_t>& shape, bool& fortran_order) {  
     char buffer[256];
     size_t res = fread(buffer,sizeof(char),11,fp);       
@@ -113,50 +156,7 @@ void cnpy::parse_npy_header(FILE* fp, size_t& word_size, std::vector<size_t>& sh
     if (header[header.size()-1] != '\n') {
         throw std::runtime_error("parse_npy_header: header is not newline terminated");
     }
-
-    size_t loc1, loc2;
-
-    //fortran order
-    loc1 = header.find("fortran_order");
-    if (loc1 == std::string::npos)
-        throw std::runtime_error("parse_npy_header: failed to find header keyword: 'fortran_order'");
-    loc1 += 16;
-    fortran_order = (header.substr(loc1,4) == "True" ? true : false);
-
-    //shape
-    loc1 = header.find("(");
-    loc2 = header.find(")");
-    if (loc1 == std::string::npos || loc2 == std::string::npos)
-        throw std::runtime_error("parse_npy_header: failed to find header keyword: '(' or ')'");
-
-    std::regex num_regex("[0-9][0-9]*");
-    std::smatch sm;
-    shape.clear();
-
-    std::string str_shape = header.substr(loc1+1,loc2-loc1-1);
-    while(std::regex_search(str_shape, sm, num_regex)) {
-        shape.push_back(std::stoi(sm[0].str()));
-        str_shape = sm.suffix().str();
-    }
-
-    //endian, word size, data type
-    //byte order code | stands for not applicable. 
-    //not sure when this applies except for byte array
-    loc1 = header.find("descr");
-    if (loc1 == std::string::npos)
-        throw std::runtime_error("parse_npy_header: failed to find header keyword: 'descr'");
-    loc1 += 9;
-    bool littleEndian = (header[loc1] == '<' || header[loc1] == '|' ? true : false);
-    if (!littleEndian) {
-        throw std::runtime_error("parse_npy_header: header is not little endian");
-    }
-
-    //char type = header[loc1+1];
-    //assert(type == map_type(T));
-
-    std::string str_ws = header.substr(loc1+2);
-    loc2 = str_ws.find("'");
-    word_size = atoi(str_ws.substr(0,loc2).c_str());
+    parse_header_dict(header, word_size, shape, fortran_order);
 }
 
 void cnpy::parse_zip_footer(FILE* fp, uint16_t& nrecs, size_t& global_header_size, size_t& global_header_offset)
@@ -192,165 +192,296 @@ void cnpy::parse_zip_footer(FILE* fp, uint16_t& nrecs, size_t& global_header_siz
     }
 }
 
-cnpy::NpyArray load_the_npy_file(FILE* fp) {
-    std::vector<size_t> shape;
-    size_t word_size;
-    bool fortran_order;
-    cnpy::parse_npy_header(fp,word_size,shape,fortran_order);
-
-    cnpy::NpyArray arr(shape, word_size, fortran_order);
-    size_t nread = fread(arr.data<char>(),1,arr.num_bytes(),fp);
-    if(nread != arr.num_bytes())
-        throw std::runtime_error("load_the_npy_file: failed fread");
-    return arr;
-}
-
-cnpy::NpyArray load_the_npz_array(FILE* fp, uint32_t compr_bytes, uint32_t uncompr_bytes) {
+namespace {
 
-    std::vector<unsigned char> buffer_compr(compr_bytes);
-    std::vector<unsigned char> buffer_uncompr(uncompr_bytes);
-    size_t nread = fread(&buffer_compr[0],1,compr_bytes,fp);
-    if(nread != compr_bytes)
-        throw std::runtime_error("load_the_npy_file: failed fread");
+    typedef boost::iostreams::mapped_file mapped_file_t;
 
-    z_stream d_stream;
-
-    d_stream.zalloc = Z_NULL;
-    d_stream.zfree = Z_NULL;
-    d_stream.opaque = Z_NULL;
-    d_stream.avail_in = 0;
-    d_stream.next_in = Z_NULL;
-    inflateInit2(&d_stream, -MAX_WBITS);
+    template<typename T>
+    T get_le(const char* ptr) {
+        T val;
+        std::memcpy(&val, ptr, sizeof(T));
+        return val;
+    }
 
-    d_stream.avail_in = compr_bytes;
-    d_stream.next_in = &buffer_compr[0];
-    d_stream.avail_out = uncompr_bytes;
-    d_stream.next_out = &buffer_uncompr[0];
+    // Map the whole file copy-on-write so arrays viewing it may be
+    // modified without touching the file.
+    std::shared_ptr<mapped_file_t> map_file(const std::string& fname, const std::string& who)
+    {
+        auto mf = std::make_shared<mapped_file_t>();
+        try {
+            boost::iostreams::mapped_file_params params(fname);
+            params.flags = mapped_file_t::priv;
+            mf->open(params);
+        }
+        catch (const std::exception& err) {
+            throw std::runtime_error(who + ": Unable to open file " + fname + ": " + err.what());
+        }
+        if (!mf->is_open()) {
+            throw std::runtime_error(who + ": Unable to open file " + fname);
+        }
+        return mf;
+    }
 
-    inflate(&d_stream, Z_FINISH);
-    inflateEnd(&d_stream);
+    // Return an array viewing the npy image of size bytes at ptr.  The
+    // view is copied out if its data is not aligned for its type.
+    cnpy::NpyArray npy_view(char* ptr, size_t size, std::shared_ptr<void> keep)
+    {
+        std::vector<size_t> shape;
+        size_t word_size;
+        bool fortran_order;
+        const size_t hsize = cnpy::parse_npy_header(ptr, size, word_size, shape, fortran_order);
+        cnpy::NpyArray view(shape, word_size, fortran_order, ptr + hsize, keep);
+        if (view.num_bytes() > size - hsize) {
+            throw std::runtime_error("npy_load: truncated array data");
+        }
+        size_t align = 1;
+        while (align < word_size && align < 16 && word_size % (2*align) == 0) {
+            align *= 2;
+        }
+        if (reinterpret_cast<uintptr_t>(view.data_ptr) % align == 0) {
+            return view;
+        }
+        cnpy::NpyArray arr(shape, word_size, fortran_order);
+        std::memcpy(arr.data_ptr, view.data_ptr, arr.num_bytes());
+        return arr;
+    }
 
-    std::vector<size_t> shape;
-    size_t word_size;
-    bool fortran_order;
-    cnpy::parse_npy_header(&buffer_uncompr[0],word_size,shape,fortran_order);
+    // Inflate a raw deflate stream in pieces of a size zlib can count.
+    class Inflater {
+    public:
+        Inflater(const char* data, size_t size) : m_in(data), m_nin(size) {
+            std::memset(&m_zs, 0, sizeof(m_zs));
+            if (inflateInit2(&m_zs, -MAX_WBITS) != Z_OK) {
+                throw std::runtime_error("npz_load: failed to initialize zlib");
+            }
+        }
+        ~Inflater() { inflateEnd(&m_zs); }
+
+        // Fill exactly n bytes of out.
+        void read(char* out, size_t n) {
+            const size_t chunk = 1<<30;
+            while (n) {
+                if (m_zs.avail_in == 0 && m_nin) {
+                    const size_t take = std::min(m_nin, chunk);
+                    m_zs.next_in = (Bytef*)m_in;
+                    m_zs.avail_in = take;
+                    m_in += take;
+                    m_nin -= take;
+                }
+                const size_t want = std::min(n, chunk);
+                m_zs.next_out = (Bytef*)out;
+                m_zs.avail_out = want;
+                const int rc = inflate(&m_zs, Z_NO_FLUSH);
+                const size_t got = want - m_zs.avail_out;
+                out += got;
+                n -= got;
+                if (n == 0) {
+                    break;
+                }
+                if (rc == Z_STREAM_END || got == 0 || (rc != Z_OK && rc != Z_BUF_ERROR)) {
+                    throw std::runtime_error("npz_load: corrupt or truncated compressed array");
+                }
+            }
+        }
 
-    cnpy::NpyArray array(shape, word_size, fortran_order);
+    private:
+        z_stream m_zs;
+        const char* m_in;
+        size_t m_nin;
+    };
+
+    struct zip_member_t {
+        std::string name;       // without .npy
+        uint16_t method;
+        uint64_t csize, usize, offset;
+    };
+
+    // An npz file as found by its zip central directory.
+    class NpzFile {
+    public:
+        explicit NpzFile(const std::string& fname)
+            : m_fname(fname), m_map(map_file(fname, "npz_load")) {
+            read_directory();
+        }
 
-    size_t offset = uncompr_bytes - array.num_bytes();
-    memcpy(array.data<unsigned char>(),&buffer_uncompr[0]+offset,array.num_bytes());
+        const std::vector<zip_member_t>& members() const { return m_members; }
 
-    return array;
-}
+        const zip_member_t* find(const std::string& varname) const {
+            for (const auto& mem : m_members) {
+                if (mem.name == varname) {
+                    return &mem;
+                }
+            }
+            return nullptr;
+        }
 
-cnpy::npz_t cnpy::npz_load(std::string fname) {
-    FILE* fp = fopen(fname.c_str(),"rb");
+        cnpy::NpyArray load(const zip_member_t& mem) const {
+            const char* base = m_map->const_data();
+            const size_t size = m_map->size();
+            if (mem.offset > size || size - mem.offset < 30
+                || get_le<uint32_t>(base + mem.offset) != 0x04034b50) {
+                bad("bad local header");
+            }
+            const char* local = base + mem.offset;
+            const size_t start = mem.offset + 30 + get_le<uint16_t>(local+26) + get_le<uint16_t>(local+28);
+            if (start > size || size - start < mem.csize) {
+                bad("member data beyond end of file");
+            }
+
+            if (mem.method == 0) {
+                return npy_view(m_map->data() + start, mem.csize, m_map);
+            }
+            if (mem.method != 8) {
+                bad("unsupported compression method for " + mem.name);
+            }
+
+            // Inflate the npy header then the data directly into place.
+            Inflater inf(base + start, mem.csize);
+            std::vector<char> head(12);
+            size_t nhead = 10;
+            inf.read(head.data(), nhead);
+            if (head[6] == 1) {
+                head.resize(nhead + get_le<uint16_t>(&head[8]));
+            }
+            else {
+                inf.read(head.data()+nhead, 2);
+                nhead = 12;
+                head.resize(nhead + get_le<uint32_t>(&head[8]));
+            }
+            inf.read(head.data()+nhead, head.size()-nhead);
+            std::vector<size_t> shape;
+            size_t word_size;
+            bool fortran_order;
+            cnpy::parse_npy_header(head.data(), head.size(), word_size, shape, fortran_order);
+            cnpy::NpyArray arr(shape, word_size, fortran_order);
+            if (head.size() + arr.num_bytes() > mem.usize) {
+                bad("array larger than its member " + mem.name);
+            }
+            inf.read(arr.data_ptr, arr.num_bytes());
+            return arr;
+        }
 
-    if(!fp) {
-        throw std::runtime_error("npz_load: Error! Unable to open file "+fname+"!");
-    }
+    private:
 
-    cnpy::npz_t arrays;  
+        [[noreturn]] void bad(const std::string& what) const {
+            throw std::runtime_error("npz_load: " + what + " in " + m_fname);
+        }
 
-    while(1) {
-        std::vector<char> local_header(30);
-        size_t headerres = fread(&local_header[0],sizeof(char),30,fp);
-        if(headerres != 30)
-            throw std::runtime_error("npz_load: failed fread");
-
-        //if we've reached the global header, stop reading
-        if(local_header[2] != 0x03 || local_header[3] != 0x04) break;
-
-        //read in the variable name
-        uint16_t name_len = *(uint16_t*) &local_header[26];
-        std::string varname(name_len,' ');
-        size_t vname_res = fread(&varname[0],sizeof(char),name_len,fp);
-        if(vname_res != name_len)
-            throw std::runtime_error("npz_load: failed fread");
-
-        //erase the lagging .npy        
-        varname.erase(varname.end()-4,varname.end());
-
-        //read in the extra field
-        uint16_t extra_field_len = *(uint16_t*) &local_header[28];
-        if(extra_field_len > 0) {
-            std::vector<char> buff(extra_field_len);
-            size_t efield_res = fread(&buff[0],sizeof(char),extra_field_len,fp);
-            if(efield_res != extra_field_len)
-                throw std::runtime_error("npz_load: failed fread");
+        void read_directory() {
+            const char* base = m_map->const_data();
+            const size_t size = m_map->size();
+
+            // The end of central directory record may be followed
+            // by a comment of up to 64k.
+            if (size < 22) {
+                bad("file too small to be a zip");
+            }
+            size_t eocd = size - 22;
+            const size_t lowest = size > 22+0xffff ? size - 22 - 0xffff : 0;
+            while (get_le<uint32_t>(base+eocd) != 0x06054b50) {
+                if (eocd == lowest) {
+                    bad("no end of central directory");
+                }
+                --eocd;
+            }
+            uint64_t nrecs = get_le<uint16_t>(base+eocd+10);
+            uint64_t cdsize = get_le<uint32_t>(base+eocd+12);
+            uint64_t cdoffset = get_le<uint32_t>(base+eocd+16);
+
+            // Large files (or numpy's forced zip64) use the zip64 end
+            // of central directory, found via its locator.
+            if (eocd >= 20 && get_le<uint32_t>(base+eocd-20) == 0x07064b50) {
+                const uint64_t z64 = get_le<uint64_t>(base+eocd-20+8);
+                if (z64 > size || size - z64 < 56 || get_le<uint32_t>(base+z64) != 0x06064b50) {
+                    bad("bad zip64 end of central directory");
+                }
+                nrecs = get_le<uint64_t>(base+z64+32);
+                cdsize = get_le<uint64_t>(base+z64+40);
+                cdoffset = get_le<uint64_t>(base+z64+48);
+            }
+            if (cdoffset > size || size - cdoffset < cdsize || nrecs > cdsize/46) {
+                bad("central directory beyond end of file");
+            }
+
+            m_members.resize(nrecs);
+            const char* ptr = base + cdoffset;
+            const char* end = ptr + cdsize;
+            for (auto& mem : m_members) {
+                if (end - ptr < 46 || get_le<uint32_t>(ptr) != 0x02014b50) {
+                    bad("bad central directory entry");
+                }
+                mem.method = get_le<uint16_t>(ptr+10);
+                mem.csize = get_le<uint32_t>(ptr+20);
+                mem.usize = get_le<uint32_t>(ptr+24);
+                const size_t name_len = get_le<uint16_t>(ptr+28);
+                const size_t extra_len = get_le<uint16_t>(ptr+30);
+                const size_t comment_len = get_le<uint16_t>(ptr+32);
+                mem.offset = get_le<uint32_t>(ptr+42);
+                if (size_t(end - ptr) < 46 + name_len + extra_len + comment_len) {
+                    bad("truncated central directory entry");
+                }
+                mem.name.assign(ptr+46, name_len);
+                if (mem.name.size() >= 4 && mem.name.compare(mem.name.size()-4, 4, ".npy") == 0) {
+                    mem.name.erase(mem.name.size()-4);
+                }
+
+                // Saturated fields are given in the zip64 extra
+                // field in the order usize, csize, offset.
+                const char* extra = ptr + 46 + name_len;
+                const char* extra_end = extra + extra_len;
+                while (extra_end - extra >= 4) {
+                    const uint16_t id = get_le<uint16_t>(extra);
+                    const uint16_t len = get_le<uint16_t>(extra+2);
+                    const char* field = extra + 4;
+                    const char* field_end = field + std::min<size_t>(len, extra_end - field);
+                    if (id == 0x0001) {
+                        for (uint64_t* val : {&mem.usize, &mem.csize, &mem.offset}) {
+                            if (*val != 0xffffffff) { continue; }
+                            if (field_end - field < 8) { bad("truncated zip64 field"); }
+                            *val = get_le<uint64_t>(field);
+                            field += 8;
+                        }
+                    }
+                    extra = field_end;
+                }
+                ptr += 46 + name_len + extra_len + comment_len;
+            }
         }
 
-        uint16_t compr_method = *reinterpret_cast<uint16_t*>(&local_header[0]+8);
-        uint32_t compr_bytes = *reinterpret_cast<uint32_t*>(&local_header[0]+18);
-        uint32_t uncompr_bytes = *reinterpret_cast<uint32_t*>(&local_header[0]+22);
+        std::string m_fname;
+        std::shared_ptr<mapped_file_t> m_map;
+        std::vector<zip_member_t> m_members;
+    };
+}
 
-        if(compr_method == 0) {arrays[varname] = load_the_npy_file(fp);}
-        else {arrays[varname] = load_the_npz_array(fp,compr_bytes,uncompr_bytes);}
+cnpy::npz_t cnpy::npz_load(std::string fname) {
+    NpzFile npz(fname);
+    cnpy::npz_t arrays;  
+    for (const auto& mem : npz.members()) {
+        arrays[mem.name] = npz.load(mem);
     }
-
-    fclose(fp);
     return arrays;  
 }
 
 cnpy::NpyArray cnpy::npz_load(std::string fname, std::string varname) {
-    FILE* fp = fopen(fname.c_str(),"rb");
-
-    if(!fp) throw std::runtime_error("npz_load: Unable to open file "+fname);
-
-    while(1) {
-        std::vector<char> local_header(30);
-        size_t header_res = fread(&local_header[0],sizeof(char),30,fp);
-        if(header_res != 30)
-            throw std::runtime_error("npz_load: failed fread");
-
-        //if we've reached the global header, stop reading
-        if(local_header[2] != 0x03 || local_header[3] != 0x04) break;
-
-        //read in the variable name
-        uint16_t name_len = *(uint16_t*) &local_header[26];
-        std::string vname(name_len,' ');
-        size_t vname_res = fread(&vname[0],sizeof(char),name_len,fp);      
-        if(vname_res != name_len)
-            throw std::runtime_error("npz_load: failed fread");
-        vname.erase(vname.end()-4,vname.end()); //erase the lagging .npy
-
-        //read in the extra field
-        uint16_t extra_field_len = *(uint16_t*) &local_header[28];
-        fseek(fp,extra_field_len,SEEK_CUR); //skip past the extra field
-        
-        uint16_t compr_method = *reinterpret_cast<uint16_t*>(&local_header[0]+8);
-        uint32_t compr_bytes = *reinterpret_cast<uint32_t*>(&local_header[0]+18);
-        uint32_t uncompr_bytes = *reinterpret_cast<uint32_t*>(&local_header[0]+22);
-
-        if(vname == varname) {
-            NpyArray array  = (compr_method == 0) ? load_the_npy_file(fp) : load_the_npz_array(fp,compr_bytes,uncompr_bytes);
-            fclose(fp);
-            return array;
-        }
-        else {
-            //skip past the data
-            uint32_t size = *(uint32_t*) &local_header[22];
-            fseek(fp,size,SEEK_CUR);
-        }
+    NpzFile npz(fname);
+    const auto* mem = npz.find(varname);
+    if (!mem) {
+        throw std::runtime_error("npz_load: Variable name "+varname+" not found in "+fname);
     }
+    return npz.load(*mem);
+}
 
-    fclose(fp);
-
-    //if we get here, we haven't found the variable in the file
-    throw std::runtime_error("npz_load: Variable name "+varname+" not found in "+fname);
+std::vector<std::string> cnpy::npz_names(std::string fname) {
+    NpzFile npz(fname);
+    std::vector<std::string> ret;
+    for (const auto& mem : npz.members()) {
+        ret.push_back(mem.name);
+    }
+    return ret;
 }
 
 cnpy::NpyArray cnpy::npy_load(std::string fname) {
-
-    FILE* fp = fopen(fname.c_str(), "rb");
-
-    if(!fp) throw std::runtime_error("npy_load: Unable to open file "+fname);
-
-    NpyArray arr = load_the_npy_file(fp);
-
-    fclose(fp);
-    return arr;
+    auto mf = map_file(fname, "npy_load");
+    return npy_view(mf->data(), mf->size(), mf);
 }
-
-
-
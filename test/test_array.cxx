@@ -1,5 +1,6 @@
 #include "WireCellUtil/Array.h"
 #include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Exceptions.h"
 #include "WireCellUtil/Testing.h"
 
 #include <iostream>
@@ -161,6 +162,88 @@ void test_deconv(ExecMon& em)
     Assert(norm < 0.001);
 }
 
+void test_half(ExecMon& em)
+{
+    const int nrows = 300;
+    const int ncols = 1001;
+    const int nhalf = ncols/2+1;
+
+    auto arr = my_great_array(em, nrows, ncols);
+    em("half: got array");
+
+    auto full = dft(arr);
+    auto half = dft_half(arr, 4);
+    Assert(half.rows() == nrows && half.cols() == nhalf);
+    array_xxc left = full.leftCols(nhalf);
+    Assert(same(left, half));
+
+    auto arr2 = idft_half(half, ncols, 4);
+    Assert(same(arr, arr2));
+
+    // column-wise
+    auto chalf = dft_rc_half(arr, 1);
+    Assert(chalf.rows() == nrows/2+1 && chalf.cols() == ncols);
+    array_xxc ctop = dft_rc(arr, 1).topRows(nrows/2+1);
+    Assert(same(ctop, chalf));
+    auto arr3 = idft_cr_half(chalf, nrows, 1);
+    Assert(same(arr, arr3));
+    em("half: checked");
+
+    array_xxc filt = Eigen::ArrayXXcf::Zero(nrows, nhalf) + 1.0;
+    const int nrounds = 100;
+    for (int count = 0; count < nrounds; ++count) {
+        auto deco = deconv_half(arr, filt);
+    }
+    em("half: deconv");
+    for (int count = 0; count < nrounds; ++count) {
+        auto deco = deconv_half(arr, filt, 4);
+    }
+    em("half: deconv in 4 threads");
+    auto deco = deconv_half(arr, filt, 4);
+    Assert(same(arr, deco));
+}
+
+void test_inplace(ExecMon& em)
+{
+    const int nrows = 300;
+    const int ncols = 1000;
+    auto arr = my_great_array(em, nrows, ncols);
+
+    const auto want = dft(arr);
+    array_xxc spec;
+    array_xxf back;
+    const int nrounds = 100;
+    em("inplace: start");
+    for (int count = 0; count < nrounds; ++count) {
+        dft(arr, spec);
+        idft(spec, back);
+    }
+    em("inplace: round trips into same outputs");
+    Assert(same(arr, back));
+    dft(arr, spec);
+    Assert(same(want, spec));
+
+    array_xxc cc = dft_rc(arr);
+    dft_cc_inplace(cc);
+    Assert(same(want, cc));
+    idft_cc_inplace(cc);
+    Assert(same(idft_cc(want), cc));
+
+    array_xxc half;
+    array_xxf back2(nrows, ncols);
+    dft_half(arr, half);
+    idft_half(half, back2);
+    Assert(same(arr, back2));
+
+    array_xxf wrong(nrows, ncols+2);
+    try {
+        idft_half(half, wrong);
+        AssertMsg(false, "idft_half into wrong shape");
+    }
+    catch (const ValueError& err) {
+    }
+}
+
 void test_division(ExecMon& em)
 {
     array_xxf arr1(3,2), arr2(3,2), arr3(3,2);
@@ -227,6 +310,8 @@ int main()
     test_return(em);
     test_dft(em);
     test_deconv(em);
+    test_half(em);
+    test_inplace(em);
     test_division(em);
     test_division_complex(em);
     
@@ -0,0 +1,130 @@
+#include "WireCellUtil/RayClustering.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <math.h>
+
+#include <random>
+#include <iostream>
+#include <set>
+
+using namespace WireCell;
+using namespace WireCell::RayGrid;
+using namespace std;
+
+const double pitch_magnitude = 3;
+const double width = 2000;
+const double height = 2000;
+
+// local helper codes
+#include "raygrid.h"
+
+// Make a busy slice from tracks of points.  The slice at x is made
+// from the same tracks shifted a little so neighboring slices have
+// overlapping blobs.
+static
+activities_t make_slice(Coordinates& coords, const std::vector<Point>& starts,
+                        const std::vector<Vector>& dirs, double x)
+{
+    const int nlayers = coords.nlayers();
+    std::vector< std::vector<double> > measures(nlayers);
+    measures[0].assign(1, 1.0);
+    measures[1].assign(1, 1.0);
+    for (size_t itrk=0; itrk<starts.size(); ++itrk) {
+        const Point p = starts[itrk] + x*dirs[itrk];
+        for (int ilayer=2; ilayer<nlayers; ++ilayer) {
+            const auto rel = p - coords.centers()[ilayer];
+            const int pind = coords.pitch_dirs()[ilayer].dot(rel) / coords.pitch_mags()[ilayer];
+            if (pind < 0) {
+                continue;
+            }
+            auto& m = measures[ilayer];
+            if ((int)m.size() <= pind) {
+                m.resize(pind+1, 0.0);
+            }
+            m[pind] += 1.0;
+        }
+    }
+    activities_t ret;
+    for (int ilayer=0; ilayer<nlayers; ++ilayer) {
+        auto& m = measures[ilayer];
+        ret.push_back(Activity(ilayer, {m.begin(), m.end()}));
+    }
+    return ret;
+}
+
+// The recursive projection method that associate() used to use.
+static
+std::set<blobpair_t> old_overlaps(const blobs_t& one, const blobs_t& two)
+{
+    std::set<blobpair_t> ret;
+    const size_t ilayer = two[0].strips().size() - 1;
+    const auto proj = projection(references(two), ilayer);
+    for (blobref_t blob = one.begin(); blob != one.end(); ++blob) {
+        for (blobref_t other : overlap(blob, proj, ilayer)) {
+            ret.emplace(blob - one.begin(), other - two.begin());
+        }
+    }
+    return ret;
+}
+
+int main()
+{
+    auto raypairs = make_raypairs(width, height, pitch_magnitude);
+    Coordinates coords(raypairs);
+
+    std::default_random_engine gen(42);
+    std::uniform_real_distribution<double> pos(100, 1900);
+    std::normal_distribution<double> slope(0, 20);
+    const int ntracks = 300;
+    std::vector<Point> starts;
+    std::vector<Vector> dirs;
+    for (int itrk=0; itrk<ntracks; ++itrk) {
+        starts.push_back(Point(0, pos(gen), pos(gen)));
+        dirs.push_back(Vector(0, slope(gen), slope(gen)));
+    }
+
+    const int nslices = 6;
+    std::vector<activities_t> slices;
+    for (int ind=0; ind<nslices; ++ind) {
+        slices.push_back(make_slice(coords, starts, dirs, 0.1*ind));
+    }
+    auto blobs = make_blobs(coords, slices);
+
+    ExecMon em("blob index");
+    std::vector< std::set<blobpair_t> > want;
+    for (int ind=0; ind+1<nslices; ++ind) {
+        want.push_back(old_overlaps(blobs[ind], blobs[ind+1]));
+    }
+    em("old projection overlaps");
+
+    std::vector< std::vector<blobpair_t> > got;
+    for (int ind=0; ind+1<nslices; ++ind) {
+        got.push_back(overlaps(blobs[ind], blobs[ind+1]));
+    }
+    em("indexed overlaps");
+
+    std::vector< std::vector<blobpair_t> > got4;
+    for (int ind=0; ind+1<nslices; ++ind) {
+        got4.push_back(overlaps(blobs[ind], blobs[ind+1], 4));
+    }
+    em("indexed overlaps, 4 threads");
+
+    size_t npairs = 0, nblobs = 0;
+    for (int ind=0; ind+1<nslices; ++ind) {
+        nblobs += blobs[ind].size();
+        npairs += got[ind].size();
+        Assert(std::is_sorted(got[ind].begin(), got[ind].end()));
+        Assert(got[ind] == got4[ind]);
+        Assert(want[ind] == std::set<blobpair_t>(got[ind].begin(), got[ind].end()));
+
+        size_t ncalls = 0;
+        associate(blobs[ind], blobs[ind+1], [&](blobref_t&, blobref_t&) { ++ncalls; });
+        Assert(ncalls == got[ind].size());
+    }
+    cerr << nblobs << " blobs with " << npairs << " overlaps" << endl;
+    Assert(npairs > 0);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
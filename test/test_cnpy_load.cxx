@@ -0,0 +1,170 @@
+#include "WireCellUtil/cnpy.h"
+#include "WireCellUtil/NumpyHelper.h"
+#include "WireCellUtil/Array.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace WireCell;
+using namespace std;
+using cnpy::operator+=;
+
+// Write a one-member zip holding a deflated npy image, as
+// np.savez_compressed does.
+static
+void save_compressed(const std::string& zipname, const std::string& name, const std::vector<char>& npy)
+{
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::vector<char> comp(deflateBound(&zs, npy.size()));
+    zs.next_in = (Bytef*)npy.data();
+    zs.avail_in = npy.size();
+    zs.next_out = (Bytef*)comp.data();
+    zs.avail_out = comp.size();
+    Assert(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    comp.resize(zs.total_out);
+    deflateEnd(&zs);
+    const uint32_t crc = crc32(0L, (const Bytef*)npy.data(), npy.size());
+
+    const std::string fname = name + ".npy";
+    std::vector<char> local;
+    local += "PK";
+    local += (uint16_t) 0x0403;
+    local += (uint16_t) 20;
+    local += (uint16_t) 0;
+    local += (uint16_t) 8;      // deflate
+    local += (uint16_t) 0;
+    local += (uint16_t) 0;
+    local += (uint32_t) crc;
+    local += (uint32_t) comp.size();
+    local += (uint32_t) npy.size();
+    local += (uint16_t) fname.size();
+    local += (uint16_t) 0;
+    local += fname;
+
+    std::vector<char> central;
+    central += "PK";
+    central += (uint16_t) 0x0201;
+    central += (uint16_t) 20;
+    central.insert(central.end(), local.begin()+4, local.begin()+30);
+    central += (uint16_t) 0;
+    central += (uint16_t) 0;
+    central += (uint16_t) 0;
+    central += (uint32_t) 0;
+    central += (uint32_t) 0;
+    central += fname;
+
+    std::vector<char> footer;
+    footer += "PK";
+    footer += (uint16_t) 0x0605;
+    footer += (uint16_t) 0;
+    footer += (uint16_t) 0;
+    footer += (uint16_t) 1;
+    footer += (uint16_t) 1;
+    footer += (uint32_t) central.size();
+    footer += (uint32_t) (local.size() + comp.size());
+    footer += (uint16_t) 0;
+
+    std::ofstream fp(zipname, std::ios::binary);
+    fp.write(local.data(), local.size());
+    fp.write(comp.data(), comp.size());
+    fp.write(central.data(), central.size());
+    fp.write(footer.data(), footer.size());
+}
+
+int main()
+{
+    const std::string base = "test_cnpy_load";
+    const std::string npyname = base + ".npy";
+    const std::string npzname = base + ".npz";
+    const std::string zipname = base + "-compressed.npz";
+
+    const size_t nrows = 480, ncols = 6000;
+    std::vector<float> frame(nrows*ncols);
+    for (size_t ind=0; ind<frame.size(); ++ind) {
+        frame[ind] = ind % 1013;
+    }
+    std::vector<short> small = {1, -2, 3, -4, 5};
+
+    // .npy, viewed in place
+    cnpy::npy_save(npyname, frame.data(), {nrows, ncols});
+    {
+        auto arr = cnpy::npy_load(npyname);
+        Assert(arr.mapped());
+        Assert(arr.shape.size() == 2 and arr.shape[0] == nrows and arr.shape[1] == ncols);
+        Assert(arr.as_vec<float>() == frame);
+
+        // writes go to a private copy, not the file
+        arr.data<float>()[0] = -1;
+        Assert(cnpy::npy_load(npyname).data<float>()[0] == 0);
+    }
+
+    // stored npz members, several per file
+    cnpy::npz_save(npzname, "small", small.data(), {small.size()}, "w");
+    for (int ind=0; ind<10; ++ind) {
+        cnpy::npz_save(npzname, "frame" + std::to_string(ind), frame.data(), {nrows, ncols}, "a");
+    }
+    cnpy::npz_save(npzname, "last", small.data(), {small.size()}, "a");
+
+    auto names = cnpy::npz_names(npzname);
+    Assert(names.size() == 12);
+    Assert(names.front() == "small");
+    Assert(names.back() == "last");
+
+    ExecMon em("npz load");
+    auto last = cnpy::npz_load(npzname, "last");
+    em("load last of many stored members");
+    Assert(last.as_vec<short>() == small);
+    auto f7 = cnpy::npz_load(npzname, "frame7");
+    em("load one stored frame");
+    Assert(f7.as_vec<float>() == frame);
+
+    auto all = cnpy::npz_load(npzname);
+    em("load all stored");
+    Assert(all.size() == 12);
+    Assert(all["small"].as_vec<short>() == small);
+    Assert(all["frame3"].as_vec<float>() == frame);
+
+    try {
+        cnpy::npz_load(npzname, "nope");
+        AssertMsg(false, "loaded missing member");
+    }
+    catch (const std::runtime_error& err) {
+    }
+
+    // compressed member, inflated into place
+    {
+        std::vector<char> npy = cnpy::create_npy_header<float>({nrows, ncols});
+        const char* fbytes = reinterpret_cast<const char*>(frame.data());
+        npy.insert(npy.end(), fbytes, fbytes + frame.size()*sizeof(float));
+        save_compressed(zipname, "frame", npy);
+    }
+    em("before compressed");
+    auto comp = cnpy::npz_load(zipname, "frame");
+    em("load compressed frame");
+    Assert(!comp.mapped());
+    Assert(comp.as_vec<float>() == frame);
+
+    // Eigen views of C order data
+    auto map = Numpy::as_map<float>(f7);
+    Assert(map.rows() == (int)nrows and map.cols() == (int)ncols);
+    Assert(map(0,1) == frame[1]);
+    Assert(map(3,5) == frame[3*ncols+5]);
+    const Array::array_xxf copy = map;
+    Assert(copy(nrows-1, ncols-1) == frame.back());
+    auto vmap = Numpy::as_map<short>(last);
+    Assert(vmap.rows() == 5 and vmap.cols() == 1 and vmap(1,0) == -2);
+    try {
+        Numpy::as_map<double>(f7);
+        AssertMsg(false, "mapped with wrong type");
+    }
+    catch (const ValueError& err) {
+    }
+
+    cerr << em.summary() << endl;
+    return 0;
+}
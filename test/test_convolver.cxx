@@ -0,0 +1,87 @@
+#include "WireCellUtil/Convolver.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <random>
+#include <iostream>
+
+using namespace std;
+using namespace WireCell;
+using namespace WireCell::Waveform;
+
+typedef Convolver::Method Method;
+
+static void assert_close(const realseq_t& a, const realseq_t& b)
+{
+    AssertMsg(a.size() == b.size(), "size mismatch");
+    for (size_t ind=0; ind<a.size(); ++ind) {
+        AssertMsg(std::abs(a[ind]-b[ind]) < 1e-3, "value mismatch");
+    }
+}
+
+int main()
+{
+    ExecMon em("test convolver starts");
+
+    std::default_random_engine re;
+    std::normal_distribution<float> dist(0, 1);
+    auto randseq = [&](size_t n) {
+        realseq_t seq(n);
+        for (auto& s : seq) { s = dist(re); }
+        return seq;
+    };
+
+    const realseq_t wave = randseq(6000);
+
+    for (size_t nkern : {1, 5, 64, 65, 200, 1000}) {
+        const realseq_t kern = randseq(nkern);
+        const realseq_t want = linear_convolve(wave, kern, false);
+
+        for (auto method : {Method::automatic, Method::direct, Method::overlap_add, Method::overlap_save}) {
+            Convolver conv(kern, method);
+            cerr << "nkern=" << nkern << " method=" << int(conv.method())
+                 << " block=" << conv.block_size() << " nfft=" << conv.fft_size() << endl;
+
+            // one shot
+            assert_close(want, conv.convolve(wave, false));
+
+            // streamed in odd sized chunks
+            realseq_t got;
+            for (size_t beg=0; beg<wave.size(); beg += 777) {
+                const size_t n = std::min<size_t>(777, wave.size()-beg);
+                conv.push(wave.data()+beg, n, got);
+            }
+            conv.flush(got);
+            assert_close(want, got);
+
+            // and again with a user block size
+            Convolver conv2(kern, method, 100);
+            realseq_t got2 = conv2.convolve(wave);
+            realseq_t want2(want.begin(), want.begin()+wave.size());
+            assert_close(want2, got2);
+        }
+    }
+    em("checked");
+
+    // Many channels, one response.
+    const realseq_t resp = randseq(200);
+    const int nchans = 1000;
+    for (int ich=0; ich<nchans; ++ich) {
+        auto got = linear_convolve(wave, resp);
+    }
+    cerr << em("linear_convolve") << endl;
+    Convolver conv(resp);
+    for (int ich=0; ich<nchans; ++ich) {
+        auto got = conv.convolve(wave);
+    }
+    cerr << em("Convolver") << endl;
+    realseq_t out(wave.size());
+    for (int ich=0; ich<nchans; ++ich) {
+        conv.convolve(crealspan_t(wave), realspan_t(out));
+    }
+    cerr << em("Convolver into span") << endl;
+    assert_close(out, linear_convolve(wave, resp));
+
+    cerr << em.summary() << endl;
+    return 0;
+}
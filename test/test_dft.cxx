@@ -0,0 +1,105 @@
+#include "WireCellUtil/DFT.h"
+#include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <unsupported/Eigen/FFT>
+
+#include <thread>
+#include <random>
+#include <iostream>
+#include <cstdio>
+
+using namespace std;
+using namespace WireCell;
+
+typedef std::complex<float> complex_t;
+
+static void assert_close(const vector<complex_t>& a, const vector<complex_t>& b, float eps)
+{
+    Assert(a.size() == b.size());
+    for (size_t ind=0; ind<a.size(); ++ind) {
+        Assert(std::abs(a[ind]-b[ind]) < eps);
+    }
+}
+
+int main()
+{
+    ExecMon em("test dft starts");
+
+    std::default_random_engine re;
+    std::normal_distribution<float> dist(0, 1);
+
+    for (int n : {2, 7, 10, 64, 1000, 1001}) {
+        vector<float> wave(n);
+        for (auto& w : wave) { w = dist(re); }
+
+        // compare to Eigen which Waveform used to use directly
+        Eigen::FFT<float> trans;
+        vector<complex_t> want(n);
+        trans.fwd(want, wave);
+
+        vector<complex_t> got(n);
+        DFT::fwd_r2c(wave.data(), got.data(), n);
+        assert_close(want, got, 1e-3*n);
+
+        vector<float> back(n);
+        DFT::inv_c2r(got.data(), back.data(), n);
+        for (int ind=0; ind<n; ++ind) {
+            Assert(std::abs(back[ind]-wave[ind]) < 1e-4);
+        }
+
+        // in-place complex round trip
+        vector<complex_t> spec = want;
+        DFT::inv_c2c(spec.data(), spec.data(), n);
+        DFT::fwd_c2c(spec.data(), spec.data(), n);
+        assert_close(want, spec, 1e-3*n);
+    }
+    const size_t nplans = DFT::nplans();
+    cerr << "made " << nplans << " plans" << endl;
+
+    // Same lengths again must not make new plans.
+    {
+        vector<float> wave(1000, 1.0);
+        auto spec = Waveform::dft(wave);
+        auto back = Waveform::idft(spec);
+        Assert(std::abs(back[10] - 1.0) < 1e-5);
+        Assert(DFT::nplans() == nplans);
+    }
+
+    // Hammer the cache from several threads.
+    const int nthreads = 4;
+    const int ntimes = 1000;
+    vector<std::thread> threads;
+    vector<float> sums(nthreads, 0);
+    em("start threads");
+    for (int ith=0; ith<nthreads; ++ith) {
+        threads.emplace_back([ith, &sums]() {
+                vector<float> wave(6000, 0.0);
+                wave[ith] = 1.0;
+                for (int itime=0; itime<ntimes; ++itime) {
+                    auto spec = Waveform::dft(wave);
+                    wave = Waveform::idft(spec);
+                }
+                sums[ith] = wave[ith];
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    cerr << em("threads done") << endl;
+    for (auto s : sums) {
+        Assert(std::abs(s-1.0) < 1e-3);
+    }
+
+    const std::string wisdom = "test_dft.wisdom";
+    Assert(DFT::save_wisdom(wisdom));
+    Assert(DFT::load_wisdom(wisdom));
+    std::remove(wisdom.c_str());
+    
+    DFT::clear_plans();
+    Assert(DFT::nplans() == 0);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
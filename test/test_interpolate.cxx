@@ -1,7 +1,10 @@
 #include "WireCellUtil/Interpolate.h"
+#include "WireCellUtil/Testing.h"
 #include <boost/math/interpolators/cubic_b_spline.hpp>
 
 #include <iostream>
+#include <list>
+#include <cmath>
 
 // https://www.boost.org/doc/libs/1_65_0/libs/math/doc/html/math_toolkit/interpolate/cubic_b.html
 
@@ -23,5 +26,45 @@ int main()
                   << "\tspline(x)=" << spline(x)
                   << "\n";
     }
+
+    // batches agree with single points, including beyond the ends
+    std::vector<double> xs;
+    for (double x = -0.02; x < x0 + xstep*10; x += 0.0007) {
+        xs.push_back(x);
+    }
+    xs.push_back(x0);
+    xs.push_back(x0 + xstep*(f.size()-1));
+    std::vector<double> ys(xs.size());
+    lin(xs.data(), xs.size(), ys.data());
+    for (size_t ind=0; ind<xs.size(); ++ind) {
+        AssertMsg(std::abs(ys[ind] - lin(xs[ind])) < 1e-12, "linterp batch");
+    }
+    auto samp = lin.sample(-0.02, 0.0007, xs.size()-2);
+    for (size_t ind=0; ind<samp.size(); ++ind) {
+        AssertMsg(std::abs(samp[ind] - lin(-0.02 + ind*0.0007)) < 1e-12, "linterp sample");
+    }
+
+    // irregular knots, here the same as the regular ones
+    std::vector<double> knots;
+    for (size_t ind=0; ind<f.size(); ++ind) {
+        knots.push_back(x0 + ind*xstep);
+    }
+    irrterp<double> irr(knots.begin(), knots.end(), f.begin());
+    std::vector<double> iys(xs.size());
+    irr(xs.data(), xs.size(), iys.data());
+    for (size_t ind=0; ind<xs.size(); ++ind) {
+        AssertMsg(std::abs(iys[ind] - lin(xs[ind])) < 1e-12, "irrterp batch");
+        AssertMsg(std::abs(irr(xs[ind]) - lin(xs[ind])) < 1e-12, "irrterp");
+    }
+
+    // forward iterators suffice
+    std::list<double> lknots(knots.begin(), knots.end()), lf(f.begin(), f.end());
+    irrterp<double> lirr(lknots.begin(), lknots.end(), lf.begin());
+    Assert(lirr(x0 + 2.5*xstep) == irr(x0 + 2.5*xstep));
+
+    std::vector<double> sys(xs.size());
+    interpolate(spline, xs.begin(), xs.end(), sys.begin());
+    Assert(sys[3] == spline(xs[3]));
+
     return 0;
 }
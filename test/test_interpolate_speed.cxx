@@ -0,0 +1,65 @@
+// Time linterp and irrterp over many points, as in resampling a
+// long waveform.
+
+#include "WireCellUtil/Interpolate.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace WireCell;
+
+int main()
+{
+    const size_t nsamp = 10000, nquery = 5000000;
+    std::vector<double> wave(nsamp);
+    for (size_t ind=0; ind<nsamp; ++ind) {
+        wave[ind] = std::sin(0.01*ind);
+    }
+    linterp<double> wlin(wave.begin(), wave.end(), 0.0, 0.5);
+    const double dx = 0.5*nsamp/nquery;
+    std::vector<double> one(nquery), batch(nquery), qs(nquery);
+    for (size_t ind=0; ind<nquery; ++ind) {
+        qs[ind] = ind*dx;
+    }
+    std::default_random_engine gen(1);
+    std::vector<double> rqs(qs);
+    std::shuffle(rqs.begin(), rqs.end(), gen);
+
+    WireCell::ExecMon em("interpolation");
+    for (size_t ind=0; ind<nquery; ++ind) {
+        one[ind] = wlin(qs[ind]);
+    }
+    em("linterp, one at a time");
+    wlin(qs.data(), nquery, batch.data());
+    em("linterp, batch");
+    wlin.sample(0, dx, nquery, batch.data());
+    em("linterp, sample");
+    for (size_t ind=0; ind<nquery; ++ind) {
+        AssertMsg(std::abs(one[ind] - batch[ind]) < 1e-12, "linterp sample");
+    }
+    wlin(rqs.data(), nquery, batch.data());
+    em("linterp, batch in random order");
+
+    std::vector<double> wknots(nsamp);
+    for (size_t ind=0; ind<nsamp; ++ind) {
+        wknots[ind] = 0.5*ind;
+    }
+    irrterp<double> wirr(wknots.begin(), wknots.end(), wave.begin());
+    em("before irrterp");
+    for (size_t ind=0; ind<nquery; ++ind) {
+        batch[ind] = wirr(qs[ind]);
+    }
+    em("irrterp, one at a time");
+    wirr(qs.data(), nquery, batch.data());
+    em("irrterp, batch in order");
+    for (size_t ind=0; ind<nquery; ++ind) {
+        AssertMsg(std::abs(one[ind] - batch[ind]) < 1e-12, "irrterp batch");
+    }
+    std::cerr << em.summary() << std::endl;
+    return 0;
+}
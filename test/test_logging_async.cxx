@@ -0,0 +1,117 @@
+// Compile away debug and trace macros in this file.
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+
+#include "WireCellUtil/Logging.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WireCell;
+
+// Count lines holding the text, waiting up to a few seconds for at
+// least want of them to have been written.
+static
+size_t count_lines(const std::string& fname, const std::string& text, size_t want)
+{
+    size_t count = 0;
+    for (int tries=0; tries<500; ++tries) {
+        count = 0;
+        std::ifstream fp(fname);
+        std::string line;
+        while (std::getline(fp, line)) {
+            if (line.find(text) != std::string::npos) {
+                ++count;
+            }
+        }
+        if (count >= want) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return count;
+}
+
+static
+void log_many(const std::string& what, int nthreads, int nmsgs)
+{
+    std::vector<std::thread> threads;
+    for (int ith=0; ith<nthreads; ++ith) {
+        threads.emplace_back([=]() {
+            auto l = Log::logger("worker" + std::to_string(ith));
+            for (int ind=0; ind<nmsgs; ++ind) {
+                l->debug("{} message {} from {}", what, ind, ith);
+            }
+            l->flush();
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+}
+
+int main()
+{
+    const std::string fname = "test_logging_async.log";
+    boost::filesystem::remove(fname);
+    Log::add_file(fname, "debug");
+    Log::set_level("debug");
+
+    auto l = Log::logger("test");
+    int nevals = 0;
+    SPDLOG_LOGGER_DEBUG(l, "not compiled {}", ++nevals);
+    SPDLOG_LOGGER_INFO(l, "compiled {}", ++nevals);
+    Assert(nevals == 1);
+
+    const int nthreads = 8, nmsgs = 20000;
+    ExecMon em("logging");
+    log_many("blocking", nthreads, nmsgs);
+    em("synchronous debug messages");
+    Assert(count_lines(fname, "blocking message", nthreads*nmsgs) == size_t(nthreads*nmsgs));
+
+    Assert(!Log::is_async());
+    Log::set_async(1024, 1, true);
+    Assert(Log::is_async());
+    em("switch to async");
+    log_many("queued", nthreads, nmsgs);
+    em("asynchronous debug messages");
+    l->info("after async");
+    l->flush();
+    Assert(count_lines(fname, "queued message", nthreads*nmsgs) == size_t(nthreads*nmsgs));
+    em("async messages written");
+
+    // loggers made later are also async and keep their names
+    auto late = Log::logger("late");
+    late->info("late info");
+    late->flush();
+    Assert(count_lines(fname, "[late] [info] late info", 1) == 1);
+
+    // at most 10 per period, then a note of the dropped ones
+    Log::set_rate_limit("noisy", 10, 0.2);
+    auto noisy = Log::logger("noisy");
+    for (int ind=0; ind<100; ++ind) {
+        noisy->info("noisy {}", ind);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    noisy->info("noisy again");
+    noisy->flush();
+    Assert(count_lines(fname, "dropped 90 messages", 1) == 1);
+    Assert(count_lines(fname, "noisy again", 1) == 1);
+    Assert(count_lines(fname, "[noisy] [info] noisy", 11) == 11);
+
+    Log::set_rate_limit("noisy", 0);
+    for (int ind=0; ind<100; ++ind) {
+        noisy->info("unlimited {}", ind);
+    }
+    noisy->flush();
+    Assert(count_lines(fname, "unlimited", 100) == 100);
+
+    std::cerr << em.summary() << std::endl;
+    return 0;
+}
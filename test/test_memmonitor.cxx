@@ -0,0 +1,113 @@
+#include "WireCellUtil/MemMonitor.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace WireCell;
+using namespace std;
+
+WIRECELL_MEMCOUNT_NEW_DELETE
+
+// Allocate and touch about nmb MB, hold it a while.
+static
+void hog(size_t nmb, int msec)
+{
+    std::vector<char> buf(nmb*1024*1024, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(msec));
+    Assert(buf[buf.size()/2] == 1);
+}
+
+int main()
+{
+    // one read gives the same as the separate functions
+    const auto sm = memusage_statm();
+    Assert(sm.resident > 0 and sm.size >= sm.resident);
+    Assert(std::abs(memusage_size() - sm.size) < 10*1024);
+    Assert(memusage_peak() >= sm.resident);
+
+    ExecMon em("memory reads");
+    double tot = 0;
+    for (int ind=0; ind<10000; ++ind) {
+        tot += memusage_statm().resident;
+    }
+    em("10000 statm reads");
+    for (int ind=0; ind<1000; ++ind) {
+        tot += memusage_rollup().rss;
+    }
+    em("1000 smaps_rollup reads");
+    Assert(tot > 0);
+
+    MemMonitor mon(0.005, true);
+    {
+        auto outer = mon.scope("outer");
+        {
+            auto big = mon.scope("big");
+            hog(200, 50);
+        }
+        {
+            auto small = mon.scope("small");
+            std::vector<int*> ptrs;
+            for (int ind=0; ind<1000; ++ind) {
+                ptrs.push_back(new int(ind));
+            }
+            for (auto p : ptrs) {
+                delete p;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        // from another thread, while this one has a scope open
+        std::thread other([&]() {
+            auto sc = mon.scope("other");
+            hog(50, 30);
+        });
+        other.join();
+    }
+    mon.stop();
+    const size_t nsamples = mon.samples().size();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Assert(mon.samples().size() == nsamples);
+    em("monitored");
+
+    Assert(MemCount::enabled());
+    auto scopes = mon.scopes();
+    Assert(scopes.size() == 4);
+    const auto& outer = scopes[0];
+    const auto& big = scopes[1];
+    const auto& small = scopes[2];
+    Assert(outer.name == "outer" and big.name == "big" and small.name == "small");
+    const double MB = 1024;
+    AssertMsg(big.peak_resident - big.start_resident > 190*MB, "big peak");
+    AssertMsg(big.stop_resident - big.start_resident < 100*MB, "big released");
+    Assert(outer.peak_resident >= big.peak_resident);
+    Assert(small.peak_resident < big.peak_resident);
+    AssertMsg(scopes[3].peak_resident - scopes[3].start_resident > 40*MB, "other peak");
+    Assert(outer.start <= big.start and big.stop <= small.start and small.stop <= outer.stop);
+    Assert(mon.peak_resident() >= big.peak_resident);
+
+    Assert(small.allocs.nnew >= 1000 and small.allocs.ndelete >= 1000);
+    Assert(small.allocs.bytes >= 1000*sizeof(int));
+    Assert(big.allocs.bytes >= 200*1024*1024);
+    // the other thread's allocations are not counted in outer
+    Assert(outer.allocs.bytes < big.allocs.bytes + 50*1024*1024);
+
+    auto samples = mon.samples();
+    Assert(samples.size() > 10);
+    Assert(samples[1].pss > 0);
+    for (size_t ind=1; ind<samples.size(); ++ind) {
+        Assert(samples[ind].time >= samples[ind-1].time);
+    }
+
+    auto jmon = mon.to_json();
+    Assert(jmon["samples"]["resident"].size() == samples.size());
+    Assert(jmon["scopes"][1]["name"].asString() == "big");
+    // the kernel's count may lag statm's slightly
+    Assert(jmon["kernel_peak_resident"].asDouble() > big.start_resident + 190*MB);
+
+    cerr << "samples: " << samples.size() << ", peak: " << mon.peak_resident() << " KB\n";
+    cerr << em.summary() << endl;
+    return 0;
+}
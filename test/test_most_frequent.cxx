@@ -1,24 +1,89 @@
 #include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/ShortHistogram.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <random>
 #include <iostream>
 
 using namespace WireCell;
 using namespace std;
 
+// The original, full-range implementation as reference.
+static short full_range_most_frequent(const std::vector<short>& vals)
+{
+    const size_t nbins = 1<<16;
+    std::vector<unsigned int> hist(nbins, 0);
+    for (unsigned short val : vals) {
+	hist[val] += 1;
+    }
+    auto it = std::max_element(hist.begin(), hist.end());
+    return it - hist.begin();
+}
+
+static void test_speed()
+{
+    std::default_random_engine re(42);
+    std::normal_distribution<float> norm(900, 5);
+    const int nrows = 800, ncols = 6000;
+    Array::array_xxs arr(nrows, ncols);
+    std::vector<std::vector<short> > chans(nrows, std::vector<short>(ncols));
+    for (int irow=0; irow<nrows; ++irow) {
+        for (int icol=0; icol<ncols; ++icol) {
+            chans[irow][icol] = arr(irow,icol) = std::round(norm(re));
+        }
+    }
+
+    ExecMon em("most frequent speed");
+    std::vector<short> want(nrows);
+    for (int irow=0; irow<nrows; ++irow) {
+        want[irow] = full_range_most_frequent(chans[irow]);
+    }
+    em("full range");
+    std::vector<short> got(nrows);
+    for (int irow=0; irow<nrows; ++irow) {
+        got[irow] = Waveform::most_frequent(chans[irow]);
+    }
+    em("most_frequent");
+    auto rows = Waveform::most_frequent_rows(arr);
+    em("most_frequent_rows");
+    cerr << em.summary() << endl;
+
+    for (int irow=0; irow<nrows; ++irow) {
+        Assert(got[irow] == want[irow]);
+        Assert(rows[irow] == want[irow]);
+    }
+}
+
 int main()
 {
     {
 	std::vector<short> adcv{-1,0,0,1,1,2,3,4,4,4,5,6,4,3,4,5,6,7,7,6,5};
 	auto mf = Waveform::most_frequent(adcv);
 	cerr << mf << endl;
+        Assert(mf == 4);
     }
     {
 	std::vector<short> adcv{-1,0,0,-1,-1,2,3,4,4,-1,-1,5,6,4,3,4,5,6,7,7,6,5};
 	auto mf = Waveform::most_frequent(adcv);
 	cerr << mf << endl;
+        Assert(mf == -1);
     }
     {
 	std::vector<short> adcv{5,5,5,5,1,1,1,2,2,2,2};
 	auto mf = Waveform::most_frequent(adcv);
 	cerr << mf << endl;
+        Assert(mf == 2);
+    }
+    {
+        // extremes of the range
+	std::vector<short> adcv{-32768, 32767, 32767, -32768, -32768};
+        Waveform::ShortHistogram hist;
+        hist.fill(adcv);
+        Assert(hist.mode() == -32768);
+        Assert(hist.count(32767) == 2);
+        Assert(hist.count(0) == 0);
+        Assert(hist.nbins() == 65536);
     }
+    test_speed();
 }
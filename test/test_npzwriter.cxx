@@ -0,0 +1,149 @@
+#include "WireCellUtil/NpzWriter.h"
+#include "WireCellUtil/NumpyHelper.h"
+#include "WireCellUtil/Array.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <random>
+
+using namespace WireCell;
+using namespace std;
+
+static
+void write_and_check(const std::string& fname, Numpy::NpzWriter::Compression comp, int nthreads,
+                     const std::vector<float>& frame, size_t nrows, size_t ncols)
+{
+    std::vector<int> chans(nrows);
+    for (size_t ind=0; ind<nrows; ++ind) { chans[ind] = 1000+ind; }
+    Array::array_xxf eig = Array::array_xxf::Random(7, 5);
+
+    {
+        Numpy::NpzWriter out(fname, comp, nthreads);
+        out.save("channels", chans);
+        out.save("frame", frame.data(), {nrows, ncols});
+
+        // the same frame, streamed in uneven chunks of rows
+        out.begin<float>("chunked", {nrows, ncols});
+        size_t row = 0;
+        for (size_t step = 1; row < nrows; step += 7) {
+            const size_t n = std::min(step, nrows - row);
+            out.append(frame.data() + row*ncols, n);
+            row += n;
+        }
+        out.end();
+
+        out.save("eigen", eig);
+        out.save("empty", std::vector<double>());
+
+        // misuse
+        try {
+            out.begin<float>("short", {2, 3});
+            out.append(frame.data(), 1);
+            out.end();
+            AssertMsg(false, "ended unfilled array");
+        }
+        catch (const ValueError& err) {
+        }
+        out.append(frame.data(), 1);
+        try {
+            out.append(frame.data(), 1);
+            AssertMsg(false, "overfilled array");
+        }
+        catch (const ValueError& err) {
+        }
+        out.end();
+        Assert(out.size() == 6);
+        out.close();
+    }
+
+    auto names = cnpy::npz_names(fname);
+    Assert(names.size() == 6);
+    Assert(names[0] == "channels" and names[5] == "short");
+
+    auto all = cnpy::npz_load(fname);
+    Assert(all["channels"].as_vec<int>() == chans);
+    Assert(all["frame"].as_vec<float>() == frame);
+    Assert(all["chunked"].as_vec<float>() == frame);
+    Assert(all["empty"].num_vals == 0);
+    Assert(all["short"].shape.size() == 2);
+    std::vector<float> twice(frame.begin(), frame.begin()+3);
+    twice.insert(twice.end(), frame.begin(), frame.begin()+3);
+    Assert(all["short"].as_vec<float>() == twice);
+    const auto& ea = all["eigen"];
+    Assert(ea.fortran_order);
+    Assert((Numpy::as_map<float>(ea) == eig).all());
+    if (comp == Numpy::NpzWriter::Compression::stored) {
+        Assert(all["frame"].mapped());
+    }
+}
+
+int main()
+{
+    const std::string base = "test_npzwriter";
+    const size_t nrows = 400, ncols = 3000;
+
+    // compressible, like a frame of ADC with noise
+    std::default_random_engine gen(1);
+    std::normal_distribution<float> norm(0, 3);
+    std::vector<float> frame(nrows*ncols);
+    for (auto& val : frame) {
+        val = std::round(norm(gen));
+    }
+
+    ExecMon em("npz writer");
+    write_and_check(base + "-stored.npz", Numpy::NpzWriter::Compression::stored, 1, frame, nrows, ncols);
+    em("stored, write and check");
+    write_and_check(base + "-deflate1.npz", Numpy::NpzWriter::Compression::deflate, 1, frame, nrows, ncols);
+    em("deflate, 1 thread, write and check");
+    write_and_check(base + "-deflate4.npz", Numpy::NpzWriter::Compression::deflate, 4, frame, nrows, ncols);
+    em("deflate, 4 threads, write and check");
+
+    // appending row by row deflates as well as one whole save
+    {
+        const std::string whole = base + "-whole.npz", rowwise = base + "-rowwise.npz";
+        {
+            Numpy::NpzWriter out(whole, Numpy::NpzWriter::Compression::deflate, 4);
+            out.save("frame", frame.data(), {nrows, ncols});
+        }
+        em("deflate whole frame");
+        {
+            Numpy::NpzWriter out(rowwise, Numpy::NpzWriter::Compression::deflate, 4);
+            out.begin<float>("frame", {nrows, ncols});
+            for (size_t row=0; row<nrows; ++row) {
+                out.append(frame.data() + row*ncols, 1);
+            }
+            out.end();
+        }
+        em("deflate frame row by row");
+        Assert(cnpy::npz_load(rowwise, "frame").as_vec<float>() == frame);
+        const auto wsize = boost::filesystem::file_size(whole);
+        const auto rsize = boost::filesystem::file_size(rowwise);
+        cerr << "whole: " << wsize << " row by row: " << rsize << endl;
+        Assert(rsize == wsize);
+    }
+
+    // many small arrays, as per-event dumps
+    const int narrays = 300;
+    std::vector<short> small(1000, 1);
+    const std::string oldname = base + "-npz_save.npz";
+    em("before many");
+    for (int ind=0; ind<narrays; ++ind) {
+        cnpy::npz_save(oldname, "a" + std::to_string(ind), small.data(), {small.size()}, ind ? "a" : "w");
+    }
+    em("npz_save appending many");
+    {
+        Numpy::NpzWriter out(base + "-many.npz", Numpy::NpzWriter::Compression::stored);
+        for (int ind=0; ind<narrays; ++ind) {
+            out.save("a" + std::to_string(ind), small);
+        }
+    }
+    em("NpzWriter many");
+    Assert(cnpy::npz_names(base + "-many.npz").size() == narrays);
+    Assert(cnpy::npz_load(base + "-many.npz", "a299").as_vec<short>() == small);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
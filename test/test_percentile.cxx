@@ -0,0 +1,218 @@
+#include "WireCellUtil/Percentile.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <random>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+using namespace WireCell;
+using namespace WireCell::Waveform;
+
+static void test_exact(std::default_random_engine& re)
+{
+    std::normal_distribution<float> norm(100, 10);
+    for (size_t size : {1, 2, 3, 10, 101, 1000, 6000}) {
+        realseq_t wave(size);
+        for (auto& x : wave) { x = norm(re); }
+        // some repeated values as from integer ADC
+        for (size_t ind=0; ind<size; ind += 3) { wave[ind] = std::round(wave[ind]); }
+
+        for (float p : {0.0f, 0.1f, 0.5f, 0.9f}) {
+            realseq_t copy(wave);
+            const real_t want = percentile(copy, p);
+            const real_t got = select_percentile(crealspan_t(wave), p);
+            AssertMsg(want == got, "select_percentile mismatch");
+        }
+        realseq_t copy(wave);
+        Assert(select_median(crealspan_t(wave)) == median(copy));
+    }
+
+    // degenerate
+    realseq_t flat(100, 3.0);
+    Assert(select_median(crealspan_t(flat)) == 3.0);
+
+    // spiky: most samples near one value, a few far away
+    {
+        std::uniform_real_distribution<float> uni(0, 1);
+        realseq_t spiky(100000);
+        for (auto& x : spiky) {
+            const float u = uni(re);
+            x = u < 0.001 ? 1e4*u : std::round(4*u)*1e-3;
+        }
+        for (float p : {0.1f, 0.5f, 0.999f}) {
+            realseq_t copy(spiky);
+            AssertMsg(percentile(copy, p) == select_percentile(crealspan_t(spiky), p),
+                      "select_percentile mismatch on spiky");
+        }
+    }
+
+    // a range too small to bin and non-finite samples
+    realseq_t tiny(1000, 0.0f);
+    for (size_t ind=0; ind<tiny.size(); ind += 2) { tiny[ind] = 1e-44f; }
+    Assert(select_percentile(crealspan_t(tiny), 0.25) == 0.0f);
+    Assert(select_percentile(crealspan_t(tiny), 0.75) == 1e-44f);
+    realseq_t infs(1000);
+    for (size_t ind=0; ind<infs.size(); ++ind) { infs[ind] = ind; }
+    infs[3] = INFINITY;
+    infs[4] = -INFINITY;
+    Assert(select_percentile(crealspan_t(infs), 0.0) == -INFINITY);
+    Assert(select_median(crealspan_t(infs)) == 501);
+
+    // bad binning
+    for (int bad : {0, 1}) {
+        try {
+            BinnedPercentile bp(bad ? 10 : 0, 1.0, bad ? 1.0 : 2.0);
+            AssertMsg(false, "made bad BinnedPercentile");
+        }
+        catch (const ValueError& err) {
+        }
+    }
+}
+
+static void test_rows(std::default_random_engine& re)
+{
+    std::uniform_real_distribution<float> uni(-10, 10);
+    const int nrows = 7, ncols = 333;
+    Array::array_xxf arr(nrows, ncols);
+    for (int irow=0; irow<nrows; ++irow) {
+        for (int icol=0; icol<ncols; ++icol) {
+            arr(irow,icol) = uni(re);
+        }
+    }
+    auto meds = median_rows(arr);
+    Assert(meds.size() == nrows);
+    for (int irow=0; irow<nrows; ++irow) {
+        realseq_t row(ncols);
+        for (int icol=0; icol<ncols; ++icol) {
+            row[icol] = arr(irow,icol);
+        }
+        Assert(meds(irow) == median(row));
+    }
+}
+
+static void test_streaming(std::default_random_engine& re)
+{
+    std::normal_distribution<float> norm(0, 1);
+    const size_t size = 100000;
+    realseq_t wave(size);
+    for (auto& x : wave) { x = norm(re); }
+
+    P2Percentile p2med(0.5), p2hi(0.9);
+    p2med(crealspan_t(wave));
+    p2hi(crealspan_t(wave));
+    Assert(p2med.count() == size);
+    cerr << "P2 median: " << p2med.value() << " 90%: " << p2hi.value() << endl;
+    Assert(std::abs(p2med.value()) < 0.05);
+    Assert(std::abs(p2hi.value() - 1.2816) < 0.05);
+
+    // exact while short
+    P2Percentile small(0.5);
+    small(3); small(1); small(2);
+    Assert(small.value() == 2);
+
+    BinnedPercentile bp(400, -5, 5);
+    bp(crealspan_t(wave));
+    Assert(bp.count() == size);
+    cerr << "Binned median: " << bp.median() << endl;
+    Assert(std::abs(bp.median()) < 0.05);
+    Assert(std::abs(bp.percentile(0.9) - 1.2816) < 0.05);
+    bp.reset();
+    Assert(bp.count() == 0);
+}
+
+static void test_running(std::default_random_engine& re)
+{
+    std::uniform_real_distribution<float> uni(0, 100);
+    const size_t size = 500;
+    realseq_t wave(size);
+    for (auto& x : wave) { x = uni(re); }
+
+    const size_t window = 21;
+    RunningMedian rm(window);
+    for (size_t ind=0; ind<size; ++ind) {
+        const real_t got = rm(wave[ind]);
+        const size_t beg = ind+1 >= window ? ind+1-window : 0;
+        realseq_t win(wave.begin()+beg, wave.begin()+ind+1);
+        Assert(rm.size() == win.size());
+        Assert(got == median(win));
+    }
+
+    realseq_t out(size);
+    running_median(crealspan_t(wave), realspan_t(out), window);
+    const size_t half = window/2;
+    for (size_t ind=0; ind<size; ++ind) {
+        const size_t beg = ind >= half ? ind-half : 0;
+        const size_t end = std::min(size, ind+half+1);
+        realseq_t win(wave.begin()+beg, wave.begin()+end);
+        Assert(out[ind] == median(win));
+    }
+}
+
+static void test_speed(std::default_random_engine& re)
+{
+    std::normal_distribution<float> norm(800, 20);
+    const size_t size = 6000;
+    const int ntimes = 2000;
+    realseq_t wave(size);
+    for (auto& x : wave) { x = std::round(norm(re)); }
+
+    ExecMon em("percentile speed");
+    float dummy = 0;
+    for (int ind=0; ind<ntimes; ++ind) {
+        realseq_t copy(wave);
+        dummy += median(copy);
+    }
+    em("median with copy");
+    for (int ind=0; ind<ntimes; ++ind) {
+        realseq_t copy(wave);
+        dummy += median_binned(copy);
+    }
+    em("median_binned with copy");
+    for (int ind=0; ind<ntimes; ++ind) {
+        dummy += select_median(crealspan_t(wave));
+    }
+    em("select_median");
+    realseq_t spiky(wave);
+    for (size_t ind=0; ind<size; ++ind) {
+        // noise with a few large signals
+        spiky[ind] = ind % 100 ? std::round(norm(re)) : 4000 + std::abs(norm(re))*10;
+    }
+    for (int ind=0; ind<ntimes; ++ind) {
+        realseq_t copy(spiky);
+        dummy += median(copy);
+    }
+    em("spiky median with copy");
+    for (int ind=0; ind<ntimes; ++ind) {
+        dummy += select_median(crealspan_t(spiky));
+    }
+    em("spiky select_median");
+    for (int ind=0; ind<ntimes; ++ind) {
+        P2Percentile p2(0.5);
+        p2(crealspan_t(wave));
+        dummy += p2.value();
+    }
+    em("P2Percentile");
+    BinnedPercentile bp(4096, 0, 4096);
+    for (int ind=0; ind<ntimes; ++ind) {
+        bp.reset();
+        bp(crealspan_t(wave));
+        dummy += bp.median();
+    }
+    em("BinnedPercentile");
+    cerr << em.summary() << endl;
+    cerr << "(ignore: " << dummy << ")" << endl;
+}
+
+int main()
+{
+    std::default_random_engine re(42);
+    test_exact(re);
+    test_rows(re);
+    test_streaming(re);
+    test_running(re);
+    test_speed(re);
+    return 0;
+}
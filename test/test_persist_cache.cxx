@@ -0,0 +1,146 @@
+#include "WireCellUtil/PersistCache.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+using namespace WireCell;
+using namespace std;
+
+static
+Json::Value parse(const std::string& fname)
+{
+    std::ifstream fp(fname);
+    Json::Value jroot;
+    fp >> jroot;
+    return jroot;
+}
+
+static
+void write(const std::string& fname, const std::string& text)
+{
+    std::ofstream fp(fname);
+    fp << text;
+}
+
+int main()
+{
+    namespace bfs = boost::filesystem;
+    const bfs::path base = bfs::absolute("test_persist_cache-dir");
+    bfs::remove_all(base);
+    bfs::create_directories(base);
+    const std::string fname = (base / "data.json").string();
+    const std::string cdir = (base / "cache").string();
+
+    write(fname, R"({"name": "test", "ok": true, "no": false, "nothing": null,
+ "big": 18446744073709551615, "neg": -3,
+ "ints": [1, 2, 3, -4], "reals": [1.5, 2.25, -3.0],
+ "mixed": [1, 2.5, "three", [4], {"five": 5}], "empty": [], "obj": {}})");
+    const Json::Value want = parse(fname);
+
+    // off by default, unless the environment says otherwise
+    Persist::set_cache_dir("");
+    Json::Value got;
+    Assert(Persist::cache_file(fname).empty());
+    Assert(!Persist::load_cached(fname, got));
+
+    Persist::set_cache_dir(cdir);
+    Assert(!Persist::load_cached(fname, got)); // not yet cached
+    Persist::save_cached(fname, want);
+    Assert(bfs::exists(Persist::cache_file(fname)));
+    Assert(Persist::load_cached(fname, got));
+    Assert(got == want);
+    Assert(got["big"].asUInt64() == 18446744073709551615ULL);
+    Assert(got["reals"][1].isDouble());
+    Assert(got["ints"][3].asInt() == -4);
+    Assert(got["mixed"][4]["five"].asInt() == 5);
+
+    // a new time stamp with the same content is still valid, by hash,
+    // and is recorded
+    bfs::last_write_time(fname, bfs::last_write_time(fname) + 10);
+    Assert(Persist::load_cached(fname, got));
+    Assert(got == want);
+    Assert(Persist::load_cached(fname, got));
+
+    // changed content of the same size with a new time stamp is not
+    {
+        const auto mtime = bfs::last_write_time(fname);
+        std::string text;
+        {
+            std::ifstream fp(fname);
+            text.assign(std::istreambuf_iterator<char>(fp), std::istreambuf_iterator<char>());
+        }
+        text[text.find("test")] = 'b';
+        write(fname, text);
+        bfs::last_write_time(fname, mtime + 20);
+        Assert(!Persist::load_cached(fname, got));
+    }
+
+    // an image of the other byte order is not read
+    {
+        Persist::save_cached(fname, parse(fname));
+        Assert(Persist::load_cached(fname, got));
+        std::fstream fp(Persist::cache_file(fname), std::ios::binary|std::ios::in|std::ios::out);
+        char order[4];
+        fp.seekg(8);
+        fp.read(order, 4);
+        std::reverse(order, order+4);
+        fp.seekp(8);
+        fp.write(order, 4);
+        fp.close();
+        Assert(!Persist::load_cached(fname, got));
+    }
+    write(fname, R"({"name": "changed"})");
+    Assert(!Persist::load_cached(fname, got));
+
+    // a failed write leaves nothing behind
+    {
+        const std::string cname = Persist::cache_file(fname);
+        bfs::remove(cname);
+        bfs::create_directories(bfs::path(cname) / "blocker");
+        Persist::save_cached(fname, parse(fname));
+        Assert(!Persist::load_cached(fname, got));
+        bfs::remove_all(cname);
+        for (const auto& ent : bfs::directory_iterator(cdir)) {
+            AssertMsg(ent.path().extension() != ".tmp", "temporary cache file left behind");
+        }
+    }
+
+    // a large numeric file
+    std::default_random_engine gen(42);
+    std::normal_distribution<double> norm;
+    Json::Value big;
+    for (int ipath=0; ipath<200; ++ipath) {
+        Json::Value path;
+        path["pitchpos"] = ipath*0.1;
+        Json::Value current(Json::arrayValue);
+        for (int ind=0; ind<2000; ++ind) {
+            current.append(norm(gen));
+        }
+        path["current"] = current;
+        big["paths"].append(path);
+    }
+    {
+        std::ofstream fp(fname);
+        fp << big;
+    }
+    ExecMon em("persist cache");
+    const auto parsed = parse(fname);
+    em("parse JSON text");
+    Persist::save_cached(fname, parsed);
+    em("write cache");
+    Json::Value cached;
+    Assert(Persist::load_cached(fname, cached));
+    em("load cache");
+    Assert(cached == parsed);
+    cerr << em.summary() << endl;
+
+    bfs::remove_all(base);
+    return 0;
+}
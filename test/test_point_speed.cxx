@@ -0,0 +1,95 @@
+// Compare throughput of Point arithmetic against the old,
+// std::vector-backed storage which D3Vector used to have.
+
+#include "WireCellUtil/Point.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <random>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+using namespace WireCell;
+
+// Minimal copy of the old heap-backed D3Vector, just enough for the
+// arithmetic exercised below.
+struct OldPoint {
+    std::vector<double> m_v;
+    OldPoint(double a=0, double b=0, double c=0) : m_v(3) {
+        m_v[0]=a; m_v[1]=b; m_v[2]=c;
+    }
+    OldPoint(const OldPoint& o) : m_v(3) {
+        m_v[0]=o.x(); m_v[1]=o.y(); m_v[2]=o.z();
+    }
+    OldPoint& operator=(const OldPoint& o) {
+        m_v.resize(3);
+        m_v[0]=o.x(); m_v[1]=o.y(); m_v[2]=o.z();
+        return *this;
+    }
+    double x() const { return m_v[0]; }
+    double y() const { return m_v[1]; }
+    double z() const { return m_v[2]; }
+    double dot(const OldPoint& o) const { return x()*o.x() + y()*o.y() + z()*o.z(); }
+};
+OldPoint operator-(const OldPoint a, const OldPoint b) {
+    return OldPoint(a.x()-b.x(), a.y()-b.y(), a.z()-b.z());
+}
+OldPoint operator+(const OldPoint a, const OldPoint b) {
+    return OldPoint(a.x()+b.x(), a.y()+b.y(), a.z()+b.z());
+}
+OldPoint operator*(const OldPoint a, double s) {
+    return OldPoint(a.x()*s, a.y()*s, a.z()*s);
+}
+
+// The typical pattern: project a displacement onto a pitch direction
+// and step along it.
+template<typename P>
+double work(const std::vector<P>& pts, const P& origin, const P& pitch, int ntimes)
+{
+    double tot = 0;
+    for (int itime=0; itime<ntimes; ++itime) {
+        for (const auto& pt : pts) {
+            const P rel = pt - origin;
+            const double pit = pitch.dot(rel);
+            const P moved = origin + pitch*pit;
+            tot += moved.x() + pit;
+        }
+    }
+    return tot;
+}
+
+int main()
+{
+    ExecMon em("test point speed starts");
+
+    const int npts = 100000;
+    const int ntimes = 20;
+
+    std::default_random_engine re;
+    std::uniform_real_distribution<> dist(-1000, 1000);
+
+    std::vector<Point> newpts(npts);
+    std::vector<OldPoint> oldpts(npts);
+    for (int ind=0; ind<npts; ++ind) {
+        const double x = dist(re), y=dist(re), z=dist(re);
+        newpts[ind] = Point(x,y,z);
+        oldpts[ind] = OldPoint(x,y,z);
+    }
+    em("generated points");
+
+    const double oldtot = work(oldpts, OldPoint(1,2,3), OldPoint(0,0.6,0.8), ntimes);
+    cerr << em("old vector-backed point arithmetic") << endl;
+
+    const double newtot = work(newpts, Point(1,2,3), Point(0,0.6,0.8), ntimes);
+    cerr << em("new array-backed point arithmetic") << endl;
+
+    cerr << "old=" << oldtot << " new=" << newtot << endl;
+    Assert(oldtot == newtot);
+
+    constexpr Point cp = Point(1,2,3) + Point(1,1,1)*2.0;
+    static_assert(cp.x() == 3.0 && cp.dot(Point(0,0,1)) == 5.0, "constexpr arithmetic");
+
+    cerr << em.summary() << endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "WireCellUtil/Profiler.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using namespace WireCell;
+using namespace std;
+
+static
+void spin(int usec)
+{
+    const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(usec);
+    while (std::chrono::steady_clock::now() < until) { }
+}
+
+static
+void work(Profiler& prof, int ith, int nloops)
+{
+    prof.name_thread("worker " + std::to_string(ith));
+    WIRECELL_PROFILE_ZONE(prof, "work");
+    for (int ind=0; ind<nloops; ++ind) {
+        WIRECELL_PROFILE_ZONE(prof, "loop");
+        spin(100);
+        {
+            Profiler::Zone z(prof, "inner");
+            spin(200);
+        }
+    }
+}
+
+int main()
+{
+    const std::string fname = "test_profiler.json";
+
+    Profiler prof;
+    const int nthreads = 4, nloops = 50;
+    std::vector<std::thread> threads;
+    for (int ith=0; ith<nthreads; ++ith) {
+        threads.emplace_back(work, std::ref(prof), ith, nloops);
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    {
+        Profiler::Zone z(prof, prof.intern(std::string("main ") + "zone"));
+        spin(50);
+    }
+    Assert(prof.nzones() == size_t(nthreads*(1 + 2*nloops) + 1));
+
+    auto stats = prof.stats();
+    Assert(stats.size() == 4);
+    std::map<std::string, Profiler::ZoneStats> byname;
+    for (const auto& zs : stats) {
+        byname[zs.name] = zs;
+        Assert(zs.min <= zs.p99 and zs.p99 <= zs.max);
+        Assert(zs.self <= zs.total + 1e-9);
+    }
+    const auto& w = byname["work"];
+    const auto& l = byname["loop"];
+    const auto& i = byname["inner"];
+    Assert(w.count == nthreads and l.count == size_t(nthreads*nloops) and i.count == l.count);
+    Assert(byname["main zone"].count == 1);
+    Assert(i.min >= 200e-6 and l.min >= 300e-6);
+    // self excludes nested zones
+    AssertMsg(std::abs(l.self - (l.total - i.total)) < 1e-6, "loop self time");
+    AssertMsg(std::abs(w.self - (w.total - l.total)) < 1e-6, "work self time");
+    Assert(std::abs(i.self - i.total) < 1e-12);
+    Assert(stats[0].name == "work");
+    cerr << prof.summary();
+
+    // Chrome trace
+    prof.write_trace(fname);
+    Json::Value jtrace;
+    {
+        std::ifstream fp(fname);
+        fp >> jtrace;
+    }
+    const auto& jevs = jtrace["traceEvents"];
+    size_t nx = 0, nm = 0;
+    for (const auto& jev : jevs) {
+        if (jev["ph"].asString() == "X") {
+            ++nx;
+            Assert(jev["dur"].asDouble() >= 0);
+        }
+        if (jev["ph"].asString() == "M") {
+            ++nm;
+            Assert(jev["args"]["name"].asString().find("worker") == 0);
+        }
+    }
+    Assert(nx == prof.nzones());
+    Assert(nm == nthreads);
+    boost::filesystem::remove(fname);
+
+    // overhead
+    const int nzones = 1000000;
+    Profiler fast;
+    ExecMon em("profiler overhead");
+    for (int ind=0; ind<nzones; ++ind) {
+        WIRECELL_PROFILE_ZONE(fast, "empty");
+    }
+    em("1M empty zones");
+    fast.enable(false);
+    for (int ind=0; ind<nzones; ++ind) {
+        WIRECELL_PROFILE_ZONE(fast, "disabled");
+    }
+    em("1M disabled zones");
+    Assert(fast.nzones() == size_t(nzones));
+    cerr << em.summary() << endl;
+    return 0;
+}
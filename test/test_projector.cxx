@@ -0,0 +1,135 @@
+#include "WireCellUtil/Projector.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Units.h"
+
+#include <iostream>
+#include <random>
+#include <cmath>
+
+using namespace WireCell;
+using namespace WireCell::WireSchema;
+using namespace std;
+
+// One face of three planes of wires at +60, -60 and 0 degrees from
+// the Y axis with channels counting up from 1000 per plane.
+static
+StoreDBPtr make_db(int nwires)
+{
+    auto db = std::make_shared<StoreDB>();
+    Face face{0, {}};
+    const double angles[3] = {60*units::degree, -60*units::degree, 0};
+    for (int iplane=0; iplane<3; ++iplane) {
+        Plane plane{iplane, {}};
+        const Vector wdir(0, cos(angles[iplane]), sin(angles[iplane]));
+        const Vector pdir(0, -sin(angles[iplane]), cos(angles[iplane]));
+        const Point center0(-iplane*5*units::mm, 0, -0.5*nwires*5*units::mm);
+        for (int iwire=0; iwire<nwires; ++iwire) {
+            const Point center = center0 + (iwire*5*units::mm)*pdir;
+            Wire w;
+            w.ident = iwire;
+            w.channel = 1000*(iplane+1) + iwire;
+            w.segment = 0;
+            w.tail = center - units::m*wdir;
+            w.head = center + units::m*wdir;
+            plane.wires.push_back(db->wires.size());
+            db->wires.push_back(w);
+        }
+        face.planes.push_back(db->planes.size());
+        db->planes.push_back(plane);
+    }
+    Anode anode{0, {0}};
+    db->faces.push_back(face);
+    db->anodes.push_back(anode);
+    db->detectors.push_back(Detector{0, {0}});
+    return db;
+}
+
+int main()
+{
+    const int nwires = 480;
+    Store store(make_db(nwires));
+    Projector proj(store, store.faces()[0]);
+    Assert(proj.nplanes() == 3);
+
+    const size_t npoints = 1000000;
+    std::default_random_engine gen(1);
+    std::uniform_real_distribution<double> ux(0, 2*units::m), uyz(-1.5*units::m, 1.5*units::m);
+    std::vector<double> xs(npoints), ys(npoints), zs(npoints);
+    std::vector<Point> pts(npoints);
+    for (size_t ind=0; ind<npoints; ++ind) {
+        xs[ind] = ux(gen); ys[ind] = uyz(gen); zs[ind] = uyz(gen);
+        pts[ind] = Point(xs[ind], ys[ind], zs[ind]);
+    }
+
+    ExecMon em("projection");
+    std::vector<int> wsum(3, 0);
+    for (size_t ipl=0; ipl<3; ++ipl) {
+        const Pimpos& pp = proj.pimpos(ipl);
+        for (const auto& pt : pts) {
+            const double pitch = pp.distance(pt);
+            const double drift = pp.distance(pt, 0);
+            auto wi = pp.closest(pitch);
+            wsum[ipl] += wi.first + wi.second + int(drift);
+        }
+    }
+    em("per point with Pimpos");
+    auto got = proj.project(xs, ys, zs);
+    em("batched with Projector");
+    proj.project(npoints, xs.data(), ys.data(), zs.data(), got);
+    em("batched again, reusing results");
+    Assert(got.size() == 3);
+
+    size_t ninside = 0;
+    for (size_t ipl=0; ipl<3; ++ipl) {
+        const Pimpos& pp = proj.pimpos(ipl);
+        const auto& res = got[ipl];
+        const auto& chans = store.channels(store.planes()[ipl]);
+        int sum = 0;
+        for (size_t ind=0; ind<npoints; ++ind) {
+            const double pitch = pp.distance(pts[ind]);
+            auto wi = pp.closest(pitch);
+            Assert(res.pitch[ind] == pitch);
+            Assert(res.drift[ind] == pp.distance(pts[ind], 0));
+            Assert(res.wire[ind] == wi.first);
+            Assert(res.impact[ind] == wi.second);
+            if (0 <= wi.first and wi.first < nwires) {
+                Assert(res.channel[ind] == chans[wi.first]);
+                ++ninside;
+            }
+            else {
+                Assert(res.channel[ind] == -1);
+            }
+            sum += res.wire[ind] + res.impact[ind] + int(res.drift[ind]);
+        }
+        Assert(sum == wsum[ipl]);
+    }
+    Assert(ninside > 0 and ninside < 3*npoints);
+
+    // A point on a wire is at that wire, impact zero, and its drift
+    // distance is its height above the plane.
+    const auto& w = store.wires(store.planes()[2])[17];
+    const Point onwire = 0.5*(w.tail + w.head) + Vector(units::m, 0, 0);
+    double x = onwire.x(), y = onwire.y(), z = onwire.z();
+    std::vector<Projector::Projected> one;
+    proj.project(1, &x, &y, &z, one);
+    Assert(one[2].wire[0] == 17);
+    Assert(one[2].impact[0] == 0);
+    Assert(one[2].channel[0] == w.channel);
+    AssertMsg(std::abs(std::abs(one[2].drift[0]) - units::m) < 1e-6, "drift distance");
+
+    // Pimpos only, without channels
+    Projector bare({Pimpos(10, 0, 9*units::mm)});
+    auto b = bare.project({0.0}, {0.0}, {4.2*units::mm});
+    Assert(b[0].wire[0] == 4 and b[0].impact[0] == 2 and b[0].channel[0] == -1);
+
+    try {
+        bare.project({0.0}, {0.0, 1.0}, {0.0});
+        AssertMsg(false, "projected mismatched arrays");
+    }
+    catch (const ValueError& err) {
+    }
+
+    cerr << em.summary() << endl;
+    return 0;
+}
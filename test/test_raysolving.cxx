@@ -0,0 +1,173 @@
+#include "WireCellUtil/RaySolving.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <random>
+#include <iostream>
+#include <set>
+
+using namespace WireCell;
+using namespace WireCell::RayGrid;
+using namespace std;
+
+// Make a cluster set of many small and a few large components, each
+// with some blobs ('s') sharing some channels ('m').
+static
+Grouping::clusterset_t make_clusters(std::default_random_engine& gen, int nclusters)
+{
+    std::uniform_real_distribution<float> charge(100, 1000);
+    Grouping::clusterset_t cset;
+    size_t sid = 0;
+    for (int icl=0; icl<nclusters; ++icl) {
+        const int nsrcs = icl%100 == 0 ? 200 : 1 + icl%4;
+        const int nmeas = nsrcs + 2;
+        auto& cl = cset[icl];
+        for (int ind=0; ind<nsrcs; ++ind) {
+            cl.push_back(Grouping::node_t{'s', sid++, 0.0, 1.0});
+        }
+        for (int ind=0; ind<nmeas; ++ind) {
+            cl.push_back(Grouping::node_t{'m', 0, charge(gen), 1.0});
+        }
+    }
+    return cset;
+}
+
+// Return, for each node, the index of the first node in its cluster.
+static
+std::vector<size_t> partition(const Grouping::clusterset_t& cset, size_t nnodes)
+{
+    std::vector<size_t> ret(nnodes);
+    for (const auto& it : cset) {
+        size_t first = it.second.front().ident;
+        for (const auto& node : it.second) {
+            first = std::min(first, node.ident);
+        }
+        for (const auto& node : it.second) {
+            ret[node.ident] = first;
+        }
+    }
+    return ret;
+}
+
+static
+void test_grouping(std::default_random_engine& gen)
+{
+    // Slices ('s') and channels ('m') over a few thousand wires.
+    const size_t nnodes = 20000, nwires = 50000;
+    std::uniform_int_distribution<size_t> wire(0, nwires-1);
+    std::uniform_int_distribution<size_t> nw(1, 3);
+    std::vector<Grouping::node_t> nodes;
+    std::vector<size_t> offsets{0};
+    std::vector<Grouping::ident_t> wids;
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        // node ident is its index to check the partition
+        nodes.push_back(Grouping::node_t{ind%2 ? 's' : 'm', ind, 1.0, 1.0});
+        const size_t w0 = wire(gen), n = nw(gen);
+        for (size_t iw=0; iw<n; ++iw) {
+            wids.push_back((w0 + iw) % nwires);
+        }
+        offsets.push_back(wids.size());
+    }
+
+    ExecMon em("grouping");
+    Grouping one;
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        const auto& n = nodes[ind];
+        one.add(n.ntype, n.ident,
+                std::vector<Grouping::ident_t>(wids.begin()+offsets[ind], wids.begin()+offsets[ind+1]),
+                n.value, n.weight);
+    }
+    auto cone = one.clusters();
+    em("grouping one at a time");
+
+    Grouping bulk;
+    const size_t half = nnodes/2;
+    // in two parts to exercise joining with earlier nodes
+    bulk.add(std::vector<Grouping::node_t>(nodes.begin(), nodes.begin()+half),
+             std::vector<size_t>(offsets.begin(), offsets.begin()+half+1), wids);
+    bulk.add(std::vector<Grouping::node_t>(nodes.begin()+half, nodes.end()),
+             std::vector<size_t>(offsets.begin()+half, offsets.end()), wids);
+    auto cbulk = bulk.clusters();
+    em("grouping in bulk");
+
+    const auto& graph = bulk.graph();
+    std::vector<int> comp(boost::num_vertices(graph));
+    const size_t ncomp = boost::connected_components(graph, &comp[0]);
+    em("boost graph and connected components");
+    cerr << em.summary() << endl;
+
+    Assert(one.nnodes() == nnodes);
+    Assert(one.nclusters() == cone.size());
+    Assert(bulk.nclusters() == cbulk.size());
+    const auto pone = partition(cone, nnodes);
+    Assert(pone == partition(cbulk, nnodes));
+
+    // boost components include wire-only vertices but none of ours
+    // are wireless so component count over nodes must match.
+    std::set<int> used;
+    for (size_t ind=0; ind<nnodes; ++ind) {
+        used.insert(comp[ind]);
+        Assert(comp[ind] == comp[pone[ind]]);
+    }
+    Assert(used.size() == cone.size());
+    Assert(ncomp >= used.size());
+
+    // The graph is kept until more nodes are added.
+    const size_t nverts = boost::num_vertices(graph);
+    Assert(&bulk.graph() == &graph);
+    bulk.add('s', nnodes, {nwires}, 1.0);
+    Assert(boost::num_vertices(bulk.graph()) == nverts + 2);
+    cerr << cone.size() << " clusters of " << nnodes << " nodes" << endl;
+}
+
+int main()
+{
+    std::default_random_engine gen(42);
+    const int nclusters = 1000;
+    auto cset = make_clusters(gen, nclusters);
+    size_t nsrcs = 0;
+    for (const auto& it : cset) {
+        for (const auto& node : it.second) {
+            nsrcs += node.ntype == 's';
+        }
+    }
+
+    test_grouping(gen);
+
+    ExecMon em("raysolving");
+    Solving serial;
+    serial.add(cset);
+    auto want = serial.solve();
+    em("solve with 1 thread");
+    Assert(want.size() == nsrcs);
+
+    // solving again reuses each solver from its last solution
+    auto again = serial.solve();
+    em("solve again, reusing solvers");
+    Assert(again.size() == want.size());
+    for (const auto& it : want) {
+        Assert(std::abs(again.at(it.first) - it.second) <= 1e-3*std::max(1.0f, std::abs(it.second)));
+    }
+
+    Solving parallel;
+    parallel.add(cset);
+    auto got = parallel.solve(4);
+    em("solve with 4 threads");
+    Assert(got.size() == want.size());
+    for (const auto& it : want) {
+        Assert(got.at(it.first) == it.second);
+    }
+
+    // Sources with no measurement keep their initial value.
+    Grouping::clusterset_t lone;
+    lone[0].push_back(Grouping::node_t{'s', nsrcs, 42.0, 1.0});
+    lone[0].push_back(Grouping::node_t{'s', nsrcs+1, 7.0, 1.0});
+    parallel.add(lone);
+    got = parallel.solve(4);
+    Assert(got.size() == nsrcs + 2);
+    Assert(got.at(nsrcs) == 42.0f and got.at(nsrcs+1) == 7.0f);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
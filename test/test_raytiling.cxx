@@ -0,0 +1,172 @@
+#include "WireCellUtil/RayTiling.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <math.h>
+#include <cmath>
+
+#include <random>
+#include <iostream>
+
+using namespace WireCell;
+using namespace WireCell::RayGrid;
+using namespace std;
+
+const double pitch_magnitude = 5;
+const double width = 1000;
+const double height = 1000;
+
+// local helper codes
+#include "raygrid.h"
+
+// Make activity for each layer from some random points.
+static
+activities_t make_slice(Coordinates& coords, std::default_random_engine& gen, int npoints)
+{
+    std::uniform_real_distribution<double> position(0, std::min(width, height));
+    const int nlayers = coords.nlayers();
+    std::vector< std::vector<double> > measures(nlayers);
+    // the first two layers bound the active area
+    measures[0].assign(1, 1.0);
+    measures[1].assign(1, 1.0);
+    for (int ipt=0; ipt<npoints; ++ipt) {
+        const Point p(0, position(gen), position(gen));
+        for (int ilayer=2; ilayer<nlayers; ++ilayer) {
+            const auto rel = p - coords.centers()[ilayer];
+            const int pind = coords.pitch_dirs()[ilayer].dot(rel) / coords.pitch_mags()[ilayer];
+            if (pind < 0) {
+                continue;
+            }
+            auto& m = measures[ilayer];
+            if ((int)m.size() <= pind) {
+                m.resize(pind+1, 0.0);
+            }
+            m[pind] += 1.0;
+        }
+    }
+    activities_t ret;
+    for (int ilayer=0; ilayer<nlayers; ++ilayer) {
+        auto& m = measures[ilayer];
+        ret.push_back(Activity(ilayer, {m.begin(), m.end()}));
+    }
+    return ret;
+}
+
+static
+bool same(const blobs_t& one, const blobs_t& two)
+{
+    if (one.size() != two.size()) {
+        return false;
+    }
+    for (size_t ib=0; ib<one.size(); ++ib) {
+        const auto& s1 = one[ib].strips();
+        const auto& s2 = two[ib].strips();
+        if (s1.size() != s2.size()) { return false; }
+        for (size_t is=0; is<s1.size(); ++is) {
+            if (s1[is].layer != s2[is].layer or s1[is].bounds != s2[is].bounds) {
+                return false;
+            }
+        }
+        const auto& c1 = one[ib].corners();
+        const auto& c2 = two[ib].corners();
+        if (c1.size() != c2.size()) { return false; }
+        for (size_t ic=0; ic<c1.size(); ++ic) {
+            if (c1[ic].first.grid != c2[ic].first.grid or
+                c1[ic].second.grid != c2[ic].second.grid or
+                c1[ic].first.layer != c2[ic].first.layer or
+                c1[ic].second.layer != c2[ic].second.layer) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static
+void test_pitch_locations(const Coordinates& coords)
+{
+    const int nlayers = coords.nlayers();
+    const auto& a = coords.a();
+    const auto& b = coords.b();
+
+    crossings_t crossings;
+    for (int il=0; il<nlayers; ++il) {
+        for (int im=0; im<nlayers; ++im) {
+            if (il == im) { continue; }
+            for (int i=0; i<10; ++i) {
+                crossings.push_back(std::make_pair(coordinate_t{il, i}, coordinate_t{im, 3*i+1}));
+            }
+        }
+    }
+
+    std::vector<double> out;
+    for (int in=0; in<nlayers; ++in) {
+        coords.pitch_locations(crossings, in, out);
+        Assert(out.size() == crossings.size());
+        for (size_t ind=0; ind<crossings.size(); ++ind) {
+            const auto& c = crossings[ind];
+            const int il = c.first.layer, im = c.second.layer;
+            const double want = c.second.grid*a[il][im][in] + c.first.grid*a[im][il][in] + b[il][im][in];
+            Assert(out[ind] == want);
+            Assert(coords.pitch_location(c.first, c.second, in) == want);
+            if (il == in or im == in) { continue; }
+            // and from the geometry itself
+            const auto pt = coords.ray_crossing(c.first, c.second);
+            const double geom = coords.pitch_dirs()[in].dot(pt - coords.centers()[in]);
+            Assert(std::abs(geom - want) < 1e-6);
+        }
+    }
+
+    ExecMon em("pitch locations");
+    const int ntimes = 20000;
+    double dummy = 0;
+    for (int n=0; n<ntimes; ++n) {
+        const int in = n%nlayers;
+        for (const auto& c : crossings) {
+            dummy += coords.pitch_location(c.first, c.second, in);
+        }
+    }
+    em("pitch_location");
+    for (int n=0; n<ntimes; ++n) {
+        coords.pitch_locations(crossings, n%nlayers, out);
+        dummy += out[0];
+    }
+    em("pitch_locations");
+    cerr << em.summary() << "(ignore: " << dummy << ")" << endl;
+}
+
+int main()
+{
+    auto raypairs = make_raypairs(width, height, pitch_magnitude);
+    Coordinates coords(raypairs);
+    test_pitch_locations(coords);
+
+    std::default_random_engine gen(42);
+    const int nslices = 200;
+    std::vector<activities_t> slices;
+    for (int ind=0; ind<nslices; ++ind) {
+        slices.push_back(make_slice(coords, gen, 5 + ind%20));
+    }
+
+    ExecMon em("raytiling");
+    std::vector<blobs_t> serial;
+    size_t nblobs = 0;
+    for (const auto& slice : slices) {
+        serial.push_back(make_blobs(coords, slice));
+        nblobs += serial.back().size();
+    }
+    em("serial make_blobs");
+    cerr << nblobs << " blobs in " << nslices << " slices" << endl;
+    Assert(nblobs > 0);
+
+    for (int nthreads : {1, 4}) {
+        auto batch = make_blobs(coords, slices, nthreads);
+        em("batch make_blobs with " + std::to_string(nthreads) + " threads");
+        Assert(batch.size() == serial.size());
+        for (int ind=0; ind<nslices; ++ind) {
+            Assert(same(batch[ind], serial[ind]));
+        }
+    }
+    cerr << em.summary() << endl;
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "WireCellUtil/Response.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+using namespace WireCell;
+using namespace WireCell::Response::Schema;
+using namespace std;
+
+static
+FieldResponse make_fr(int npaths, int nticks)
+{
+    std::default_random_engine gen(42);
+    std::normal_distribution<float> norm;
+    std::vector<PlaneResponse> planes;
+    for (int ipl=0; ipl<3; ++ipl) {
+        std::vector<PathResponse> paths;
+        for (int ipath=0; ipath<npaths; ++ipath) {
+            // vary the length to exercise padding
+            Waveform::realseq_t current(nticks - (ipath%3));
+            for (auto& c : current) { c = norm(gen); }
+            paths.push_back(PathResponse(current, ipath*0.3*units::mm, 0.0));
+        }
+        planes.push_back(PlaneResponse(paths, ipl, 10*units::cm - ipl*3*units::mm, 3*units::mm));
+    }
+    return FieldResponse(planes, Vector(1,0,0), 10*units::cm, 0.0, 0.1*units::us, 1.6*units::mm/units::us);
+}
+
+static
+void assert_same(const FieldResponse& a, const FieldResponse& b)
+{
+    Assert(a.planes.size() == b.planes.size());
+    Assert(a.axis == b.axis);
+    Assert(a.origin == b.origin);
+    Assert(a.tstart == b.tstart);
+    Assert(a.period == b.period);
+    Assert(a.speed == b.speed);
+    for (size_t ipl=0; ipl<a.planes.size(); ++ipl) {
+        const auto& pa = a.planes[ipl];
+        const auto& pb = b.planes[ipl];
+        Assert(pa.planeid == pb.planeid);
+        Assert(pa.location == pb.location);
+        Assert(pa.pitch == pb.pitch);
+        Assert(pa.paths.size() == pb.paths.size());
+        for (size_t ipath=0; ipath<pa.paths.size(); ++ipath) {
+            Assert(pa.paths[ipath].pitchpos == pb.paths[ipath].pitchpos);
+            Assert(pa.paths[ipath].wirepos == pb.paths[ipath].wirepos);
+            Assert(pa.paths[ipath].current == pb.paths[ipath].current);
+        }
+    }
+}
+
+int main()
+{
+    namespace bfs = boost::filesystem;
+    const bfs::path base = bfs::absolute("test_response_binary-dir");
+    bfs::remove_all(base);
+    bfs::create_directories(base);
+    const std::string binname = (base / "fr.wcfr").string();
+    const std::string jsonname = (base / "fr.json").string();
+
+    const int npaths = 210, nticks = 1000;
+    const auto fr = make_fr(npaths, nticks);
+
+    ExecMon em("field response");
+    dump(jsonname.c_str(), fr);
+    em("dump JSON");
+    dump(binname.c_str(), fr);
+    em("dump binary");
+
+    Assert(MappedFieldResponse::is_binary(binname));
+    Assert(!MappedFieldResponse::is_binary(jsonname));
+
+    const auto fromjson = load(jsonname.c_str());
+    em("load JSON");
+    const auto frombin = load(binname.c_str());
+    em("load binary");
+    assert_same(fr, frombin);
+    Assert(fromjson.planes.size() == 3);
+    Assert(fromjson.planes[1].paths[5].current.size() == fr.planes[1].paths[5].current.size());
+
+    // zero-copy view is the zero-padded plane array
+    {
+        MappedFieldResponse mfr(binname);
+        em("map binary");
+        Assert(mfr.planes().size() == 3);
+        Assert(mfr.plane(2) != nullptr);
+        Assert(mfr.plane(7) == nullptr);
+        for (const auto& pr : fr.planes) {
+            Array::array_xxf arr = Array::array_xxf::Zero(npaths, nticks);
+            for (int ipath=0; ipath<npaths; ++ipath) {
+                const auto& cur = pr.paths[ipath].current;
+                for (size_t ind=0; ind<cur.size(); ++ind) {
+                    arr(ipath, ind) = cur[ind];
+                }
+            }
+            auto cur = mfr.plane(pr.planeid)->currents();
+            Assert(cur.rows() == npaths);
+            Assert(cur.cols() == nticks);
+            Assert((cur == arr).all());
+        }
+        assert_same(fr, mfr.field_response());
+    }
+
+    // not our format
+    try {
+        MappedFieldResponse bad(jsonname);
+        AssertMsg(false, "mapped a JSON file");
+    }
+    catch (const IOError& err) {
+    }
+
+    // binary files of another byte order or version are refused
+    {
+        std::string image;
+        {
+            std::ifstream fp(binname, std::ios::binary);
+            image.assign(std::istreambuf_iterator<char>(fp), std::istreambuf_iterator<char>());
+        }
+        const std::string badname = (base / "bad.wcfr").string();
+        for (size_t at : {4, 8}) { // byte order, version
+            std::string bad = image;
+            std::reverse(bad.begin()+at, bad.begin()+at+4);
+            {
+                std::ofstream fp(badname, std::ios::binary);
+                fp << bad;
+            }
+            Assert(!MappedFieldResponse::is_binary(badname));
+            try {
+                MappedFieldResponse mbad(badname);
+                AssertMsg(false, "mapped a foreign binary file");
+            }
+            catch (const IOError& err) {
+            }
+            try {
+                load(badname.c_str());
+                AssertMsg(false, "loaded a foreign binary file");
+            }
+            catch (const IOError& err) {
+            }
+        }
+    }
+
+    // one shared load for many users
+    em("before shared");
+    std::vector<FieldResponsePtr> got(8);
+    std::vector<std::thread> threads;
+    for (size_t ith=0; ith<got.size(); ++ith) {
+        threads.emplace_back([&,ith]() { got[ith] = load_shared(binname.c_str()); });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    em("shared load by 8 threads");
+    for (const auto& one : got) {
+        Assert(one == got[0]);
+    }
+    assert_same(fr, *got[0]);
+    Assert(load_shared(binname.c_str()) == got[0]);
+    clear_shared();
+    auto again = load_shared(binname.c_str());
+    Assert(again != got[0]);
+    assert_same(*again, *got[0]);
+
+    cerr << em.summary() << endl;
+    bfs::remove_all(base);
+    return 0;
+}
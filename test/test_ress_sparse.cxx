@@ -0,0 +1,148 @@
+#include "WireCellUtil/Ress.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <random>
+#include <iostream>
+#include <cmath>
+
+using namespace WireCell;
+using namespace std;
+
+// A 0/1 response like blob-to-channel geometry.
+static
+Ress::sparse_matrix_t make_response(std::default_random_engine& gen, int nmeas, int nsrcs)
+{
+    std::uniform_int_distribution<int> row(0, nmeas-1);
+    std::vector<Eigen::Triplet<double> > nz;
+    for (int col=0; col<nsrcs; ++col) {
+        for (int ind=0; ind<3; ++ind) {
+            nz.emplace_back(row(gen), col, 1.0);
+        }
+    }
+    Ress::sparse_matrix_t R(nmeas, nsrcs);
+    R.setFromTriplets(nz.begin(), nz.end()); // duplicates summed
+    R = R.unaryExpr([](double v) { return std::min(v, 1.0); });
+    return R;
+}
+
+// Check the optimality conditions of non-negative lasso.
+static
+void check_kkt(const Ress::sparse_matrix_t& R, const Ress::vector_t& m,
+               const Ress::vector_t& s, double lambda, double tol)
+{
+    lambda *= m.size();         // penalty scales with measurements
+    const Ress::vector_t grad = R.transpose() * (m - R*s);
+    for (int j=0; j<s.size(); ++j) {
+        Assert(s[j] >= 0);
+        if (R.col(j).nonZeros() == 0) {
+            continue;
+        }
+        if (s[j] > 0) {
+            AssertMsg(std::abs(grad[j] - lambda) < tol, "active not stationary");
+        }
+        else {
+            AssertMsg(grad[j] <= lambda + tol, "inactive should be active");
+        }
+    }
+}
+
+int main()
+{
+    std::default_random_engine gen(42);
+    std::uniform_real_distribution<double> charge(0, 1000);
+    std::uniform_real_distribution<double> uni(0, 1);
+
+    const int nmeas = 2000, nsrcs = 1000;
+    auto R = make_response(gen, nmeas, nsrcs);
+    Ress::vector_t truth = Ress::vector_t::Zero(nsrcs);
+    for (int j=0; j<nsrcs; ++j) {
+        if (uni(gen) < 0.2) {
+            truth[j] = charge(gen);
+        }
+    }
+    Ress::vector_t m = R * truth;
+
+    Ress::Params params;
+    params.model = Ress::lasso;
+    params.lambda = 1e-3;
+    params.tolerance = 1e-6;
+
+    ExecMon em("ress sparse");
+    Ress::SparseSolver solver(R, params);
+    em("make solver");
+    Ress::vector_t s1 = solver.solve(m);
+    em("cold solve");
+    cerr << "cold: " << solver.iterations() << " sweeps, "
+         << solver.active().size() << " active of " << nsrcs << endl;
+    check_kkt(R, m, s1, params.lambda, 1e-2);
+
+    // the same again converges immediately
+    solver.solve(m);
+    em("warm solve, same measure");
+    Assert(solver.iterations() == 1);
+
+    // a slightly different measure converges quickly
+    Ress::vector_t m2 = m;
+    for (int i=0; i<nmeas; i += 10) {
+        m2[i] *= 1.01;
+    }
+    const int cold_iters = [&]() {
+        Ress::SparseSolver cold(R, params);
+        cold.solve(m2);
+        return cold.iterations();
+    }();
+    em("cold solve, new measure");
+    solver.solve(m2);
+    em("warm solve, new measure");
+    cerr << "new measure: cold " << cold_iters << " warm " << solver.iterations() << " sweeps" << endl;
+    Assert(solver.iterations() <= cold_iters);
+    check_kkt(R, m2, solver.solution(), params.lambda, 1e-2);
+
+    // free function agrees
+    Ress::vector_t s2 = Ress::solve(R, m, params);
+    Assert((s2 - s1).norm() < 1e-3 * s1.norm());
+
+    // the dense RESS solver agrees on a problem small enough for it
+    {
+        const int nm = 60, ns = 30;
+        auto Rs = make_response(gen, nm, ns);
+        Ress::vector_t ts = Ress::vector_t::Zero(ns);
+        for (int j=0; j<ns; j += 3) {
+            ts[j] = charge(gen);
+        }
+        const Ress::vector_t ms = Rs * ts;
+        Ress::Params sp = params;
+        sp.lambda = 0.1;
+        sp.tolerance = 1e-8;
+        const Ress::vector_t dense = Ress::solve(Ress::matrix_t(Rs), ms, sp);
+        const Ress::vector_t sparse = Ress::solve(Rs, ms, sp);
+        check_kkt(Rs, ms, sparse, sp.lambda, 1e-3);
+        AssertMsg((dense - sparse).norm() < 1e-4 * sparse.norm(), "dense and sparse disagree");
+        const double dchi = Ress::chi2(ms, Rs*dense) + Ress::chi2_l1(ms, dense, sp.lambda);
+        const double schi = Ress::chi2(ms, Rs*sparse) + Ress::chi2_l1(ms, sparse, sp.lambda);
+        Assert(std::abs(dchi - schi) < 1e-6 * dchi);
+
+        // and so does the elastic net, with weights
+        sp.model = Ress::elnet;
+        sp.alpha = 0.5;
+        Ress::vector_t ws = Ress::vector_t::Ones(ns);
+        ws[0] = 2.0;
+        const Ress::vector_t edense = Ress::solve(Ress::matrix_t(Rs), ms, sp, Ress::vector_t(), ws);
+        const Ress::vector_t esparse = Ress::solve(Rs, ms, sp, Ress::vector_t(), ws);
+        AssertMsg((edense - esparse).norm() < 1e-4 * esparse.norm(), "dense and sparse elnet disagree");
+        Assert((esparse - sparse).norm() > 1e-3 * sparse.norm());
+    }
+    em("dense and sparse");
+
+    // weights scale lambda per source: heavy weight kills a source
+    Ress::vector_t weights = Ress::vector_t::Ones(nsrcs);
+    const int killed = solver.active().front();
+    weights[killed] = 1e9;
+    Ress::SparseSolver wsolver(R, params);
+    wsolver.solve(m, weights);
+    Assert(wsolver.solution()[killed] == 0);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "WireCellUtil/RingHistogram2D.h"
+#include "WireCellUtil/BufferedHistogram2D.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+
+#include <vector>
+#include <random>
+#include <iostream>
+
+using namespace WireCell;
+using namespace std;
+
+int main()
+{
+    // as test_bufferedhistogram2d
+    {
+	RingHistogram2Dd hist(10);
+	Assert(hist.popx().size() == 0);
+	Assert(false == hist.fill(-1,-1,0));
+	Assert(false == hist.fill(0, 10.5));
+	Assert(hist.fill(0.5,3.5));
+	vector<double> dat = hist.popx();
+	Assert(dat.size() == 10);
+	Assert(dat[3] == 1.0);
+	Assert(hist.xmin() == 1.0);
+	Assert(hist.ymin() == 0.0);
+	Assert(hist.size() == 0);
+    }
+
+    // same sums as BufferedHistogram2D with popping while filling,
+    // which wraps and grows the ring.
+    const int ny = 500;
+    const size_t npoints = 2000000, nchunk = 100000;
+    std::default_random_engine gen(1);
+    std::normal_distribution<double> gx(0, 20), gy(ny/2, ny/6);
+    std::vector<double> xs(npoints), ys(npoints), vs(npoints);
+    for (size_t ind=0; ind<npoints; ++ind) {
+	xs[ind] = 100 + gx(gen) + ind/20000.0;
+	ys[ind] = gy(gen);
+	vs[ind] = 1 + ind%3;
+    }
+
+    ExecMon em("histogram fills");
+    BufferedHistogram2D old(1.0, 1.0);
+    std::vector<std::vector<double> > oldout;
+    for (size_t beg=0; beg<npoints; beg += nchunk) {
+	for (size_t ind=beg; ind<beg+nchunk; ++ind) {
+	    if (ys[ind] < ny) {
+		old.fill(xs[ind], ys[ind], vs[ind]);
+	    }
+	}
+	for (int n=0; n<5; ++n) {
+	    oldout.push_back(old.popx());
+	}
+    }
+    while (old.size()) { oldout.push_back(old.popx()); }
+    em("BufferedHistogram2D");
+
+    RingHistogram2Dd ring(ny, 1.0, 1.0);
+    std::vector<std::vector<double> > ringout;
+    for (size_t beg=0; beg<npoints; beg += nchunk) {
+	ring.fill(nchunk, xs.data()+beg, ys.data()+beg, vs.data()+beg);
+	for (int n=0; n<5; ++n) {
+	    ringout.push_back(ring.popx());
+	}
+    }
+    while (ring.size()) { ringout.push_back(ring.popx()); }
+    em("RingHistogram2D, batched");
+
+    RingHistogram2Df ringf(ny, 1.0, 1.0);
+    std::vector<float> row(ny), fvs(vs.begin(), vs.end());
+    size_t nrows = 0;
+    double ftot = 0;
+    for (size_t beg=0; beg<npoints; beg += nchunk) {
+	for (size_t ind=beg; ind<beg+nchunk; ++ind) {
+	    ringf.fill(xs[ind], ys[ind], fvs[ind]);
+	}
+	for (int n=0; n<5; ++n) {
+	    const float* front = ringf.xbin(0);
+	    if (front) {
+		Assert(front[ny/2] == ringout[nrows][ny/2]);
+	    }
+	    ringf.popx(nullptr);
+	    ++nrows;
+	}
+    }
+    while (ringf.popx(row.data())) {
+	for (auto v : row) { ftot += v; }
+	++nrows;
+    }
+    em("RingHistogram2D<float>, single");
+
+    Assert(ringout.size() == oldout.size());
+    Assert(nrows == ringout.size());
+    const size_t ninterleaved = 5*npoints/nchunk;
+    double tot = 0, tailtot = 0;
+    for (size_t ix=0; ix<oldout.size(); ++ix) {
+	const auto& o = oldout[ix];
+	const auto& r = ringout[ix];
+	// unfilled bins pop empty from BufferedHistogram2D
+	Assert(r.size() == (size_t)ny or (r.empty() and o.empty()));
+	for (size_t iy=0; iy<r.size(); ++iy) {
+	    const double ov = iy < o.size() ? o[iy] : 0;
+	    Assert(ov == r[iy]);
+	    tot += r[iy];
+	    if (ix >= ninterleaved) {
+		tailtot += r[iy];
+	    }
+	}
+    }
+    Assert(tot > 0);
+    Assert(ftot == tailtot);
+
+    cerr << em.summary() << endl;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "WireCellUtil/SingleFlight.h"
+#include "WireCellUtil/Testing.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace WireCell;
+
+int main()
+{
+    SingleFlight<int> cache;
+    std::atomic<int> nmade{0};
+    auto make = [&]() {
+        ++nmade;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return 42;
+    };
+
+    // concurrent callers wait on one make
+    std::vector<int> got(8, 0);
+    std::vector<std::thread> threads;
+    for (size_t ith=0; ith<got.size(); ++ith) {
+        threads.emplace_back([&,ith]() { got[ith] = cache.get("answer", make); });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    Assert(nmade == 1);
+    for (int one : got) {
+        Assert(one == 42);
+    }
+    int val = 0;
+    Assert(cache.peek("answer", val) and val == 42);
+    Assert(!cache.peek("question", val));
+
+    // failures reach the caller and are not kept
+    try {
+        cache.get("bad", []() -> int { throw std::runtime_error("no"); });
+        AssertMsg(false, "no exception");
+    }
+    catch (const std::runtime_error& err) {
+    }
+    Assert(!cache.peek("bad", val));
+    Assert(cache.get("bad", []() { return 7; }) == 7);
+
+    // rejected values reach the caller and are not kept
+    Assert(cache.get("odd", []() { return 3; }, [](int v) { return v % 2 == 0; }) == 3);
+    Assert(!cache.peek("odd", val));
+
+    // a rejecting maker leaves alone a newer entry made after an erase
+    std::thread slow([&]() {
+            cache.get("late", [&]() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    return -1;
+                }, [](int v) { return v >= 0; });
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    cache.erase("late");
+    Assert(cache.get("late", []() { return 5; }) == 5);
+    slow.join();
+    Assert(cache.peek("late", val) and val == 5);
+
+    cache.erase("answer");
+    Assert(!cache.peek("answer", val));
+    Assert(cache.get("answer", make) == 42 and nmade == 2);
+    cache.clear();
+    Assert(!cache.peek("bad", val));
+    return 0;
+}
@@ -97,6 +97,60 @@ void test_arithmetic()
     scale(cv2, cv);
 }
 
+void test_spans()
+{
+    using namespace WireCell::Waveform;
+    const int n = 100;
+    realseq_t wave(n);
+    for (int ind=0; ind<n; ++ind) {
+        wave[ind] = ind%10;
+    }
+    const auto want = dft(wave);
+
+    compseq_t spec(n);
+    dft(crealspan_t(wave), compspan_t(spec));
+    for (int ind=0; ind<n; ++ind) {
+        Assert(std::abs(spec[ind] - want[ind]) < 1e-3);
+    }
+
+    realseq_t back(n);
+    idft(ccompspan_t(spec), realspan_t(back));
+    for (int ind=0; ind<n; ++ind) {
+        Assert(std::abs(back[ind] - wave[ind]) < 1e-4);
+    }
+
+    // in place, complex
+    compseq_t cspec = want;
+    idft(compspan_t(cspec));
+    dft(compspan_t(cspec));
+    for (int ind=0; ind<n; ++ind) {
+        Assert(std::abs(cspec[ind] - want[ind]) < 1e-3);
+    }
+
+    realseq_t mag(n), ph(n), re(n), im(n);
+    magnitude(ccompspan_t(spec), realspan_t(mag));
+    phase(ccompspan_t(spec), realspan_t(ph));
+    real(ccompspan_t(spec), realspan_t(re));
+    imag(ccompspan_t(spec), realspan_t(im));
+    Assert(mag == magnitude(want));
+    Assert(re == real(want));
+
+    // a span over part of a buffer
+    realspan_t part(wave.data()+10, 10);
+    scale(part, 2.0);
+    increase(part, 1.0f);
+    Assert(wave[9] == 9 && wave[10] == 1 && wave[19] == 19);
+
+    realseq_t kern{1,2,3};
+    const auto conv = linear_convolve(wave, kern, false);
+    realseq_t out(conv.size()+5, -1);
+    linear_convolve(crealspan_t(wave), crealspan_t(kern), realspan_t(out));
+    for (size_t ind=0; ind<conv.size(); ++ind) {
+        Assert(std::abs(conv[ind] - out[ind]) < 1e-3);
+    }
+    Assert(out.back() == 0);
+}
+
 int main(int argc, char* argv[])
 {
     test_transform();
@@ -104,6 +158,7 @@ int main(int argc, char* argv[])
     test_complex();
     test_mean_rms();
     test_arithmetic();
+    test_spans();
 
     cerr << "bye." << endl;
     return 0;
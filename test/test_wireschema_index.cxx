@@ -0,0 +1,181 @@
+#include "WireCellUtil/WireSchema.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Units.h"
+
+#include <iostream>
+#include <random>
+
+using namespace WireCell;
+using namespace WireCell::WireSchema;
+using namespace std;
+
+// A toy detector: anodes of one face with three planes.  Induction
+// wires wrap so their channels have two segments.  Plane 1 lists
+// its wires out of order.
+static
+StoreDBPtr make_db(int nanodes, int nwires)
+{
+    auto db = std::make_shared<StoreDB>();
+    Detector det{0, {}};
+    int chan = 0;
+    for (int ianode=0; ianode<nanodes; ++ianode) {
+        Anode anode{ianode, {}};
+        Face face{0, {}};
+        for (int iplane=0; iplane<3; ++iplane) {
+            Plane plane{iplane, {}};
+            const int first_chan = chan;
+            for (int iwire=0; iwire<nwires; ++iwire) {
+                Wire w;
+                w.ident = iwire;
+                w.segment = iplane < 2 ? iwire % 2 : 0;
+                w.channel = iplane < 2 ? first_chan + iwire/2 : first_chan + iwire;
+                const double x = ianode*units::m + iplane*5*units::mm;
+                const double z = iwire*5*units::mm;
+                w.tail = Point(x, 0, z);
+                w.head = Point(x, units::m, z + (iplane-1)*units::m);
+                plane.wires.push_back(db->wires.size());
+                db->wires.push_back(w);
+            }
+            chan = 1 + std::max(chan, db->wires.back().channel);
+            if (iplane == 1) {
+                std::swap(plane.wires[0], plane.wires[1]);
+            }
+            face.planes.push_back(db->planes.size());
+            db->planes.push_back(plane);
+        }
+        anode.faces.push_back(db->faces.size());
+        db->faces.push_back(face);
+        det.anodes.push_back(db->anodes.size());
+        db->anodes.push_back(anode);
+    }
+    db->detectors.push_back(det);
+    return db;
+}
+
+int main()
+{
+    const int nanodes = 10, nwires = 1000;
+    Store store(make_db(nanodes, nwires));
+    Assert(store.db()->indices.done);
+
+    Assert(store.detector(0).anodes.size() == nanodes);
+    Assert(&store.anode(7) == &store.anodes()[7]);
+    try {
+        store.anode(nanodes);
+        AssertMsg(false, "found bogus anode");
+    }
+    catch (const KeyError& err) {
+    }
+
+    auto anodes = store.anodes(store.detector(0));
+    Assert(anodes.size() == nanodes);
+    Assert(anodes.back().ident == nanodes-1);
+    size_t nplanes = 0;
+    for (const auto& anode : anodes) {
+        for (const auto& face : store.faces(anode)) {
+            for (const auto& plane : store.planes(face)) {
+                ++nplanes;
+                auto wires = store.wires(plane);
+                Assert(wires.size() == plane.wires.size());
+                Assert(wires.contiguous() == (plane.ident != 1));
+                for (size_t ind=0; ind<wires.size(); ++ind) {
+                    Assert(&wires[ind] == &store.wires()[plane.wires[ind]]);
+                }
+
+                // cached values agree with a copy passed in
+                const Plane copy = plane;
+                const auto& chans = store.channels(plane);
+                Assert(&chans == &store.channels(copy));
+                Assert(chans.size() == plane.wires.size());
+                Assert(chans[5] == wires[5].channel);
+
+                BoundingBox bb;
+                for (const auto& w : wires) {
+                    bb(Ray(w.tail, w.head));
+                }
+                Assert(bb.bounds() == store.bounding_box(plane).bounds());
+                const auto& wp = store.wire_pitch(plane);
+                Assert(std::abs(wp.first.magnitude() - 1.0) < 1e-6);
+                Assert(std::abs(wp.first.dot(wp.second)) < 1e-6);
+            }
+        }
+        Assert(store.bounding_box(anode).bounds().first.x() == anode.ident*units::m);
+    }
+    Assert(nplanes == store.planes().size());
+
+    // views from copies stay valid after the copies are gone
+    {
+        View<Face> vfaces;
+        View<Plane> vplanes;
+        View<Wire> vwires;
+        {
+            const Anode acopy = store.anode(3);
+            vfaces = store.faces(acopy);
+            const Face fcopy = vfaces.front();
+            vplanes = store.planes(fcopy);
+            const Plane pcopy = vplanes[1];
+            vwires = store.wires(pcopy);
+        }
+        Assert(vfaces.size() == 1 and &vfaces[0] == &store.faces()[3]);
+        Assert(vplanes.size() == 3 and &vplanes[1] == &store.planes()[10]);
+        Assert(!vwires.contiguous() and vwires.size() == (size_t)nwires);
+        Assert(&vwires[0] == &store.wires()[store.planes()[10].wires[0]]);
+        const Detector dcopy = store.detector(0);
+        Assert(&store.anodes(dcopy)[4] == &store.anodes()[4]);
+    }
+
+    // iterators stay valid after their temporary view is gone
+    {
+        const Plane& plane = store.planes()[10];
+        auto beg = store.wires(plane).begin();
+        auto end = store.wires(plane).end();
+        Assert(end - beg == nwires);
+        Assert(&*beg == &store.wires()[plane.wires[0]]);
+        Assert(&*(beg+1) == &store.wires()[plane.wires[1]]);
+        auto cbeg = store.wires(store.planes()[0]).begin();
+        Assert(&*(cbeg+2) == &store.wires()[2]);
+    }
+
+    // old style copies still work
+    std::vector<Face> faces = store.faces(store.anode(3));
+    Assert(faces.size() == 1);
+
+    // channels to wires
+    for (const auto& wire : store.wires()) {
+        auto segs = store.channel_wires(wire.channel);
+        Assert(segs.size() == 1 or segs.size() == 2);
+        Assert(segs[wire.segment].ident == wire.ident);
+        for (size_t ind=0; ind<segs.size(); ++ind) {
+            Assert(segs[ind].segment == (int)ind);
+            Assert(segs[ind].channel == wire.channel);
+        }
+    }
+    Assert(store.channel_wires(-1).empty());
+
+    // per-hit lookups
+    std::default_random_engine gen(1);
+    const int maxchan = store.wires().back().channel;
+    std::uniform_int_distribution<int> uni(0, maxchan);
+    std::vector<int> hits(100000);
+    for (auto& h : hits) { h = uni(gen); }
+
+    ExecMon em("channel lookups");
+    double tot = 0;
+    for (size_t ind=0; ind<1000; ++ind) {
+        for (const auto& w : store.wires()) {
+            if (w.channel == hits[ind]) { tot += w.tail.z(); }
+        }
+    }
+    em("1000 by linear scan");
+    double tot2 = 0;
+    for (int ch : hits) {
+        for (const auto& w : store.channel_wires(ch)) {
+            tot2 += w.tail.z();
+        }
+    }
+    em("100000 by index");
+    Assert(tot2 > 0 and tot >= 0);
+    cerr << em.summary() << endl;
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "WireCellUtil/WireSchema.h"
+#include "WireCellUtil/Persist.h"
+#include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Units.h"
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <thread>
+
+using namespace WireCell;
+using namespace WireCell::WireSchema;
+using namespace std;
+
+// Write a toy wires file in the schema of wirecell.util.wires.
+static
+void write_store(const std::string& fname, int nanodes, int nwires)
+{
+    Json::Value jpoints(Json::arrayValue), jwires(Json::arrayValue), jplanes(Json::arrayValue),
+        jfaces(Json::arrayValue), janodes(Json::arrayValue), jdetanodes(Json::arrayValue);
+    auto add_point = [&](double x, double y, double z) {
+        Json::Value jp;
+        jp["x"] = x; jp["y"] = y; jp["z"] = z;
+        Json::Value one;
+        one["Point"] = jp;
+        jpoints.append(one);
+        return (int)jpoints.size()-1;
+    };
+    int chan = 0;
+    for (int ianode=0; ianode<nanodes; ++ianode) {
+        Json::Value janode;
+        janode["ident"] = 100+ianode;
+        for (int iface=0; iface<2; ++iface) {
+            Json::Value jface;
+            jface["ident"] = iface;
+            for (int iplane=0; iplane<3; ++iplane) {
+                Json::Value jplane;
+                jplane["ident"] = iplane;
+                for (int iwire=0; iwire<nwires; ++iwire) {
+                    const double x = ianode*units::m + (2*iface-1)*iplane*5*units::mm;
+                    Json::Value jwire;
+                    jwire["ident"] = iwire;
+                    jwire["channel"] = chan++;
+                    jwire["segment"] = 0;
+                    jwire["tail"] = add_point(x, 0, iwire*5*units::mm);
+                    jwire["head"] = add_point(x, units::m, iwire*5*units::mm + (iplane-1)*units::m);
+                    Json::Value one;
+                    one["Wire"] = jwire;
+                    jplane["wires"].append((int)jwires.size());
+                    jwires.append(one);
+                }
+                Json::Value one;
+                one["Plane"] = jplane;
+                jface["planes"].append((int)jplanes.size());
+                jplanes.append(one);
+            }
+            Json::Value one;
+            one["Face"] = jface;
+            janode["faces"].append((int)jfaces.size());
+            jfaces.append(one);
+        }
+        Json::Value one;
+        one["Anode"] = janode;
+        jdetanodes.append((int)janodes.size());
+        janodes.append(one);
+    }
+    Json::Value jdet;
+    jdet["ident"] = 0;
+    jdet["anodes"] = jdetanodes;
+    Json::Value jdets(Json::arrayValue);
+    Json::Value one;
+    one["Detector"] = jdet;
+    jdets.append(one);
+
+    Json::Value jstore;
+    jstore["points"] = jpoints;
+    jstore["wires"] = jwires;
+    jstore["planes"] = jplanes;
+    jstore["faces"] = jfaces;
+    jstore["anodes"] = janodes;
+    jstore["detectors"] = jdets;
+    Json::Value top;
+    top["Store"] = jstore;
+    Persist::dump(fname, top);
+}
+
+int main()
+{
+    const std::string fname = "test_wireschema_lazy.json";
+    const int nanodes = 30, nwires = 200;
+    write_store(fname, nanodes, nwires);
+
+    ExecMon em("wire schema loading");
+
+    // concurrent first loads share one
+    std::vector<Store> got(8);
+    std::vector<std::thread> threads;
+    for (size_t ith=0; ith<got.size(); ++ith) {
+        threads.emplace_back([&,ith]() { got[ith] = load(fname.c_str()); });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    em("full load by 8 threads");
+    for (const auto& one : got) {
+        Assert(one.db().get() == got[0].db().get());
+    }
+    const Store& full = got[0];
+    Assert(full.anodes().size() == nanodes);
+    Assert(full.wires().size() == size_t(nanodes*2*3*nwires));
+
+    clear_cache();
+    auto part = load(fname.c_str(), {105});
+    em("load one anode after clearing");
+    Assert(part.db().get() != full.db().get());
+    Assert(part.anodes().size() == 1);
+    Assert(part.faces().size() == 2);
+    Assert(part.planes().size() == 6);
+    Assert(part.wires().size() == size_t(2*3*nwires));
+    Assert(part.detectors().size() == 1);
+    Assert(part.detectors()[0].anodes.size() == 1);
+
+    // same content as in the full store
+    const auto& pa = part.anode(105);
+    const auto& fa = full.anode(105);
+    auto pfaces = part.faces(pa);
+    auto ffaces = full.faces(fa);
+    for (size_t iface=0; iface<2; ++iface) {
+        auto pplanes = part.planes(pfaces[iface]);
+        auto fplanes = full.planes(ffaces[iface]);
+        for (size_t iplane=0; iplane<3; ++iplane) {
+            auto pw = part.wires(pplanes[iplane]);
+            auto fw = full.wires(fplanes[iplane]);
+            Assert(pw.size() == fw.size());
+            Assert(pw.contiguous());
+            for (size_t ind=0; ind<pw.size(); ++ind) {
+                Assert(pw[ind].channel == fw[ind].channel);
+                Assert(pw[ind].tail == fw[ind].tail);
+                Assert(pw[ind].head == fw[ind].head);
+            }
+            Assert(part.bounding_box(pplanes[iplane]).bounds() == full.bounding_box(fplanes[iplane]).bounds());
+        }
+    }
+    const int chan = full.wires()[5*2*3*nwires + 17].channel;
+    Assert(part.channel_wires(chan).size() == 1);
+
+    // cached by anode set
+    Assert(load(fname.c_str(), {105, 105}).db().get() == part.db().get());
+    auto two = load(fname.c_str(), {110, 105});
+    em("load two anodes");
+    Assert(two.db().get() != part.db().get());
+    Assert(two.anodes().size() == 2);
+    Assert(two.anodes()[0].ident == 105);
+    Assert(load(fname.c_str(), {105, 110}).db().get() == two.db().get());
+
+    auto three = load(fname.c_str(), {101});
+    em("load another anode");
+    Assert(three.anodes().size() == 1 and three.anodes()[0].ident == 101);
+
+    try {
+        load(fname.c_str(), {7});
+        AssertMsg(false, "loaded unknown anode");
+    }
+    catch (const KeyError& err) {
+    }
+
+    // the store of the whole file was cached by the first anode load
+    auto full2 = load(fname.c_str());
+    em("full load, cached");
+    Assert(full2.db().get() != full.db().get());
+    Assert(full2.db().get() == load(fname.c_str()).db().get());
+    Assert(full2.wires().size() == full.wires().size());
+    Assert(full2.wires()[1234].head == full.wires()[1234].head);
+
+    cerr << em.summary() << endl;
+    boost::filesystem::remove(fname);
+    return 0;
+}